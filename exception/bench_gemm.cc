@@ -0,0 +1,117 @@
+//
+// 矩阵乘法的 GFLOPS
+//
+// 用法: ./bench-gemm [max_size] [naive_rows]
+// 方阵大小从 64 翻倍到 max_size(默认4096)，每个大小测三种：
+//  - 三重循环(i, j, k)，B 按列读；大矩阵全算太久，只算前 naive_rows(默认64) 行，按行数折算 GFLOPS；
+//  - gemm 标量微内核；
+//  - gemm AVX2/FMA 微内核(CPU 不支持时跳过)。
+// 乘加各算一次浮点运算，n x n 的乘法是 2n^3 次。结果和三重循环算出的那几行比较，允许 float 累加的舍入误差。
+//
+
+#include "gemm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 前 rows 行的 C = A * B
+static void NaiveRows(size_t n, size_t rows, const float *a, const float *b, float *c)
+{
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < n; ++j)
+        {
+            float sum = 0;
+            for (size_t p = 0; p < n; ++p)
+                sum += a[i * n + p] * b[p * n + j];
+            c[i * n + j] = sum;
+        }
+}
+
+// 前 rows 行和参考结果的最大相对误差
+static double MaxError(size_t n, size_t rows, const float *c, const float *reference)
+{
+    double err = 0;
+    for (size_t i = 0; i < rows * n; ++i)
+        err = std::max(err, (double)std::fabs(c[i] - reference[i]) / (std::fabs(reference[i]) + 1));
+    return err;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxSize = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4096;
+    size_t naiveRows = argc > 2 ? strtoul(argv[2], nullptr, 10) : 64;
+    bool avx2 = gemm_detail::avx2_supported();
+    bool ok = true;
+
+    printf("%6s %14s %14s %14s %10s\n", "n", "naive GFLOPS", "scalar GFLOPS", "avx2 GFLOPS", "max error");
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (size_t n = 64; n <= maxSize; n *= 2)
+    {
+        std::vector<float> a(n * n), b(n * n), c(n * n);
+        for (size_t i = 0; i < n * n; ++i)
+        {
+            a[i] = dist(rng);
+            b[i] = dist(rng);
+        }
+        double flops = 2.0 * n * n * n;
+        // 小矩阵重复多次，让每次测量至少有几千万次运算
+        size_t repeat = std::max<size_t>(1, (size_t)(2e8 / flops));
+
+        size_t rows = std::min(n, naiveRows);
+        std::vector<float> reference(rows * n);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repeat; ++r)
+            NaiveRows(n, rows, a.data(), b.data(), reference.data());
+        double naive = flops * rows / n * repeat / SecondsSince(start) / 1e9;
+
+        double gflops[2] = {0, 0}, err = 0;
+        const gemm_kernel kernels[2] = {gemm_kernel::scalar, gemm_kernel::avx2};
+        for (int i = 0; i < 2; ++i)
+        {
+            if (kernels[i] == gemm_kernel::avx2 && !avx2)
+                continue;
+            start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < repeat; ++r)
+                gemm(n, n, n, a.data(), n, b.data(), n, c.data(), n, kernels[i]);
+            gflops[i] = flops * repeat / SecondsSince(start) / 1e9;
+            err = std::max(err, MaxError(n, rows, c.data(), reference.data()));
+        }
+        ok &= err < 1e-3;
+        printf("%6zu %14.2f %14.2f %14.2f %10.2e\n", n, naive, gflops[0], gflops[1], err);
+    }
+
+    // 非方阵、边角不满一个微内核的情况
+    for (size_t m : {1, 7, 13, 150})
+        for (size_t n : {1, 17, 33, 3100})
+            for (size_t k : {1, 5, 300})
+            {
+                std::vector<float> a(m * k), b(k * n), c(m * n), reference(m * n);
+                for (auto &v : a)
+                    v = dist(rng);
+                for (auto &v : b)
+                    v = dist(rng);
+                for (size_t i = 0; i < m; ++i)
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        float sum = 0;
+                        for (size_t p = 0; p < k; ++p)
+                            sum += a[i * k + p] * b[p * n + j];
+                        reference[i * n + j] = sum;
+                    }
+                gemm(m, n, k, a.data(), k, b.data(), n, c.data(), n);
+                ok &= MaxError(n, m, c.data(), reference.data()) < 1e-4;
+            }
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
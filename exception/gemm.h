@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESTUDYCPP_GEMM_X86 1
+#endif
+
+/*
+ * 单精度矩阵乘法 C = A * B，矩阵都按行存放(lda/ldb/ldc 是一行隔多少个元素)。
+ *
+ * 三重循环直接算的问题不在计算量，而在访存：每算一个 C 的元素都要把 A 的一行和 B 的一列读一遍，
+ * B 按列读跨行跳着走，矩阵一大，几乎每次读都不在缓存里。这里按 GotoBLAS/BLIS 的方式分块：
+ *
+ *  - 最外两层把 B 切成 kKC x kNC 的块，打包(pack)成连续的、每 kNR 列一条的小条，这块 B 常驻 L3/L2；
+ *  - 再把 A 切成 kMC x kKC 的块，打包成每 kMR 行一条的小条，这块 A 常驻 L2；
+ *  - 最里面是 kMR x kNR 的微内核：C 的这一小块放在寄存器里，沿 k 方向每步读一列 A 小条(kMR 个数)和一行 B 小条(kNR 个数)，
+ *    做 kMR x kNR 次乘加。一条 B 小条 kKC x kNR x 4 字节 = 16KB，加上 A 小条，都在 L1 里。
+ *  打包时不满 kMR/kNR 的边角补 0，微内核不用处理边界，只在写回 C 时只写有效的部分。
+ *
+ * 微内核有两个版本，第一次调用时按 CPU 选：
+ *  - AVX2 + FMA：6 x 16 的 C 块占 12 个 ymm 寄存器，每步 2 次读 B、6 次广播 A、12 条 FMA；
+ *    用 __attribute__((target)) 单独为这个函数打开 AVX2/FMA，其余代码不要求 CPU 支持；
+ *  - 标量：同样的打包格式，普通的循环，编译器可能用 SSE 向量化，在不支持 AVX2 的机器上用。
+ * 也可以用 gemm_kernel 指定版本；指定 avx2 而 CPU 不支持时抛出 std::runtime_error。
+ * 打包缓冲区按 64 字节对齐分配，分配失败时抛出 std::bad_alloc，C 的内容不确定。
+ * */
+enum class gemm_kernel { best, scalar, avx2 };
+
+namespace gemm_detail {
+    constexpr size_t kMR = 6;    // 微内核的行数
+    constexpr size_t kNR = 16;   // 微内核的列数，两个 ymm 寄存器
+    constexpr size_t kKC = 256;  // k 方向的块长：B 小条 16KB，A 小条 6KB，都在 L1
+    constexpr size_t kMC = 72;   // A 块 72 x 256 x 4 = 72KB，在 L2；试过 144，并不更快
+    constexpr size_t kNC = 3072; // B 块 256 x 3072 x 4 = 3MB，在 L3
+
+    using kernel_fn = void (*)(size_t kc, const float *a, const float *b, float *c, size_t ldc, size_t rows, size_t cols);
+
+    struct aligned_free {
+        void operator()(float *p) const { std::free(p); }
+    };
+
+    inline std::unique_ptr<float[], aligned_free> aligned_floats(size_t count) {
+        size_t bytes = (count * sizeof(float) + 63) / 64 * 64;
+        float *p = static_cast<float *>(std::aligned_alloc(64, bytes));
+        if (!p)
+            throw std::bad_alloc();
+        return std::unique_ptr<float[], aligned_free>(p);
+    }
+
+    // A 的 mc x kc 块 -> 每 kMR 行一条，条内按 k 排：a[p*kMR + r]
+    inline void pack_a(size_t mc, size_t kc, const float *a, size_t lda, float *out) {
+        for (size_t i = 0; i < mc; i += kMR) {
+            size_t rows = mc - i < kMR ? mc - i : kMR;
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t r = 0; r < rows; ++r)
+                    out[r] = a[(i + r) * lda + p];
+                for (size_t r = rows; r < kMR; ++r)
+                    out[r] = 0;
+                out += kMR;
+            }
+        }
+    }
+
+    // B 的 kc x nc 块 -> 每 kNR 列一条，条内按 k 排：b[p*kNR + j]
+    inline void pack_b(size_t kc, size_t nc, const float *b, size_t ldb, float *out) {
+        for (size_t j = 0; j < nc; j += kNR) {
+            size_t cols = nc - j < kNR ? nc - j : kNR;
+            for (size_t p = 0; p < kc; ++p) {
+                const float *row = b + p * ldb + j;
+                if (cols == kNR) {
+                    std::memcpy(out, row, kNR * sizeof(float));
+                } else {
+                    for (size_t c = 0; c < cols; ++c)
+                        out[c] = row[c];
+                    for (size_t c = cols; c < kNR; ++c)
+                        out[c] = 0;
+                }
+                out += kNR;
+            }
+        }
+    }
+
+    // 把 kMR x kNR 的结果加到 C 的 rows x cols 部分
+    inline void add_tile(const float *tile, float *c, size_t ldc, size_t rows, size_t cols) {
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t j = 0; j < cols; ++j)
+                c[r * ldc + j] += tile[r * kNR + j];
+    }
+
+    inline void kernel_scalar(size_t kc, const float *a, const float *b, float *c, size_t ldc, size_t rows, size_t cols) {
+        float acc[kMR * kNR] = {};
+        for (size_t p = 0; p < kc; ++p, a += kMR, b += kNR)
+            for (size_t r = 0; r < kMR; ++r)
+                for (size_t j = 0; j < kNR; ++j)
+                    acc[r * kNR + j] += a[r] * b[j];
+        add_tile(acc, c, ldc, rows, cols);
+    }
+
+#ifdef RESTUDYCPP_GEMM_X86
+    __attribute__((target("avx2,fma"))) inline void kernel_avx2(size_t kc, const float *a, const float *b, float *c, size_t ldc,
+                                                                 size_t rows, size_t cols) {
+        __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+        __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+        __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+        __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+        __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+        __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+        for (size_t p = 0; p < kc; ++p, a += kMR, b += kNR) {
+            __m256 b0 = _mm256_load_ps(b), b1 = _mm256_load_ps(b + 8);
+            __m256 x = _mm256_broadcast_ss(a + 0);
+            c00 = _mm256_fmadd_ps(x, b0, c00);
+            c01 = _mm256_fmadd_ps(x, b1, c01);
+            x = _mm256_broadcast_ss(a + 1);
+            c10 = _mm256_fmadd_ps(x, b0, c10);
+            c11 = _mm256_fmadd_ps(x, b1, c11);
+            x = _mm256_broadcast_ss(a + 2);
+            c20 = _mm256_fmadd_ps(x, b0, c20);
+            c21 = _mm256_fmadd_ps(x, b1, c21);
+            x = _mm256_broadcast_ss(a + 3);
+            c30 = _mm256_fmadd_ps(x, b0, c30);
+            c31 = _mm256_fmadd_ps(x, b1, c31);
+            x = _mm256_broadcast_ss(a + 4);
+            c40 = _mm256_fmadd_ps(x, b0, c40);
+            c41 = _mm256_fmadd_ps(x, b1, c41);
+            x = _mm256_broadcast_ss(a + 5);
+            c50 = _mm256_fmadd_ps(x, b0, c50);
+            c51 = _mm256_fmadd_ps(x, b1, c51);
+        }
+        const __m256 acc[kMR][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+        if (rows == kMR && cols == kNR) {
+            for (size_t r = 0; r < kMR; ++r) {
+                float *row = c + r * ldc;
+                _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[r][0]));
+                _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[r][1]));
+            }
+            return;
+        }
+        alignas(32) float tile[kMR * kNR];
+        for (size_t r = 0; r < kMR; ++r) {
+            _mm256_store_ps(tile + r * kNR, acc[r][0]);
+            _mm256_store_ps(tile + r * kNR + 8, acc[r][1]);
+        }
+        add_tile(tile, c, ldc, rows, cols);
+    }
+#endif
+
+    inline bool avx2_supported() {
+#ifdef RESTUDYCPP_GEMM_X86
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    inline kernel_fn select(gemm_kernel kernel) {
+        if (kernel == gemm_kernel::scalar || (kernel == gemm_kernel::best && !avx2_supported()))
+            return kernel_scalar;
+#ifdef RESTUDYCPP_GEMM_X86
+        if (avx2_supported())
+            return kernel_avx2;
+#endif
+        throw std::runtime_error("gemm: AVX2/FMA not supported by this CPU");
+    }
+}
+
+//C(m x n) = A(m x k) * B(k x n)，按行存放
+inline void gemm(size_t m, size_t n, size_t k, const float *a, size_t lda, const float *b, size_t ldb, float *c, size_t ldc,
+                 gemm_kernel kernel = gemm_kernel::best) {
+    using namespace gemm_detail;
+    kernel_fn micro = select(kernel);
+    for (size_t i = 0; i < m; ++i)
+        std::memset(c + i * ldc, 0, n * sizeof(float));
+    if (m == 0 || n == 0 || k == 0)
+        return;
+
+    size_t kcMax = k < kKC ? k : kKC;
+    size_t mcMax = m < kMC ? (m + kMR - 1) / kMR * kMR : kMC;
+    size_t ncMax = n < kNC ? (n + kNR - 1) / kNR * kNR : kNC;
+    auto packedA = aligned_floats(mcMax * kcMax);
+    auto packedB = aligned_floats(kcMax * ncMax);
+
+    for (size_t jc = 0; jc < n; jc += kNC) {
+        size_t nc = n - jc < kNC ? n - jc : kNC;
+        for (size_t pc = 0; pc < k; pc += kKC) {
+            size_t kc = k - pc < kKC ? k - pc : kKC;
+            pack_b(kc, nc, b + pc * ldb + jc, ldb, packedB.get());
+            for (size_t ic = 0; ic < m; ic += kMC) {
+                size_t mc = m - ic < kMC ? m - ic : kMC;
+                pack_a(mc, kc, a + ic * lda + pc, lda, packedA.get());
+                for (size_t jr = 0; jr < nc; jr += kNR) {
+                    size_t cols = nc - jr < kNR ? nc - jr : kNR;
+                    for (size_t ir = 0; ir < mc; ir += kMR) {
+                        size_t rows = mc - ir < kMR ? mc - ir : kMR;
+                        micro(kc, packedA.get() + ir * kc, packedB.get() + jr * kc, c + (ic + ir) * ldc + jc + jr, ldc, rows, cols);
+                    }
+                }
+            }
+        }
+    }
+}
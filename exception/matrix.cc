@@ -50,14 +50,17 @@ vector 会在元素类型没有提供保证不抛异常的移动构造函数的
        所以，像 swap 这样的成员函数应当尽可能标成 noexcept。
  */
 
+#include "gemm.h"
+
 #include <iostream>
+#include <stdexcept>
 
 class matrix {
 
 public:
     matrix(size_t rows, size_t cols) : rows_(rows), cols_(cols) {
         std::cout << "matrix()" << std::endl;
-        data_ = new float[rows * cols];
+        data_ = new float[rows * cols](); // 初始化为 0
         // 如果 new 出错，按照 C++ 的规则，一般会得到异常 bad_alloc，对象的构造也就失败了。
         // 这种情况下，在 catch 捕捉到这个异常**之前**，所有的栈上对象会全部被析构，资源全部被自动清理。
         // => 不会造成内存泄漏
@@ -75,7 +78,9 @@ public:
             // throw异常，后面语句不会执行，对象 c 根本不会被构造出来 => 不会造成内存泄漏
         }
         matrix result(rows_, rhs.cols_); // 如果失败，result 对象根本没有构造出来  => 不会造成内存泄漏
-        // 进行矩阵乘法运算
+        // 进行矩阵乘法运算：分块打包 + AVX2/FMA 微内核，见 gemm.h。
+        // gemm 内部分配打包缓冲区失败时抛出 bad_alloc，result 已经构造好了，会被析构 => 不会造成内存泄漏
+        gemm(rows_, rhs.cols_, cols_, data_, cols_, rhs.data_, rhs.cols_, result.data_, result.cols_);
 
         return result;
     }
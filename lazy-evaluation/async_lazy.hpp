@@ -0,0 +1,245 @@
+//
+// 可以提前在后台求值的惰性值
+//
+
+#ifndef RESTUDYCPP_ASYNC_LAZY_H
+#define RESTUDYCPP_ASYNC_LAZY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+/*
+ * 有些初始化方案很慢(加载查找表、编译正则)，lazy 的第一次 get_value 要把调用者堵住整个初始化过程。
+ * async_lazy 可以在启动时调用 prefetch 把初始化方案投递到后台执行器上先算着，第一次取值时：
+ *  - 已经算完，直接返回；
+ *  - 正在后台算，等它算完；
+ *  - 还在执行器的队列里排队没开始，调用者自己把它认领过来当场算，不用排在别的任务后面；
+ *  - 没有 prefetch 过，和 lazy 一样当场算。
+ * 无论哪种情况初始化方案都只会成功执行一次。
+ *
+ * 状态用一个原子变量表示，已经算完之后取值同 lazy 一样只是一次 acquire 读；要等的时候用条件变量，
+ * 不像 lazy 那样让出CPU空转，因为这里的初始化方案往往要算很久。
+ *
+ * 状态、值和初始化方案放在一块堆上分配的共享状态里，投递出去的任务也持有它，
+ * 所以 async_lazy 可以在任务执行前析构：还在排队的任务被取消，正在执行的任务算完后自行释放。
+ *
+ * 初始化方案抛出异常：当场执行的，异常传给调用者；后台执行的，异常交给随后第一个取值的调用者(包括正在等待的)。
+ * 两种情况之后都回到未初始化状态，下次取值重新当场执行(与 lazy 相同)。
+ *
+ * 执行器只要有 post(std::function<void()>) 即可，下面的 background_executor 是一个简单的固定线程池。
+ *
+ *  background_executor executor(1);
+ *  auto table = make_async_lazy([]() { return build_table(); });
+ *  table.prefetch(executor);   // 启动时
+ *  ...
+ *  table.get_value();          // 第一次使用
+ * */
+class background_executor
+{
+public:
+    explicit background_executor(size_t threads = 1)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this]() { run(); });
+    }
+
+    // 队列里剩下的任务执行完才退出
+    ~background_executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &worker : workers_)
+            worker.join();
+    }
+
+    background_executor(const background_executor &) = delete;
+    background_executor &operator=(const background_executor &) = delete;
+
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                    return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+template <typename F> class async_lazy
+{
+public:
+    using value_type = std::decay_t<std::invoke_result_t<F &>>;
+
+    explicit async_lazy(F policy) : state_(std::make_shared<shared_state>(std::move(policy))) {}
+    async_lazy(async_lazy &&) = default;
+    async_lazy(const async_lazy &) = delete;
+    async_lazy &operator=(const async_lazy &) = delete;
+
+    ~async_lazy()
+    {
+        // 还在排队的任务取消掉；正在执行的不等，任务持有共享状态
+        if (state_)
+        {
+            uint8_t queued = kQueued;
+            state_->status.compare_exchange_strong(queued, kEmpty, std::memory_order_relaxed);
+        }
+    }
+
+    // 投递到执行器上提前求值；已经投递过、正在算或者已经算完时什么也不做，返回false
+    template <typename Executor> bool prefetch(Executor &executor)
+    {
+        uint8_t empty = kEmpty;
+        if (!state_->status.compare_exchange_strong(empty, kQueued, std::memory_order_relaxed))
+            return false;
+        std::shared_ptr<shared_state> state = state_;
+        executor.post([state]() {
+            uint8_t queued = kQueued;
+            if (state->status.compare_exchange_strong(queued, kBusy, std::memory_order_acquire))
+                state->run(true);
+        });
+        return true;
+    }
+
+    value_type &get_value()
+    {
+        if (state_->status.load(std::memory_order_acquire) == kReady)
+            return *state_->ptr();
+        return state_->wait();
+    }
+
+    bool ready() const { return state_->status.load(std::memory_order_acquire) == kReady; }
+
+    value_type &operator()() { return get_value(); }
+
+    operator value_type() { return get_value(); }
+
+private:
+    enum : uint8_t
+    {
+        kEmpty,
+        kQueued,
+        kBusy,
+        kReady
+    };
+
+    struct shared_state
+    {
+        explicit shared_state(F _) : policy(std::move(_)) {}
+
+        ~shared_state()
+        {
+            if (status.load(std::memory_order_relaxed) == kReady)
+                ptr()->~value_type();
+        }
+
+        value_type *ptr() { return std::launder(reinterpret_cast<value_type *>(&storage)); }
+
+        // 已经把状态改成 kBusy 的一方调用
+        void run(bool background)
+        {
+            std::exception_ptr error;
+            try
+            {
+                ::new (static_cast<void *>(&storage)) value_type(policy());
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error && background)
+                    failure = error;
+                status.store(error ? kEmpty : kReady, std::memory_order_release);
+            }
+            cv.notify_all();
+            if (error && !background)
+                std::rethrow_exception(error);
+        }
+
+        __attribute__((noinline)) value_type &wait()
+        {
+            while (true)
+            {
+                uint8_t status_now = status.load(std::memory_order_acquire);
+                if (status_now == kReady)
+                    return *ptr();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (failure)
+                    {
+                        std::exception_ptr error = failure;
+                        failure = nullptr;
+                        std::rethrow_exception(error);
+                    }
+                }
+
+                // 没开始算的(包括排队中的)自己认领过来算
+                if ((status_now == kEmpty || status_now == kQueued) &&
+                    status.compare_exchange_strong(status_now, kBusy, std::memory_order_acquire))
+                {
+                    run(false);
+                    return *ptr();
+                }
+
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this]() { return status.load(std::memory_order_acquire) != kBusy; });
+            }
+        }
+
+        std::aligned_storage_t<sizeof(value_type), alignof(value_type)> storage;
+        std::atomic<uint8_t> status{kEmpty};
+        F policy;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::exception_ptr failure; // 后台执行失败的异常，交给下一个取值的调用者
+    };
+
+    std::shared_ptr<shared_state> state_;
+};
+
+template <typename F> async_lazy<std::decay_t<F>> make_async_lazy(F &&policy)
+{
+    return async_lazy<std::decay_t<F>>(std::forward<F>(policy));
+}
+
+#endif //RESTUDYCPP_ASYNC_LAZY_H
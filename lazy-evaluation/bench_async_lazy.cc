@@ -0,0 +1,139 @@
+//
+// 启动时 prefetch 对第一次使用的延迟的影响
+//
+// 用法: ./bench-async-lazy [startup_ms] [words] [table_bits]
+// 两个慢的初始化方案：编译一个 words 个单词(默认2000)的正则，构造 2^table_bits 项(默认22)的查找表。
+// 启动过程用 sleep startup_ms(默认200ms)模拟(读配置、建连接这类等 I/O 的事情)，之后第一次同时用到这两个值，
+// 统计从第一次取值到拿到两个值用了多久：
+//  1. lazy：第一次取值时当场算；
+//  2. async_lazy，不 prefetch：同 lazy；
+//  3. async_lazy，启动时 prefetch 到一个后台线程；
+//  4. 同3，但启动过程很短(startup_ms/10)，第一次取值时后台还没算完。
+// 最后让多个线程和后台任务抢同一个值，检查初始化方案只执行一次。
+//
+
+#include "async_lazy.hpp"
+#include "lazy.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<int> regexBuilds(0), tableBuilds(0);
+static int words = 2000;
+static int tableBits = 22;
+
+static std::regex BuildRegex()
+{
+    ++regexBuilds;
+    std::string pattern;
+    for (int i = 0; i < words; ++i)
+    {
+        if (i)
+            pattern += '|';
+        pattern += "metric_" + std::to_string(i * 7919 % 100000) + "_total";
+    }
+    return std::regex(pattern, std::regex::optimize);
+}
+
+static std::vector<uint32_t> BuildTable()
+{
+    ++tableBuilds;
+    // CRC32 风格的逐位计算，每项8轮
+    std::vector<uint32_t> table(1u << tableBits);
+    for (uint32_t i = 0; i < table.size(); ++i)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Use(const std::regex &re, const std::vector<uint32_t> &table)
+{
+    if (!std::regex_match("metric_7919_total", re) || table.empty())
+        printf("unexpected value\n");
+}
+
+template <typename Regex, typename Table> static void Report(const char *name, int startupMs, Regex &re, Table &table)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(startupMs));
+    auto start = std::chrono::steady_clock::now();
+    Use(re.get_value(), table.get_value());
+    printf("%-36s startup %4d ms, first use %8.2f ms\n", name, startupMs, MsSince(start));
+}
+
+int main(int argc, char *argv[])
+{
+    int startupMs = argc > 1 ? atoi(argv[1]) : 200;
+    words = argc > 2 ? atoi(argv[2]) : words;
+    tableBits = argc > 3 ? atoi(argv[3]) : tableBits;
+
+    // 单独量一下两个初始化方案各要多久
+    auto start = std::chrono::steady_clock::now();
+    BuildRegex();
+    double regexMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    BuildTable();
+    printf("regex build %.1f ms, table build %.1f ms\n", regexMs, MsSince(start));
+    regexBuilds = tableBuilds = 0;
+
+    {
+        auto re = lazy(BuildRegex);
+        auto table = lazy(BuildTable);
+        Report("lazy", startupMs, re, table);
+    }
+    {
+        auto re = async_lazy(BuildRegex);
+        auto table = async_lazy(BuildTable);
+        Report("async_lazy, no prefetch", startupMs, re, table);
+    }
+    {
+        background_executor executor(1);
+        auto re = async_lazy(BuildRegex);
+        auto table = async_lazy(BuildTable);
+        re.prefetch(executor);
+        table.prefetch(executor);
+        Report("async_lazy, prefetch at startup", startupMs, re, table);
+    }
+    {
+        background_executor executor(1);
+        auto re = async_lazy(BuildRegex);
+        auto table = async_lazy(BuildTable);
+        re.prefetch(executor);
+        table.prefetch(executor);
+        Report("async_lazy, prefetch, short startup", startupMs / 10, re, table);
+    }
+    printf("regex built %d times, table built %d times (expected 4 each)\n", regexBuilds.load(), tableBuilds.load());
+
+    // 后台任务和4个取值线程抢同一个值
+    std::atomic<int> calls(0);
+    int rounds = 2000;
+    {
+        background_executor executor(2);
+        for (int r = 0; r < rounds; ++r)
+        {
+            auto value = make_async_lazy([&]() { return calls.fetch_add(1) + 1; });
+            value.prefetch(executor);
+            std::vector<std::thread> readers;
+            for (int t = 0; t < 4; ++t)
+                readers.emplace_back([&]() { value.get_value(); });
+            for (auto &reader : readers)
+                reader.join();
+        }
+    }
+    printf("%d racing rounds: policy ran %d times\n", rounds, calls.load());
+    return 0;
+}
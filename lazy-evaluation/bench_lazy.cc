@@ -0,0 +1,137 @@
+//
+// 已经求过值之后的取值开销: lazy.hpp 对比早先基于 std::function 的版本、std::call_once、函数内的静态变量
+//
+// 用法: ./bench-lazy [iterations] [threads]
+// 另外让 threads 个线程同时第一次取值，检查初始化方案只执行了一次。
+//
+
+#include "lazy.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// 早先的版本，原样保留作对照(线程不安全)
+template <typename T> class legacy_lazy
+{
+private:
+    T value_;
+    std::function<T()> policy_;
+    bool initialized_;
+    static T default_policy()
+    {
+        throw std::runtime_error("No lazy initiation policy given.");
+    }
+public:
+    legacy_lazy() : policy_(default_policy), initialized_(false) {}
+    legacy_lazy(std::function<T()> _) : policy_(_), initialized_(false) {}
+
+    T& get_value()
+    {
+        if (!initialized_)
+        {
+            value_ = policy_();
+            initialized_ = true;
+        }
+        return value_;
+    }
+};
+
+// 每次取值之后让编译器认为内存可能被改过，不能把取值提到循环外面
+template <typename T> static void Escape(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Get> static uint64_t Measure(const char *name, uint64_t iterations, Get get)
+{
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+    {
+        const uint64_t &value = get();
+        sum += value;
+        Escape(value);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%-24s %6.2f ns/access\n", name, elapsed.count() / iterations);
+    return sum;
+}
+
+static uint64_t Compute()
+{
+    return (uint64_t)(acos(-1.0) * 1e9);
+}
+
+static uint64_t StaticLocal()
+{
+    static uint64_t value = Compute();
+    return value;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 200000000;
+    int threads = argc > 2 ? atoi(argv[2]) : 8;
+
+    auto probe = lazy([]() { return Compute(); });
+    printf("sizeof: legacy_lazy<uint64_t> %zu, lazy %zu\n", sizeof(legacy_lazy<uint64_t>), sizeof(probe));
+
+    uint64_t sum = 0;
+    {
+        legacy_lazy<uint64_t> pi(Compute);
+        sum += Measure("legacy lazy (function)", iterations, [&]() -> uint64_t & { return pi.get_value(); });
+    }
+    {
+        auto pi = lazy(Compute);
+        sum += Measure("lazy (atomic state)", iterations, [&]() -> uint64_t & { return pi.get_value(); });
+    }
+    {
+        std::once_flag flag;
+        uint64_t pi = 0;
+        sum += Measure("std::call_once", iterations, [&]() -> uint64_t & {
+            std::call_once(flag, [&]() { pi = Compute(); });
+            return pi;
+        });
+    }
+    {
+        uint64_t value;
+        sum += Measure("static local", iterations, [&]() -> uint64_t & {
+            value = StaticLocal();
+            return value;
+        });
+    }
+
+    // 并发第一次取值
+    std::atomic<int> calls(0);
+    std::atomic<bool> go(false);
+    auto shared = lazy([&]() {
+        calls.fetch_add(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return acos(-1.0);
+    });
+    std::vector<std::thread> workers;
+    std::atomic<int> wrong(0);
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]() {
+            while (!go)
+                std::this_thread::yield();
+            if (shared() != acos(-1.0))
+                ++wrong;
+        });
+    }
+    go = true;
+    for (auto &worker : workers)
+        worker.join();
+    printf("%d threads racing on first access: policy called %d time(s), %d wrong value(s)\n", threads, calls.load(),
+           wrong.load());
+
+    return sum == 0 ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+//
+// 增量计算图对比全量重算
+//
+// 用法: ./bench-lazy-graph [width] [depth] [work] [updates]
+// 图共 width*depth 个格子(默认 1000*100=10万)：第0层是输入，第k层的第i个格子读第k-1层的 i-1、i、i+1 三个格子。
+// 每个派生格子计算时先空转 work 轮(默认100轮 LCG，模拟代价较高的派生指标)，再得出结果：
+//  - hash: 三个输入的和打散，任何输入变化都会一直传到最后一层，影响范围是一个向下扩张的锥形；
+//  - max:  三个输入的最大值，大部分输入变化传不了几层就被"值没变"截断。
+// 每轮随机改一个输入，然后读出最后一层全部格子；全量重算则每轮按层把所有格子重新算一遍。
+//
+
+#include "lazy_graph.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static uint64_t Burn(uint64_t x, int work)
+{
+    for (int k = 0; k < work; ++k)
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    asm volatile("" : "+r"(x));
+    return x;
+}
+
+static uint64_t Combine(bool max, uint64_t a, uint64_t b, uint64_t c, int work)
+{
+    uint64_t burned = Burn(a + b + c, work);
+    if (max)
+        return std::max(a, std::max(b, c));
+    return burned ^ (burned >> 29);
+}
+
+struct Result
+{
+    double usPerUpdate;
+    double recomputedPerUpdate;
+    uint64_t checksum;
+};
+
+static Result Incremental(bool max, size_t width, size_t depth, int work, size_t updates, const std::vector<uint64_t> &changes)
+{
+    lazy_graph g;
+    std::vector<input_cell<uint64_t> *> inputs;
+    std::vector<cell<uint64_t> *> prev, layer;
+    for (size_t i = 0; i < width; ++i)
+    {
+        inputs.push_back(&g.input((uint64_t)i));
+        prev.push_back(inputs.back());
+    }
+    for (size_t k = 1; k < depth; ++k)
+    {
+        layer.clear();
+        for (size_t i = 0; i < width; ++i)
+        {
+            cell<uint64_t> *a = prev[(i + width - 1) % width], *b = prev[i], *c = prev[(i + 1) % width];
+            layer.push_back(&g.derived([=]() { return Combine(max, a->get(), b->get(), c->get(), work); }));
+        }
+        prev.swap(layer);
+    }
+
+    // 先全部算一遍，之后只测增量部分
+    uint64_t checksum = 0;
+    for (auto *out : prev)
+        checksum += out->get();
+    uint64_t before = g.recomputations();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t u = 0; u < updates; ++u)
+    {
+        inputs[changes[2 * u] % width]->set(changes[2 * u + 1]);
+        for (auto *out : prev)
+            checksum += out->get();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count() / updates, (double)(g.recomputations() - before) / updates, checksum};
+}
+
+static Result Full(bool max, size_t width, size_t depth, int work, size_t updates, const std::vector<uint64_t> &changes)
+{
+    std::vector<uint64_t> values(width * depth);
+    for (size_t i = 0; i < width; ++i)
+        values[i] = i;
+    auto recompute = [&]() {
+        for (size_t k = 1; k < depth; ++k)
+        {
+            const uint64_t *prev = &values[(k - 1) * width];
+            uint64_t *layer = &values[k * width];
+            for (size_t i = 0; i < width; ++i)
+                layer[i] = Combine(max, prev[(i + width - 1) % width], prev[i], prev[(i + 1) % width], work);
+        }
+    };
+    auto sum = [&]() {
+        uint64_t s = 0;
+        for (size_t i = 0; i < width; ++i)
+            s += values[(depth - 1) * width + i];
+        return s;
+    };
+
+    recompute();
+    uint64_t checksum = sum();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t u = 0; u < updates; ++u)
+    {
+        values[changes[2 * u] % width] = changes[2 * u + 1];
+        recompute();
+        checksum += sum();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count() / updates, (double)(width * (depth - 1)), checksum};
+}
+
+int main(int argc, char *argv[])
+{
+    size_t width = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    size_t depth = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100;
+    int work = argc > 3 ? atoi(argv[3]) : 100;
+    size_t updates = argc > 4 ? strtoul(argv[4], nullptr, 10) : 20;
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> changes(2 * updates);
+    for (auto &c : changes)
+        c = rng() % 1000000;
+
+    printf("%zu nodes (%zu x %zu), %d rounds of work per node, %zu updates\n", width * depth, width, depth, work, updates);
+    for (bool max : {false, true})
+    {
+        Result full = Full(max, width, depth, work, updates, changes);
+        Result inc = Incremental(max, width, depth, work, updates, changes);
+        printf("%-5s full: %10.1f us/update, %8.0f nodes/update | incremental: %10.1f us/update, %8.0f nodes/update | %.1fx%s\n",
+               max ? "max" : "hash", full.usPerUpdate, full.recomputedPerUpdate, inc.usPerUpdate, inc.recomputedPerUpdate,
+               full.usPerUpdate / inc.usPerUpdate, full.checksum == inc.checksum ? "" : "  MISMATCH");
+    }
+    return 0;
+}
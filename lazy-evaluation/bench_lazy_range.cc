@@ -0,0 +1,198 @@
+//
+// 惰性序列对比每步生成一个 vector 的写法
+//
+// 用法: ./bench-lazy-range [n] [lines]
+//  1. 整数流水线：0..n-1(默认1亿) -> map -> filter -> map -> take(一半) -> 求和；
+//     vector 写法每一步都把结果存进一个新的 std::vector<uint64_t>，另外给出手写成一个循环的时间作为参照。
+//  2. 文本流水线：lines 行(默认100万)数字文本，逐行读取 -> 转成整数 -> 去掉奇数 -> 每64个一组求和 -> 取最大值；
+//     vector 写法先把所有行读进 vector<string>，再一步步转换。
+// 两种写法的结果要一致。最后用小例子检查 generate/zip/chunk/take 的行为。
+//
+
+#include "lazy_range.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 与 iterator-for/02input_iterator.cc 中的 istream_line_reader 相同
+class istream_line_reader
+{
+public:
+    class iterator
+    {
+    public:
+        typedef ptrdiff_t difference_type;
+        typedef std::string value_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+        typedef std::input_iterator_tag iterator_category;
+
+        iterator() noexcept : stream_(nullptr) {}
+        explicit iterator(std::istream &is) : stream_(&is) { ++*this; }
+        reference operator*() const noexcept { return line_; }
+        pointer operator->() const noexcept { return &line_; }
+        iterator &operator++()
+        {
+            std::getline(*stream_, line_);
+            if (!*stream_)
+                stream_ = nullptr;
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const noexcept { return stream_ == rhs.stream_; }
+        bool operator!=(const iterator &rhs) const noexcept { return !operator==(rhs); }
+
+    private:
+        std::istream *stream_;
+        std::string line_;
+    };
+
+    explicit istream_line_reader(std::istream &is) noexcept : stream_(&is) {}
+    iterator begin() { return iterator(*stream_); }
+    iterator end() const noexcept { return iterator(); }
+
+private:
+    std::istream *stream_;
+};
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t Scramble(uint64_t x) { return x * x ^ (x >> 3); }
+static bool Keep(uint64_t x) { return x % 3 != 0; }
+static uint64_t Scale(uint64_t x) { return x * 7 + 1; }
+
+static uint64_t LazyNumbers(uint64_t n)
+{
+    auto s = seq::iota<uint64_t>(0, n) | seq::map(Scramble) | seq::filter(Keep) | seq::map(Scale) | seq::take(n / 2);
+    return seq::fold(s, uint64_t(0), std::plus<>());
+}
+
+// 手写的单个循环，作为参照
+static uint64_t LoopNumbers(uint64_t n)
+{
+    uint64_t sum = 0, taken = 0;
+    for (uint64_t i = 0; i < n && taken < n / 2; ++i)
+    {
+        uint64_t v = Scramble(i);
+        if (Keep(v))
+            sum += Scale(v), ++taken;
+    }
+    return sum;
+}
+
+static uint64_t EagerNumbers(uint64_t n, size_t &bytes)
+{
+    std::vector<uint64_t> input(n);
+    std::iota(input.begin(), input.end(), uint64_t(0));
+    std::vector<uint64_t> scrambled(n);
+    std::transform(input.begin(), input.end(), scrambled.begin(), Scramble);
+    std::vector<uint64_t> kept;
+    std::copy_if(scrambled.begin(), scrambled.end(), std::back_inserter(kept), Keep);
+    std::vector<uint64_t> scaled(kept.size());
+    std::transform(kept.begin(), kept.end(), scaled.begin(), Scale);
+    scaled.resize(std::min<size_t>(scaled.size(), n / 2));
+    bytes = (input.capacity() + scrambled.capacity() + kept.capacity() + scaled.capacity()) * sizeof(uint64_t);
+    return std::accumulate(scaled.begin(), scaled.end(), uint64_t(0));
+}
+
+static long LazyLines(std::istream &is)
+{
+    auto s = seq::from(istream_line_reader(is)) | seq::map([](const std::string &line) { return std::stol(line); }) |
+             seq::filter([](long v) { return v % 2 == 0; }) | seq::chunk(64) |
+             seq::map([](const std::vector<long> &group) { return std::accumulate(group.begin(), group.end(), 0L); });
+    return seq::fold(s, 0L, [](long a, long b) { return std::max(a, b); });
+}
+
+static long EagerLines(std::istream &is)
+{
+    std::vector<std::string> lines;
+    for (const std::string &line : istream_line_reader(is))
+        lines.push_back(line);
+    std::vector<long> values;
+    for (const std::string &line : lines)
+        values.push_back(std::stol(line));
+    std::vector<long> even;
+    std::copy_if(values.begin(), values.end(), std::back_inserter(even), [](long v) { return v % 2 == 0; });
+    std::vector<long> sums;
+    for (size_t i = 0; i < even.size(); i += 64)
+        sums.push_back(std::accumulate(even.begin() + i, even.begin() + std::min(i + 64, even.size()), 0L));
+    return sums.empty() ? 0 : *std::max_element(sums.begin(), sums.end());
+}
+
+static bool Check(const char *what, bool ok)
+{
+    printf("%-44s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000000;
+    size_t lineCount = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t lazySum = LazyNumbers(n);
+    double lazyMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    uint64_t loopSum = LoopNumbers(n);
+    double loopMs = MsSince(start);
+    size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    uint64_t eagerSum = EagerNumbers(n, bytes);
+    double eagerMs = MsSince(start);
+    printf("numbers, n=%llu: lazy %8.1f ms | hand loop %8.1f ms | vector %8.1f ms, %6.0f MB intermediate | %.1fx%s\n",
+           (unsigned long long)n, lazyMs, loopMs, eagerMs, bytes / 1048576.0, eagerMs / lazyMs,
+           lazySum == eagerSum && loopSum == eagerSum ? "" : "  MISMATCH");
+
+    std::string text;
+    uint64_t x = 88172645463325252ULL;
+    for (size_t i = 0; i < lineCount; ++i)
+    {
+        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+        text += std::to_string(x % 1000000) + '\n';
+    }
+    std::istringstream lazyInput(text), eagerInput(text);
+    start = std::chrono::steady_clock::now();
+    long lazyMax = LazyLines(lazyInput);
+    lazyMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    long eagerMax = EagerLines(eagerInput);
+    eagerMs = MsSince(start);
+    printf("lines, %zu lines: lazy %8.1f ms | vector %8.1f ms | %.1fx%s\n", lineCount, lazyMs, eagerMs, eagerMs / lazyMs,
+           lazyMax == eagerMax ? "" : "  MISMATCH");
+
+    bool ok = true;
+    std::istringstream is("1\n2\n3\n4\n5\n");
+    auto firstThree = seq::to_vector(seq::from(istream_line_reader(is)) | seq::take(3));
+    std::string rest;
+    std::getline(is, rest);
+    ok &= Check("take(3) over a stream leaves line 4 unread", firstThree == std::vector<std::string>{"1", "2", "3"} && rest == "4");
+
+    int calls = 0;
+    auto squares = seq::iota(1) | seq::map([&](int v) { ++calls; return v * v; }) | seq::filter([](int v) { return v % 2; }) |
+                   seq::take(4);
+    ok &= Check("filter after map evaluates map once", seq::to_vector(squares) == std::vector<int>{1, 9, 25, 49} && calls == 7);
+
+    int dot = 0;
+    auto fib = seq::generate([a = 0, b = 1]() mutable { int r = a; a = b; b += r; return r; });
+    auto indexed = seq::iota(0) | seq::zip(fib) | seq::take(6);
+    for (const auto &[i, f] : indexed)
+        dot += i * f;
+    ok &= Check("zip with generate", dot == 0 * 0 + 1 * 1 + 2 * 1 + 3 * 2 + 4 * 3 + 5 * 5);
+
+    std::vector<int> source{1, 2, 3, 4, 5, 6, 7};
+    auto groups = seq::from(source) | seq::chunk(3) | seq::map([](const std::vector<int> &g) { return g.size(); });
+    ok &= Check("chunk keeps the short last group", seq::to_vector(groups) == std::vector<size_t>{3, 3, 1});
+    ok &= Check("a view can be iterated twice", seq::count(groups) == 3 && seq::count(groups) == 3);
+    return ok ? 0 : 1;
+}
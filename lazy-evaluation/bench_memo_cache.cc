@@ -0,0 +1,141 @@
+//
+// 按参数缓存函数结果：Zipf 分布下的命中率和开销
+//
+// 用法: ./bench-memo-cache [lookups] [universe] [threads]
+// 键按 Zipf 分布抽取(排名第k的键出现的概率正比于 1/k^s)，键空间 universe 个(默认100万)，共 lookups 次查询(默认200万)。
+//  1. 命中率：不同 s 和容量下 lru_cache 与 clock_cache 的命中率，以及每次查询的平均时间(包装的是 numeric/factor.h 的 gcd)；
+//  2. gcd 本身很便宜，缓存反而更慢；换成编译正则(1000个模式，缓存64个)看缓存省下多少；
+//  3. threads 个线程(默认4)同时查询：只有1片的 sharded_cache(等于一把大锁)对比默认分片。
+//
+
+#include "memo_cache.hpp"
+#include "../numeric/factor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 按 Zipf 分布预先生成查询序列，排名打乱后映射到键，避免小的键总是热点
+static std::vector<uint32_t> ZipfKeys(size_t count, size_t universe, double s, uint64_t seed)
+{
+    std::vector<double> cdf(universe);
+    double sum = 0;
+    for (size_t k = 0; k < universe; ++k)
+        cdf[k] = sum += 1.0 / std::pow(double(k + 1), s);
+    std::vector<uint32_t> rankToKey(universe);
+    for (size_t k = 0; k < universe; ++k)
+        rankToKey[k] = k;
+    std::mt19937_64 rng(seed);
+    std::shuffle(rankToKey.begin(), rankToKey.end(), rng);
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<uint32_t> keys(count);
+    for (auto &key : keys)
+        key = rankToKey[std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin()];
+    return keys;
+}
+
+// 键映射成一对数，gcd 的两个参数
+static uint64_t ArgA(uint32_t key) { return (uint64_t(key) * 2654435761u) % 1000000007 * 12; }
+static uint64_t ArgB(uint32_t key) { return (uint64_t(key) * 40503u + 17) % 998244353 * 18; }
+
+static double NsPer(std::chrono::steady_clock::time_point start, size_t n)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+template <template <typename, typename, typename> class Cache> static void HitRate(const std::vector<uint32_t> &keys, size_t capacity, uint64_t expect)
+{
+    auto cached = memoize<Cache>(gcd, capacity);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (uint32_t key : keys)
+        sum += cached(ArgA(key), ArgB(key));
+    double ns = NsPer(start, keys.size());
+    printf("  %6.2f%% %6.0f ns%s |", 100 * cached.cache().stats().hit_rate(), ns, sum == expect ? "" : " MISMATCH");
+}
+
+static std::shared_ptr<const std::regex> Compile(const std::string &pattern)
+{
+    return std::make_shared<const std::regex>(pattern);
+}
+
+static std::string Pattern(uint32_t id)
+{
+    return "(metric|counter)_" + std::to_string(id) + "_[a-z]+_(total|count|sum)";
+}
+
+int main(int argc, char *argv[])
+{
+    size_t lookups = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+    size_t universe = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+
+    printf("%zu lookups over %zu keys\n", lookups, universe);
+    for (double s : {0.8, 0.99, 1.2})
+    {
+        std::vector<uint32_t> keys = ZipfKeys(lookups, universe, s, 42);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t expect = 0;
+        for (uint32_t key : keys)
+            expect += gcd(ArgA(key), ArgB(key));
+        printf("s=%.2f  uncached gcd %.0f ns\n", s, NsPer(start, keys.size()));
+        for (size_t capacity : {universe / 1000, universe / 100, universe / 10})
+        {
+            printf("  capacity %7zu: lru", capacity);
+            HitRate<lru_cache>(keys, capacity, expect);
+            printf(" clock");
+            HitRate<clock_cache>(keys, capacity, expect);
+            printf("\n");
+        }
+    }
+
+    // 代价高的函数：编译正则
+    {
+        std::vector<uint32_t> ids = ZipfKeys(20000, 1000, 0.99, 7);
+        std::vector<std::string> patterns;
+        for (uint32_t id : ids)
+            patterns.push_back(Pattern(id));
+        auto start = std::chrono::steady_clock::now();
+        size_t marks = 0;
+        for (const auto &p : patterns)
+            marks += Compile(p)->mark_count();
+        double uncached = NsPer(start, patterns.size()) / 1000;
+        auto compile = memoize<lru_cache>(Compile, 64);
+        start = std::chrono::steady_clock::now();
+        for (const auto &p : patterns)
+            marks -= compile(p)->mark_count();
+        double cached = NsPer(start, patterns.size()) / 1000;
+        printf("regex, 1000 patterns, s=0.99, capacity 64: uncached %.2f us, cached %.2f us (hit %.1f%%)%s\n", uncached, cached,
+               100 * compile.cache().stats().hit_rate(), marks ? " MISMATCH" : "");
+    }
+
+    // 多线程
+    std::vector<uint32_t> keys = ZipfKeys(lookups, universe, 0.99, 99);
+    for (size_t shards : {size_t(1), size_t(0)})
+    {
+        auto cached = memoize<sharded_lru_cache>(gcd, universe / 100, shards);
+        std::atomic<uint64_t> sum(0);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+            workers.emplace_back([&, t]() {
+                uint64_t local = 0;
+                for (size_t i = t; i < keys.size(); i += threads)
+                    local += cached(ArgA(keys[i]), ArgB(keys[i]));
+                sum += local;
+            });
+        for (auto &worker : workers)
+            worker.join();
+        printf("%d threads, sharded_lru_cache with %3zu shards: %6.0f ns/lookup, hit %.2f%%\n", threads,
+               cached.cache().shard_count(), NsPer(start, keys.size()), 100 * cached.cache().stats().hit_rate());
+    }
+    return 0;
+}
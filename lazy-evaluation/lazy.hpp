@@ -5,7 +5,12 @@
 #ifndef RESTUDYCPP_LAZY_H
 #define RESTUDYCPP_LAZY_H
 
-#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 /*
  * 所谓惰性求值(lazy evaluation)是指表达式不在它被绑定到变量之后就立即求值，而是在我们需要到时候才会对其求值。
  * 与之相对应的是及早求值(eager evaluation)，大多数语言采用的都是这种求值方式。
@@ -16,53 +21,105 @@
  * 实现惰性求值需要有模板元编程基础
  *
  * 三部曲: 提出初始化方案，检查是否初始化，返回正确值
+ *
+ * 早先的版本把初始化方案存成 std::function<T()>，值存成 T 成员：
+ *  - std::function 可能要堆分配，每次求值是一次间接调用；
+ *  - T 必须能默认构造；
+ *  - 两个线程同时第一次取值会重复求值，互相覆盖。
+ * 现在直接以可调用对象的类型 F 作模板参数，值放在对齐的原始存储里，第一次取值时才构造，
+ * 用一个原子状态保证只求值一次。已经求过值之后，取值只是一次 acquire 读(x86上就是普通的读)加一次比较。
+ *
+ *  auto pi = lazy([]() { return acos(-1.0); });   // C++17 类模板实参推导，也可以用 make_lazy
+ *
+ * 并发第一次取值时，只有一个线程执行初始化方案，其它线程让出CPU等它完成；
+ * 初始化方案抛出异常时状态回到未初始化，异常传给调用者，下次取值重新求值(与 std::call_once 相同)。
+ * 拷贝只拷贝初始化方案，不拷贝已经求出来的值，与早先的版本一致；lambda 不能赋值，所以不提供赋值运算符。
  * */
-template <typename T> class lazy
+template <typename F> class lazy
 {
-private:
-    T value_;
-    std::function<T()> policy_;
-    bool initialized_;
-    static T default_policy()
+public:
+    using value_type = std::decay_t<std::invoke_result_t<F &>>;
+
+    explicit lazy(F policy) : policy_(std::move(policy)) {}
+    lazy(const lazy &_) : policy_(_.policy_) {}
+    lazy(lazy &&_) : policy_(std::move(_.policy_)) {}
+    lazy &operator=(const lazy &) = delete;
+
+    ~lazy()
     {
-        throw std::runtime_error("No lazy initiation policy given.");
+        if (state_.load(std::memory_order_relaxed) == kReady)
+            ptr()->~value_type();
     }
-public:
-    lazy() : policy_(default_policy), initialized_(false) {}
-    lazy(std::function<T()> _) : policy_(_), initialized_(false) {}
-    lazy(const lazy<T>& _) : policy_(_.policy_), initialized_(false) {}
 
-    lazy<T>& operator=(const lazy<T>& _)
+    value_type &get_value()
     {
-        policy_ = _.policy_;
-        initialized_ = false;
-        return *this;
+        if (state_.load(std::memory_order_acquire) == kReady)
+            return *ptr();
+        return initialize();
     }
 
-    T& get_value()
+    bool initialized() const { return state_.load(std::memory_order_acquire) == kReady; }
+
+    // 返回的是值的引用，外部甚至还可以更新这个值: pi() = 3;
+    value_type &operator()() { return get_value(); }
+
+    operator value_type() { return get_value(); }
+
+private:
+    enum : uint8_t
+    {
+        kEmpty,
+        kBusy,
+        kReady
+    };
+
+    value_type *ptr() { return std::launder(reinterpret_cast<value_type *>(&storage_)); }
+
+    // 冷路径，不内联，热路径只剩一次读和一次比较
+    __attribute__((noinline)) value_type &initialize()
     {
-        if (!initialized_)
+        while (true)
         {
-            value_ = policy_();
-            initialized_ = true;
+            uint8_t state = kEmpty;
+            if (state_.compare_exchange_strong(state, kBusy, std::memory_order_acquire))
+            {
+                try
+                {
+                    ::new (static_cast<void *>(&storage_)) value_type(policy_());
+                }
+                catch (...)
+                {
+                    state_.store(kEmpty, std::memory_order_release);
+                    throw;
+                }
+                state_.store(kReady, std::memory_order_release);
+                return *ptr();
+            }
+            if (state == kReady)
+                return *ptr();
+            // 别的线程正在求值
+            while (state_.load(std::memory_order_acquire) == kBusy)
+                std::this_thread::yield();
         }
-        return value_;
     }
 
-    // T()返回的是 value_地址 而不是 lambda 表达式，外部甚至还可以更新这个值: T() = 123;
-    T& operator()() { return get_value(); }
-
-    // T本身存储的是 lambda 表达式;
-    operator T() { return get_value(); }
+    std::aligned_storage_t<sizeof(value_type), alignof(value_type)> storage_;
+    std::atomic<uint8_t> state_{kEmpty};
+    F policy_;
 };
 
+template <typename F> lazy<std::decay_t<F>> make_lazy(F &&policy)
+{
+    return lazy<std::decay_t<F>>(std::forward<F>(policy));
+}
+
 /*
 #include "lazy.hpp"
 #include <math.h>
 #include <iostream>
 
 int main() {
-    auto pi = lazy<double>([]() {
+    auto pi = lazy([]() {
         std::cout << "惰性求值，只打印一次" << std::endl;
         return acos(-1.0);
     });
@@ -0,0 +1,259 @@
+//
+// 增量计算图：可以失效的惰性值
+//
+
+#ifndef RESTUDYCPP_LAZY_GRAPH_H
+#define RESTUDYCPP_LAZY_GRAPH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+/*
+ * lazy.hpp 里的 lazy 只求一次值，之后不能失效，依赖的输入变了也不会重新计算。
+ * 这里把惰性值组织成一张图：
+ *  - 输入格子(input_cell)：外部 set 新值；
+ *  - 派生格子(derived_cell)：由一个可调用对象计算，计算过程中 get 了哪些格子，就自动记为它的依赖，
+ *    每次重新计算都重新记录(依赖可以随分支变化)。
+ *
+ * 输入 set 了不同的值，沿着被依赖的边把下游的格子标记为脏，只标记不计算；
+ * 脏的格子下次 get 时才处理：先依次把记录的依赖处理干净，看有没有哪个依赖在自己上次计算之后真的变过，
+ * 没有就不用重新算(比如上游重新算出来的值和原来相等)，有才重新计算。
+ * 所以一次修改的代价只和受影响、并且真正被读到的那部分格子有关，与整张图的大小无关。
+ *
+ * 不变式：一个格子是脏的，它所有(直接和间接)下游也都是脏的，所以标记时遇到已经脏的格子就可以停下。
+ *
+ *  lazy_graph g;
+ *  auto &a = g.input(1.0);
+ *  auto &b = g.input(2.0);
+ *  auto &sum = g.derived([&]() { return a.get() + b.get(); });
+ *  sum.get();   // 3，计算一次
+ *  a.set(5.0);  // 只把 sum 标记为脏
+ *  sum.get();   // 7，重新计算
+ *
+ * 值类型需要能拷贝/移动，并且支持 ==(用来判断值有没有真的变)。
+ * 不是线程安全的：同一张图只在一个线程里使用。依赖不能成环。
+ * get 沿依赖递归，递归深度等于图的深度。
+ * */
+class lazy_graph;
+
+class cell_node
+{
+public:
+    cell_node(const cell_node &) = delete;
+    cell_node &operator=(const cell_node &) = delete;
+    virtual ~cell_node() {}
+
+    bool dirty() const { return dirty_; }
+    size_t dependency_count() const { return dependencies_.size(); }
+    size_t dependent_count() const { return dependents_.size(); }
+
+protected:
+    // 派生格子创建时是脏的，第一次读取时计算
+    cell_node(lazy_graph &graph, bool dirty) : graph_(graph), dirty_(dirty) {}
+
+    // 读取前调用：记录依赖，必要时重新计算
+    void before_read();
+    // 值变了：更新版本号，把下游标记为脏
+    void changed();
+
+    // 派生格子重新计算，返回值是否变了
+    virtual bool recompute() { return false; }
+
+    lazy_graph &graph_;
+
+private:
+    friend class lazy_graph;
+
+    void bring_up_to_date();
+    void clear_dependencies();
+
+    std::vector<cell_node *> dependencies_; // 上次计算时读过的格子，按读取顺序
+    std::vector<cell_node *> dependents_;   // 读过自己的格子
+    uint64_t changed_at_ = 0;  // 值最后一次变化时图的版本号
+    uint64_t verified_at_ = 0; // 最后一次确认自己是最新的时图的版本号
+    bool dirty_;
+};
+
+template <typename T> class cell : public cell_node
+{
+public:
+    const T &get()
+    {
+        before_read();
+        return *value_;
+    }
+
+protected:
+    cell(lazy_graph &graph, bool dirty) : cell_node(graph, dirty) {}
+
+    std::optional<T> value_;
+};
+
+template <typename T> class input_cell : public cell<T>
+{
+public:
+    input_cell(lazy_graph &graph, T value) : cell<T>(graph, false) { this->value_.emplace(std::move(value)); }
+
+    // 值相等时什么都不做
+    void set(T value)
+    {
+        if (*this->value_ == value)
+            return;
+        *this->value_ = std::move(value);
+        this->changed();
+    }
+};
+
+template <typename T, typename F> class derived_cell : public cell<T>
+{
+public:
+    derived_cell(lazy_graph &graph, F policy) : cell<T>(graph, true), policy_(std::move(policy)) {}
+
+private:
+    virtual bool recompute();
+
+    F policy_;
+};
+
+class lazy_graph
+{
+public:
+    lazy_graph() {}
+    lazy_graph(const lazy_graph &) = delete;
+    lazy_graph &operator=(const lazy_graph &) = delete;
+
+    template <typename T> input_cell<std::decay_t<T>> &input(T &&value)
+    {
+        auto *p = new input_cell<std::decay_t<T>>(*this, std::forward<T>(value));
+        cells_.emplace_back(p);
+        return *p;
+    }
+
+    template <typename F> derived_cell<std::decay_t<std::invoke_result_t<F &>>, F> &derived(F policy)
+    {
+        auto *p = new derived_cell<std::decay_t<std::invoke_result_t<F &>>, F>(*this, std::move(policy));
+        cells_.emplace_back(p);
+        return *p;
+    }
+
+    size_t size() const { return cells_.size(); }
+    // 累计重新计算的次数，用于观察增量计算省掉了多少
+    uint64_t recomputations() const { return recomputations_; }
+
+private:
+    friend class cell_node;
+
+    std::vector<std::unique_ptr<cell_node>> cells_;
+    cell_node *evaluating_ = nullptr; // 正在计算的派生格子，读到的格子记为它的依赖
+    uint64_t version_ = 1;
+    uint64_t recomputations_ = 0;
+    std::vector<cell_node *> stack_; // 标记脏时用的栈，复用避免每次分配
+};
+
+inline void cell_node::before_read()
+{
+    if (graph_.evaluating_)
+    {
+        // 同一次计算里连续读同一个格子只记一次
+        std::vector<cell_node *> &deps = graph_.evaluating_->dependencies_;
+        if (deps.empty() || deps.back() != this)
+        {
+            deps.push_back(this);
+            dependents_.push_back(graph_.evaluating_);
+        }
+    }
+    if (dirty_)
+        bring_up_to_date();
+}
+
+inline void cell_node::changed()
+{
+    changed_at_ = ++graph_.version_;
+    verified_at_ = changed_at_;
+
+    std::vector<cell_node *> &stack = graph_.stack_;
+    stack.assign(dependents_.begin(), dependents_.end());
+    while (!stack.empty())
+    {
+        cell_node *node = stack.back();
+        stack.pop_back();
+        if (node->dirty_)
+            continue;
+        node->dirty_ = true;
+        stack.insert(stack.end(), node->dependents_.begin(), node->dependents_.end());
+    }
+}
+
+inline void cell_node::bring_up_to_date()
+{
+    // 从来没算过的格子 changed_at_ 为0，直接计算
+    bool need = changed_at_ == 0;
+    if (!need)
+    {
+        // 依赖按上次读取的顺序处理，一旦发现有依赖变过就停下重新计算，后面的依赖这次可能根本不会读
+        for (cell_node *dep : dependencies_)
+        {
+            if (dep->dirty_)
+                dep->bring_up_to_date();
+            if (dep->changed_at_ > verified_at_)
+            {
+                need = true;
+                break;
+            }
+        }
+    }
+
+    if (need)
+    {
+        clear_dependencies();
+        cell_node *outer = graph_.evaluating_;
+        graph_.evaluating_ = this;
+        bool changed;
+        try
+        {
+            changed = recompute();
+        }
+        catch (...)
+        {
+            // 保持脏的状态，下次读取重新计算
+            graph_.evaluating_ = outer;
+            throw;
+        }
+        graph_.evaluating_ = outer;
+        ++graph_.recomputations_;
+        if (changed)
+            changed_at_ = graph_.version_;
+    }
+    verified_at_ = graph_.version_;
+    dirty_ = false;
+}
+
+inline void cell_node::clear_dependencies()
+{
+    for (cell_node *dep : dependencies_)
+    {
+        auto &list = dep->dependents_;
+        auto it = std::find(list.begin(), list.end(), this);
+        if (it != list.end())
+        {
+            *it = list.back();
+            list.pop_back();
+        }
+    }
+    dependencies_.clear();
+}
+
+template <typename T, typename F> bool derived_cell<T, F>::recompute()
+{
+    T value = policy_();
+    if (this->value_ && *this->value_ == value)
+        return false;
+    this->value_.emplace(std::move(value));
+    return true;
+}
+
+#endif //RESTUDYCPP_LAZY_GRAPH_H
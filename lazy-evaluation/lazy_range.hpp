@@ -0,0 +1,448 @@
+//
+// 惰性序列：把 map/filter/take/chunk/zip 串成一个循环
+//
+
+#ifndef RESTUDYCPP_LAZY_RANGE_H
+#define RESTUDYCPP_LAZY_RANGE_H
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+/*
+ * lazy.hpp 只管单个延迟求值的值。处理一长串数据时，常见的写法是每一步变换都生成一个新的 std::vector，
+ * 数据量大时光是中间结果的分配和来回读写内存就比计算本身还慢。
+ *
+ * 这里的序列也是惰性的：串起来时什么都不算，遍历时每次从源头拉一个元素，依次经过各个阶段，
+ * 各阶段都是模板，编译器能把它们内联成一个循环，没有中间容器，也不分配内存(chunk 的缓冲区只在开始时分配一次)。
+ *
+ *  源头：
+ *      seq::from(range)       任何有 begin()/end() 的东西，包括 istream_line_reader 这种只能读一遍的输入迭代器；
+ *                             左值按引用保存，右值搬进来保存
+ *      seq::iota(first[, last])  整数序列，不给 last 就是无穷的
+ *      seq::generate(f)       每次调用 f() 得到下一个元素，无穷
+ *  变换(用 | 串起来)：
+ *      seq::map(f)  seq::filter(pred)  seq::take(n)
+ *      seq::chunk(n)          每 n 个打成一组，元素是 const std::vector<T> &，指向内部复用的缓冲区，只在下一组之前有效
+ *      seq::zip(other)        和另一个序列按位置配对，元素是 std::pair，任一方结束就结束
+ *  取结果：
+ *      range-for 直接遍历；seq::fold(s, init, op)、seq::count(s)、seq::to_vector(s)
+ *
+ *  auto s = seq::from(istream_line_reader(ifs))
+ *           | seq::map([](const std::string &line) { return std::stol(line); })
+ *           | seq::filter([](long v) { return v % 2 == 0; })
+ *           | seq::take(100);
+ *  long sum = seq::fold(s, 0L, std::plus<>());
+ *
+ * 每个阶段内部是一个游标(cursor)：done() 是否已经结束，get() 取当前元素，next() 前进一个。
+ * take 取够之后不会再向上游多拉一个元素，从输入流读取时不会多消耗一行。
+ * filter 在上游返回临时值(比如前面接着 map)时把当前元素缓存一份，保证 map 对每个元素只算一次。
+ * 序列对象本身可以遍历多次，每次遍历都从头开始(源头是只能读一遍的输入流时除外)。
+ * */
+namespace seq
+{
+    struct end_sentinel
+    {
+    };
+
+    // 所有序列的基类，用于识别 | 左边的对象
+    struct view_base
+    {
+    };
+
+    // 把游标包装成迭代器，供 range-for 使用
+    template <typename Cursor> class cursor_iterator
+    {
+    public:
+        using value_type = std::decay_t<decltype(std::declval<Cursor &>().get())>;
+        using reference = decltype(std::declval<Cursor &>().get());
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        explicit cursor_iterator(Cursor cursor) : cursor_(std::move(cursor)) {}
+
+        reference operator*() { return cursor_.get(); }
+        cursor_iterator &operator++()
+        {
+            cursor_.next();
+            return *this;
+        }
+        bool operator!=(end_sentinel) const { return !cursor_.done(); }
+        bool operator==(end_sentinel) const { return cursor_.done(); }
+
+    private:
+        Cursor cursor_;
+    };
+
+    template <typename Derived> struct view : view_base
+    {
+        auto begin() const { return cursor_iterator<decltype(static_cast<const Derived *>(this)->cursor())>(static_cast<const Derived *>(this)->cursor()); }
+        end_sentinel end() const { return {}; }
+    };
+
+    template <typename View> using cursor_t = decltype(std::declval<const View &>().cursor());
+
+    // ==================源头==================
+    template <typename Range> class from_view : public view<from_view<Range>>
+    {
+    public:
+        explicit from_view(Range &&range) : range_(store(std::forward<Range>(range))) {}
+
+        class cursor_type
+        {
+        public:
+            using iterator = decltype(std::begin(std::declval<std::remove_reference_t<Range> &>()));
+            using sentinel = decltype(std::end(std::declval<std::remove_reference_t<Range> &>()));
+
+            cursor_type(iterator it, sentinel last) : it_(std::move(it)), last_(std::move(last)) {}
+            bool done() const { return !(it_ != last_); }
+            decltype(auto) get() { return *it_; }
+            void next() { ++it_; }
+
+        private:
+            iterator it_;
+            sentinel last_;
+        };
+
+        cursor_type cursor() const
+        {
+            auto &range = get_range();
+            return cursor_type(std::begin(range), std::end(range));
+        }
+
+    private:
+        static constexpr bool by_reference = std::is_lvalue_reference_v<Range>;
+
+        static decltype(auto) store(Range &&range)
+        {
+            if constexpr (by_reference)
+                return &range;
+            else
+                return std::move(range);
+        }
+
+        // 输入流一类的范围 begin() 本身会读数据，不是 const 成员函数，所以保存的范围是 mutable 的
+        std::remove_reference_t<Range> &get_range() const
+        {
+            if constexpr (by_reference)
+                return *range_;
+            else
+                return range_;
+        }
+
+        mutable std::conditional_t<by_reference, std::remove_reference_t<Range> *, Range> range_;
+    };
+
+    template <typename Range> from_view<Range> from(Range &&range) { return from_view<Range>(std::forward<Range>(range)); }
+
+    template <typename T> class iota_view : public view<iota_view<T>>
+    {
+    public:
+        iota_view(T first, std::optional<T> last) : first_(first), last_(last) {}
+
+        class cursor_type
+        {
+        public:
+            cursor_type(T cur, std::optional<T> last) : cur_(cur), last_(last ? *last : T()), bounded_(last.has_value()) {}
+            bool done() const { return bounded_ && !(cur_ < last_); }
+            T get() const { return cur_; }
+            void next() { ++cur_; }
+
+        private:
+            T cur_;
+            T last_;
+            bool bounded_;
+        };
+
+        cursor_type cursor() const { return cursor_type(first_, last_); }
+
+    private:
+        T first_;
+        std::optional<T> last_;
+    };
+
+    template <typename T> iota_view<T> iota(T first) { return iota_view<T>(first, std::nullopt); }
+    template <typename T> iota_view<T> iota(T first, T last) { return iota_view<T>(first, last); }
+
+    template <typename F> class generate_view : public view<generate_view<F>>
+    {
+    public:
+        explicit generate_view(F f) : f_(std::move(f)) {}
+
+        class cursor_type
+        {
+        public:
+            using value_type = std::decay_t<std::invoke_result_t<F &>>;
+
+            explicit cursor_type(F f) : f_(std::move(f)), value_(f_()) {}
+            bool done() const { return false; }
+            const value_type &get() const { return value_; }
+            void next() { value_ = f_(); }
+
+        private:
+            F f_;
+            value_type value_;
+        };
+
+        // 每次遍历拷贝一份生成函数，带状态的生成函数每次都从头开始
+        cursor_type cursor() const { return cursor_type(f_); }
+
+    private:
+        F f_;
+    };
+
+    template <typename F> generate_view<F> generate(F f) { return generate_view<F>(std::move(f)); }
+
+    // ==================变换==================
+    template <typename Parent, typename F> class map_view : public view<map_view<Parent, F>>
+    {
+    public:
+        map_view(Parent parent, F f) : parent_(std::move(parent)), f_(std::move(f)) {}
+
+        class cursor_type
+        {
+        public:
+            cursor_type(cursor_t<Parent> parent, const F *f) : parent_(std::move(parent)), f_(f) {}
+            bool done() const { return parent_.done(); }
+            decltype(auto) get() { return (*f_)(parent_.get()); }
+            void next() { parent_.next(); }
+
+        private:
+            cursor_t<Parent> parent_;
+            const F *f_;
+        };
+
+        cursor_type cursor() const { return cursor_type(parent_.cursor(), &f_); }
+
+    private:
+        Parent parent_;
+        F f_;
+    };
+
+    template <typename Parent, typename Pred> class filter_view : public view<filter_view<Parent, Pred>>
+    {
+    public:
+        filter_view(Parent parent, Pred pred) : parent_(std::move(parent)), pred_(std::move(pred)) {}
+
+        class cursor_type
+        {
+            using parent_reference = decltype(std::declval<cursor_t<Parent> &>().get());
+            using value_type = std::decay_t<parent_reference>;
+            // 上游返回引用时直接再取一次；返回临时值时缓存一份，免得前面的 map 再算一遍。
+            // 不缓存指针：游标会被移动，指向上游游标内部的指针会失效
+            static constexpr bool by_reference = std::is_reference_v<parent_reference>;
+
+        public:
+            cursor_type(cursor_t<Parent> parent, const Pred *pred) : parent_(std::move(parent)), pred_(pred) { settle(); }
+            bool done() const { return parent_.done(); }
+            decltype(auto) get()
+            {
+                if constexpr (by_reference)
+                    return parent_.get();
+                else
+                    return static_cast<const value_type &>(*current_);
+            }
+            void next()
+            {
+                parent_.next();
+                settle();
+            }
+
+        private:
+            // 跳过不满足条件的元素，停在下一个满足条件的元素上
+            void settle()
+            {
+                for (; !parent_.done(); parent_.next())
+                {
+                    if constexpr (by_reference)
+                    {
+                        if ((*pred_)(static_cast<const value_type &>(parent_.get())))
+                            return;
+                    }
+                    else
+                    {
+                        current_.emplace(parent_.get());
+                        if ((*pred_)(*current_))
+                            return;
+                    }
+                }
+            }
+
+            cursor_t<Parent> parent_;
+            const Pred *pred_;
+            std::conditional_t<by_reference, bool, std::optional<value_type>> current_{};
+        };
+
+        cursor_type cursor() const { return cursor_type(parent_.cursor(), &pred_); }
+
+    private:
+        Parent parent_;
+        Pred pred_;
+    };
+
+    template <typename Parent> class take_view : public view<take_view<Parent>>
+    {
+    public:
+        take_view(Parent parent, size_t n) : parent_(std::move(parent)), n_(n) {}
+
+        class cursor_type
+        {
+        public:
+            cursor_type(cursor_t<Parent> parent, size_t n) : parent_(std::move(parent)), left_(n) {}
+            bool done() const { return left_ == 0 || parent_.done(); }
+            decltype(auto) get() { return parent_.get(); }
+            // 取够了就不再向上游拉
+            void next()
+            {
+                if (--left_)
+                    parent_.next();
+            }
+
+        private:
+            cursor_t<Parent> parent_;
+            size_t left_;
+        };
+
+        cursor_type cursor() const { return cursor_type(parent_.cursor(), n_); }
+
+    private:
+        Parent parent_;
+        size_t n_;
+    };
+
+    template <typename Parent> class chunk_view : public view<chunk_view<Parent>>
+    {
+    public:
+        chunk_view(Parent parent, size_t n) : parent_(std::move(parent)), n_(n ? n : 1) {}
+
+        class cursor_type
+        {
+        public:
+            using value_type = std::decay_t<decltype(std::declval<cursor_t<Parent> &>().get())>;
+
+            cursor_type(cursor_t<Parent> parent, size_t n) : parent_(std::move(parent)), n_(n)
+            {
+                buffer_.reserve(n_);
+                fill();
+            }
+            bool done() const { return buffer_.empty(); }
+            const std::vector<value_type> &get() const { return buffer_; }
+            void next() { fill(); }
+
+        private:
+            void fill()
+            {
+                buffer_.clear();
+                for (; buffer_.size() < n_ && !parent_.done(); parent_.next())
+                    buffer_.push_back(parent_.get());
+            }
+
+            cursor_t<Parent> parent_;
+            size_t n_;
+            std::vector<value_type> buffer_;
+        };
+
+        cursor_type cursor() const { return cursor_type(parent_.cursor(), n_); }
+
+    private:
+        Parent parent_;
+        size_t n_;
+    };
+
+    template <typename First, typename Second> class zip_view : public view<zip_view<First, Second>>
+    {
+    public:
+        zip_view(First first, Second second) : first_(std::move(first)), second_(std::move(second)) {}
+
+        class cursor_type
+        {
+        public:
+            cursor_type(cursor_t<First> first, cursor_t<Second> second) : first_(std::move(first)), second_(std::move(second)) {}
+            bool done() const { return first_.done() || second_.done(); }
+            auto get() { return std::pair<decltype(first_.get()), decltype(second_.get())>(first_.get(), second_.get()); }
+            void next()
+            {
+                first_.next();
+                second_.next();
+            }
+
+        private:
+            cursor_t<First> first_;
+            cursor_t<Second> second_;
+        };
+
+        cursor_type cursor() const { return cursor_type(first_.cursor(), second_.cursor()); }
+
+    private:
+        First first_;
+        Second second_;
+    };
+
+    // ==================用 | 串起来==================
+    template <typename F> struct map_closure
+    {
+        F f;
+        template <typename Parent> auto apply(Parent parent) const { return map_view<Parent, F>(std::move(parent), f); }
+    };
+    template <typename Pred> struct filter_closure
+    {
+        Pred pred;
+        template <typename Parent> auto apply(Parent parent) const { return filter_view<Parent, Pred>(std::move(parent), pred); }
+    };
+    struct take_closure
+    {
+        size_t n;
+        template <typename Parent> auto apply(Parent parent) const { return take_view<Parent>(std::move(parent), n); }
+    };
+    struct chunk_closure
+    {
+        size_t n;
+        template <typename Parent> auto apply(Parent parent) const { return chunk_view<Parent>(std::move(parent), n); }
+    };
+    template <typename Second> struct zip_closure
+    {
+        Second second;
+        template <typename Parent> auto apply(Parent parent) const { return zip_view<Parent, Second>(std::move(parent), second); }
+    };
+
+    template <typename F> map_closure<F> map(F f) { return {std::move(f)}; }
+    template <typename Pred> filter_closure<Pred> filter(Pred pred) { return {std::move(pred)}; }
+    inline take_closure take(size_t n) { return {n}; }
+    inline chunk_closure chunk(size_t n) { return {n}; }
+    template <typename Second, typename = std::enable_if_t<std::is_base_of_v<view_base, Second>>>
+    zip_closure<Second> zip(Second second) { return {std::move(second)}; }
+
+    template <typename View, typename Closure, typename = std::enable_if_t<std::is_base_of_v<view_base, std::decay_t<View>>>>
+    auto operator|(View &&v, const Closure &closure)
+    {
+        return closure.apply(std::decay_t<View>(std::forward<View>(v)));
+    }
+
+    // ==================取结果==================
+    template <typename View, typename T, typename Op> T fold(const View &v, T init, Op op)
+    {
+        for (auto cursor = v.cursor(); !cursor.done(); cursor.next())
+            init = op(std::move(init), cursor.get());
+        return init;
+    }
+
+    template <typename View> size_t count(const View &v)
+    {
+        size_t n = 0;
+        for (auto cursor = v.cursor(); !cursor.done(); cursor.next())
+            ++n;
+        return n;
+    }
+
+    template <typename View> auto to_vector(const View &v)
+    {
+        std::vector<std::decay_t<decltype(v.cursor().get())>> out;
+        for (auto cursor = v.cursor(); !cursor.done(); cursor.next())
+            out.push_back(cursor.get());
+        return out;
+    }
+}
+
+#endif //RESTUDYCPP_LAZY_RANGE_H
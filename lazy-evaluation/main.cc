@@ -8,7 +8,7 @@
 
 
 int main() {
-    auto pi = lazy<double>([]() {
+    auto pi = lazy([]() {
 
         std::cout << "惰性求值，只打印一次" << std::endl;
 
@@ -21,17 +21,15 @@ int main() {
 
 
 
-    auto a = lazy<int>([]() { return 1; });
-    auto b = lazy<int>([]() { return 2; });
+    auto a = lazy([]() { return 1; });
+    auto b = lazy([]() { return 2; });
     auto c = a; // 实际上只是把 []() { return 1; } 这个 lambda 存给了变量 c
     std::cout << "a= " << a() << ", b= " << b() << ", c= " << c() << std::endl;
     // => a= 1, b= 2, c= 1
     c() = 5;    // 改的是惰性求出来的值
     std::cout << "a= " << a() << ", b= " << b() << ", c= " << c() << std::endl;
     // => a= 1, b= 2, c= 5
-    b = c;  // 实际上只是把 []() { return 1; } 这个 lambda 存给了变量 b
-    std::cout << "a= " << a() << ", b= " << b() << ", c= " << c() << std::endl;
-    // => a= 1, b= 1, c= 5
+    // b = c; 编译不过：每个 lambda 是不同的类型，lazy 的类型也不同
     b() = c;
     std::cout << "a= " << a() << ", b= " << b() << ", c= " << c() << std::endl;
     // => a= 1, b= 5, c= 5
@@ -0,0 +1,388 @@
+//
+// 按参数缓存函数结果：容量有限，LRU/CLOCK 淘汰，可分片加锁并发使用
+//
+
+#ifndef RESTUDYCPP_MEMO_CACHE_H
+#define RESTUDYCPP_MEMO_CACHE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+/*
+ * lazy 只缓存一个值，而且永远不释放。代价高的纯函数(编译正则、解析配置)按参数缓存结果需要：
+ *  - 以参数为键，键的个数可能无限多，所以容量要有上限，满了淘汰一个；
+ *  - 统计命中/未命中，用来判断缓存值不值得。
+ *
+ * 只有算一次比查一次哈希表(还要拷贝键、维护淘汰顺序)贵得多的函数才值得缓存。gcd/lcm 这类几十纳秒的函数不要缓存：
+ * bench-memo-cache 里缓存过的 gcd 在各种容量、各种倾斜度下都比直接算慢 3~10 倍，命中率再高也省不回来。
+ *
+ * 三种缓存，接口相同：get_or_compute(key, compute)，命中直接返回，未命中调用 compute() 算出来放进去。
+ *  - lru_cache：哈希表 + 双向链表，命中时把条目移到链表头，淘汰链表尾，即最久没用过的；
+ *  - clock_cache：条目放在环形数组里，命中只置一个"最近用过"标记，不动链表；
+ *    淘汰时指针绕圈，遇到有标记的清掉标记跳过，遇到没标记的淘汰。命中率接近 LRU，命中的代价更低；
+ *  - sharded_cache：按键的哈希分成若干片，每片是一个 lru_cache(或 clock_cache)加一把锁，多个线程可以同时使用。
+ *    算值时不持锁，两个线程同时未命中同一个键会各算一次，对纯函数无害。
+ * 容量按条目个数计算，sharded_cache 的容量平均分给各片。
+ *
+ * memoize 把一个函数包装成带缓存的同签名可调用对象，键是参数的拷贝(多个参数时是 std::tuple)，
+ * 返回值按值返回，结果很大(比如 std::regex)时让函数返回 std::shared_ptr<const T>：
+ *
+ *  auto compile = memoize<lru_cache>([](const std::string &p) { return std::make_shared<const std::regex>(p); }, 256);
+ *  auto re = compile("[a-z]+[0-9]*");              // 编译一次
+ *  std::regex_match(s, *compile("[a-z]+[0-9]*"));   // 命中，不再编译
+ *
+ * 多个线程共用时把 lru_cache 换成 sharded_lru_cache。
+ *
+ * 函数的参数类型从函数指针或者非泛型 lambda 的 operator() 推导出来。
+ * lru_cache/clock_cache 不是线程安全的。compute 抛出的异常原样传给调用者，缓存不变。
+ * */
+
+// 键的哈希：std::hash，多个参数组成的 tuple 逐个合并
+template <typename Key> struct memo_hash : std::hash<Key>
+{
+};
+
+template <typename... Ts> struct memo_hash<std::tuple<Ts...>>
+{
+    size_t operator()(const std::tuple<Ts...> &key) const
+    {
+        return std::apply([](const auto &...parts) {
+            size_t seed = 0;
+            ((seed ^= memo_hash<std::decay_t<decltype(parts)>>()(parts) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)), ...);
+            return seed;
+        }, key);
+    }
+};
+
+// 命中/未命中/淘汰计数
+struct memo_stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    double hit_rate() const { return hits + misses ? (double)hits / (hits + misses) : 0; }
+
+    memo_stats &operator+=(const memo_stats &_)
+    {
+        hits += _.hits;
+        misses += _.misses;
+        evictions += _.evictions;
+        return *this;
+    }
+};
+
+template <typename Key, typename Value, typename Hash = memo_hash<Key>> class lru_cache
+{
+public:
+    explicit lru_cache(size_t capacity) : capacity_(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("lru_cache: capacity must be positive");
+        index_.reserve(capacity);
+    }
+
+    lru_cache(const lru_cache &) = delete;
+    lru_cache &operator=(const lru_cache &) = delete;
+
+    // 命中时返回值的指针并记为最近使用，指针在下一次 insert 之前有效
+    const Value *find(const Key &key)
+    {
+        auto it = index_.find(key);
+        if (it == index_.end())
+        {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    // 键已经存在时覆盖
+    void insert(const Key &key, Value value)
+    {
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (index_.size() == capacity_)
+        {
+            // 复用最久没用的那个链表节点，不用重新分配
+            auto last = std::prev(entries_.end());
+            index_.erase(last->first);
+            last->first = key;
+            last->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, last);
+            ++stats_.evictions;
+        }
+        else
+            entries_.emplace_front(key, std::move(value));
+        index_.emplace(key, entries_.begin());
+    }
+
+    template <typename Compute> Value get_or_compute(const Key &key, Compute &&compute)
+    {
+        if (const Value *value = find(key))
+            return *value;
+        Value value = compute();
+        insert(key, value);
+        return value;
+    }
+
+    size_t size() const { return index_.size(); }
+    size_t capacity() const { return capacity_; }
+    const memo_stats &stats() const { return stats_; }
+
+private:
+    using list_type = std::list<std::pair<Key, Value>>;
+
+    size_t capacity_;
+    list_type entries_; // 链表头是最近使用的
+    std::unordered_map<Key, typename list_type::iterator, Hash> index_;
+    memo_stats stats_;
+};
+
+template <typename Key, typename Value, typename Hash = memo_hash<Key>> class clock_cache
+{
+public:
+    explicit clock_cache(size_t capacity) : capacity_(capacity)
+    {
+        if (capacity == 0)
+            throw std::invalid_argument("clock_cache: capacity must be positive");
+        slots_.reserve(capacity);
+        index_.reserve(capacity);
+    }
+
+    clock_cache(const clock_cache &) = delete;
+    clock_cache &operator=(const clock_cache &) = delete;
+
+    const Value *find(const Key &key)
+    {
+        auto it = index_.find(key);
+        if (it == index_.end())
+        {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        slot &s = slots_[it->second];
+        s.referenced = true;
+        return &s.value;
+    }
+
+    void insert(const Key &key, Value value)
+    {
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            slots_[it->second].value = std::move(value);
+            slots_[it->second].referenced = true;
+            return;
+        }
+        if (slots_.size() < capacity_)
+        {
+            index_.emplace(key, slots_.size());
+            slots_.push_back(slot{key, std::move(value), false});
+            return;
+        }
+        // 绕圈找一个最近没用过的，最多两圈(第一圈把标记全清掉)
+        while (slots_[hand_].referenced)
+        {
+            slots_[hand_].referenced = false;
+            hand_ = hand_ + 1 == capacity_ ? 0 : hand_ + 1;
+        }
+        slot &victim = slots_[hand_];
+        index_.erase(victim.key);
+        victim.key = key;
+        victim.value = std::move(value);
+        index_.emplace(key, hand_);
+        hand_ = hand_ + 1 == capacity_ ? 0 : hand_ + 1;
+        ++stats_.evictions;
+    }
+
+    template <typename Compute> Value get_or_compute(const Key &key, Compute &&compute)
+    {
+        if (const Value *value = find(key))
+            return *value;
+        Value value = compute();
+        insert(key, value);
+        return value;
+    }
+
+    size_t size() const { return index_.size(); }
+    size_t capacity() const { return capacity_; }
+    const memo_stats &stats() const { return stats_; }
+
+private:
+    struct slot
+    {
+        Key key;
+        Value value;
+        bool referenced;
+    };
+
+    size_t capacity_;
+    std::vector<slot> slots_;
+    std::unordered_map<Key, size_t, Hash> index_;
+    size_t hand_ = 0;
+    memo_stats stats_;
+};
+
+template <typename Key, typename Value, typename Hash = memo_hash<Key>,
+          template <typename, typename, typename> class Shard = lru_cache>
+class sharded_cache
+{
+public:
+    // shards 为0时取硬件线程数的4倍，向上取整到2的幂
+    explicit sharded_cache(size_t capacity, size_t shards = 0)
+    {
+        if (shards == 0)
+            shards = 4 * std::max(1u, std::thread::hardware_concurrency());
+        size_t count = 1;
+        while (count < shards)
+            count <<= 1;
+        // 每片至少放得下一个条目
+        while (count > 1 && count > capacity)
+            count >>= 1;
+        mask_ = count - 1;
+        for (size_t i = 0; i < count; ++i)
+            shards_.emplace_back(new shard((capacity + count - 1) / count));
+    }
+
+    template <typename Compute> Value get_or_compute(const Key &key, Compute &&compute)
+    {
+        shard &s = *shards_[pick(key)];
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (const Value *value = s.cache.find(key))
+                return *value;
+        }
+        Value value = compute();
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.cache.insert(key, value);
+        }
+        return value;
+    }
+
+    size_t size() const
+    {
+        size_t n = 0;
+        for (auto &s : shards_)
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            n += s->cache.size();
+        }
+        return n;
+    }
+
+    size_t capacity() const { return shards_.size() * shards_[0]->cache.capacity(); }
+    size_t shard_count() const { return shards_.size(); }
+
+    memo_stats stats() const
+    {
+        memo_stats total;
+        for (auto &s : shards_)
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            total += s->cache.stats();
+        }
+        return total;
+    }
+
+private:
+    // 每片单独一块，锁不和相邻的片共享缓存行
+    struct alignas(64) shard
+    {
+        explicit shard(size_t capacity) : cache(capacity) {}
+        mutable std::mutex mutex;
+        Shard<Key, Value, Hash> cache;
+    };
+
+    size_t pick(const Key &key) const
+    {
+        // 高位打散后再取，避免和各片内部哈希表用同样的低位
+        uint64_t h = Hash()(key) * 0x9e3779b97f4a7c15ULL;
+        return (h >> 40) & mask_;
+    }
+
+    std::vector<std::unique_ptr<shard>> shards_;
+    size_t mask_;
+};
+
+template <typename Key, typename Value, typename Hash = memo_hash<Key>>
+using sharded_lru_cache = sharded_cache<Key, Value, Hash, lru_cache>;
+template <typename Key, typename Value, typename Hash = memo_hash<Key>>
+using sharded_clock_cache = sharded_cache<Key, Value, Hash, clock_cache>;
+
+namespace memo_detail
+{
+    // 从函数指针或者 lambda 的 operator() 推导参数和返回值
+    template <typename T> struct signature : signature<decltype(&T::operator())>
+    {
+    };
+    template <typename R, typename... Args> struct signature<R (*)(Args...)>
+    {
+        using result = std::decay_t<R>;
+        using key = std::conditional_t<sizeof...(Args) == 1, std::decay_t<std::tuple_element_t<0, std::tuple<Args..., void>>>,
+                                       std::tuple<std::decay_t<Args>...>>;
+    };
+    template <typename R, typename... Args> struct signature<R(Args...)> : signature<R (*)(Args...)>
+    {
+    };
+    template <typename C, typename R, typename... Args> struct signature<R (C::*)(Args...)> : signature<R (*)(Args...)>
+    {
+    };
+    template <typename C, typename R, typename... Args> struct signature<R (C::*)(Args...) const> : signature<R (*)(Args...)>
+    {
+    };
+}
+
+template <typename F, template <typename, typename, typename> class Cache> class memoized
+{
+public:
+    using key_type = typename memo_detail::signature<F>::key;
+    using value_type = typename memo_detail::signature<F>::result;
+    using cache_type = Cache<key_type, value_type, memo_hash<key_type>>;
+
+    template <typename... CacheArgs>
+    explicit memoized(F f, CacheArgs &&...cache_args) : f_(std::move(f)), cache_(std::forward<CacheArgs>(cache_args)...)
+    {
+    }
+
+    template <typename... Args> value_type operator()(Args &&...args)
+    {
+        key_type key(args...);
+        return cache_.get_or_compute(key, [&]() -> value_type { return f_(std::forward<Args>(args)...); });
+    }
+
+    cache_type &cache() { return cache_; }
+    const cache_type &cache() const { return cache_; }
+
+private:
+    F f_;
+    cache_type cache_;
+};
+
+template <template <typename, typename, typename> class Cache, typename F, typename... CacheArgs>
+memoized<std::decay_t<F>, Cache> memoize(F &&f, CacheArgs &&...cache_args)
+{
+    return memoized<std::decay_t<F>, Cache>(std::forward<F>(f), std::forward<CacheArgs>(cache_args)...);
+}
+
+#endif //RESTUDYCPP_MEMO_CACHE_H
@@ -0,0 +1,148 @@
+//
+// 编译期的 gcd/lcm 和查找表
+//
+// 用法: ./bench-constexpr-table [rounds]
+// 先用 static_assert 检查：这些值和整张表都是编译期算出来的，编译通过就说明检查通过，运行时不再做任何事。
+// 然后把 [2, kSmallFactorLimit) 里的每个数分解 rounds(默认20) 遍：
+//  - factorize_small 查最小质因数表；
+//  - factorize：试除 + Miller-Rabin + Pollard-Brent，对小数只走试除；
+//  - 朴素的逐个试除。
+// 比较时间，并检查三种方法的结果一致。
+//
+
+#include "constexpr_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// gcd/lcm 系列
+static_assert(gcd(10000, 8000) == 2000, "gcd");
+static_assert(gcd(0, 7) == 7 && gcd(0, 0) == 0, "gcd with zero");
+static_assert(lcm(10000, 8000) == 40000, "lcm");
+constexpr uint64_t kValues[] = {12, 18, 30, 42};
+static_assert(gcdn(kValues, 4) == 6, "gcdn");
+static_assert(lcmn(kValues, 4) == 1260, "lcmn");
+constexpr bool LcmOverflows()
+{
+    uint64_t out = 0;
+    return !lcm_checked(uint64_t(1) << 63, 3, &out);
+}
+static_assert(LcmOverflows(), "lcm_checked");
+// 常量表达式可以当模板实参
+static_assert(const_table<int, gcd(48, 18)>{}.size() == 6, "gcd as template argument");
+
+// 试除用的素数表
+static_assert(factor_detail::kTrialPrimes.size() == 171, "odd primes below 1024");
+static_assert(factor_detail::kTrialPrimes[0].p == 3 && factor_detail::kTrialPrimes[170].p == 1021, "trial primes");
+
+// 素数表和最小质因数表
+static_assert(kPrimeCountBelow<1000> == 168 && kPrimeCountBelow<kSmallFactorLimit> == 6542, "prime counts");
+static_assert(small_primes<100>[24] == 97, "small primes");
+static_assert(smallest_prime_factor(65521) == 65521 && smallest_prime_factor(65535) == 3, "smallest factors");
+static_assert(sizeof(smallest_factor_table<kSmallFactorLimit>) == 2 * kSmallFactorLimit, "16-bit entries");
+
+// 逐项检查整张表：每个数的最小质因数整除它、是素数，并且没有更小的因数
+constexpr bool SmallestFactorTableIsCorrect()
+{
+    for (uint32_t n = 2; n < kSmallFactorLimit; ++n)
+    {
+        uint32_t p = smallest_prime_factor(n);
+        if (p < 2 || n % p != 0 || smallest_prime_factor(p) != p)
+            return false;
+        if (p > 2 && n % 2 == 0)
+            return false;
+    }
+    return true;
+}
+static_assert(SmallestFactorTableIsCorrect(), "smallest factor table");
+
+// 逆元表：模素数 65521 时 1..M-1 都有逆元，模合数 360 时只有与 360 互素的数有
+constexpr bool InverseTableIsCorrect()
+{
+    for (uint64_t a = 1; a < 65521; ++a)
+        if (inverse_table<65521>[a] * a % 65521 != 1)
+            return false;
+    for (uint64_t a = 0; a < 360; ++a)
+    {
+        uint64_t inv = inverse_table<360>[a];
+        if (gcd(a, 360) == 1 ? inv * a % 360 != 1 : inv != 0)
+            return false;
+    }
+    return inverse_table<65521>[0] == 0;
+}
+static_assert(InverseTableIsCorrect(), "inverse tables");
+
+constexpr bool FactorizeSmallWorks()
+{
+    uint32_t out[16] = {};
+    size_t n = factorize_small(65520, out); // 2^4 * 3^2 * 5 * 7 * 13
+    const uint32_t expected[] = {2, 2, 2, 2, 3, 3, 5, 7, 13};
+    if (n != 9)
+        return false;
+    for (size_t i = 0; i < n; ++i)
+        if (out[i] != expected[i])
+            return false;
+    return factorize_small(1, out) == 0;
+}
+static_assert(FactorizeSmallWorks(), "factorize_small");
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t TrialDivision(uint32_t n, uint32_t *out)
+{
+    size_t count = 0;
+    for (uint32_t p = 2; p * p <= n; ++p)
+        for (; n % p == 0; n /= p)
+            out[count++] = p;
+    if (n > 1)
+        out[count++] = n;
+    return count;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rounds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20;
+
+    // 所有质因数的校验和：各种方法都按从小到大的顺序输出，
+    // 用 hash = hash*31 + p 把顺序也算进去
+    auto run = [&](const char *name, auto factorizer) {
+        uint64_t hash = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < rounds; ++r)
+            for (uint32_t n = 2; n < kSmallFactorLimit; ++n)
+                hash = factorizer(n, hash);
+        double ms = MsSince(start);
+        printf("%-16s %8.2f ns/number (hash %016llx)\n", name, ms * 1e6 / (rounds * (kSmallFactorLimit - 2)),
+               (unsigned long long)hash);
+        return hash;
+    };
+
+    uint64_t table = run("factorize_small", [](uint32_t n, uint64_t hash) {
+        uint32_t out[16];
+        size_t count = factorize_small(n, out);
+        for (size_t i = 0; i < count; ++i)
+            hash = hash * 31 + out[i];
+        return hash;
+    });
+    uint64_t general = run("factorize", [](uint32_t n, uint64_t hash) {
+        for (uint64_t p : factorize(n))
+            hash = hash * 31 + p;
+        return hash;
+    });
+    uint64_t trial = run("trial division", [](uint32_t n, uint64_t hash) {
+        uint32_t out[16];
+        size_t count = TrialDivision(n, out);
+        for (size_t i = 0; i < count; ++i)
+            hash = hash * 31 + out[i];
+        return hash;
+    });
+
+    bool ok = table == general && table == trial;
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
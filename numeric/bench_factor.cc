@@ -0,0 +1,141 @@
+//
+// 质因数分解的速度
+//
+// 用法: ./bench-factor [count] [threads]
+// 每类 count 个数(默认2000)：
+//  - 随机 64 位整数；
+//  - 不平衡的半素数：20 位素数 * 44 位素数；
+//  - 平衡的半素数：两个 32 位素数之积(最难)。
+// 逐个 factorize 的平均时间，factorize_batch 用 threads 个线程(默认4)的平均时间，
+// 以及同样的 Pollard-Brent 用 unsigned __int128 取模代替 Montgomery 乘法的时间。
+// 检查每个结果的因子都是素数、乘起来等于原数。
+//
+
+#include "factor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// 同样的 Pollard-Brent，模乘直接用 128 位取模
+static uint64_t NaiveBrent(uint64_t n)
+{
+    constexpr uint64_t kBatch = 128;
+    auto mulmod = [n](uint64_t a, uint64_t b) { return (uint64_t)((unsigned __int128)a * b % n); };
+    for (uint64_t c = 1;; ++c)
+    {
+        uint64_t y = 2, x = y, ys = y, q = 1, g = 1;
+        auto f = [&](uint64_t v) { return (uint64_t)(((unsigned __int128)v * v + c) % n); };
+        for (uint64_t r = 1; g == 1; r <<= 1)
+        {
+            x = y;
+            for (uint64_t i = 0; i < r; ++i)
+                y = f(y);
+            for (uint64_t k = 0; k < r && g == 1; k += kBatch)
+            {
+                ys = y;
+                for (uint64_t i = 0; i < std::min(kBatch, r - k); ++i)
+                {
+                    y = f(y);
+                    q = mulmod(q, x > y ? x - y : y - x);
+                }
+                g = gcd(q, n);
+            }
+        }
+        if (g == n)
+        {
+            do
+            {
+                ys = f(ys);
+                g = gcd(x > ys ? x - ys : ys - x, n);
+            } while (g == 1);
+        }
+        if (g != n)
+            return g;
+    }
+}
+
+static uint64_t RandomPrime(std::mt19937_64 &rng, int bits)
+{
+    while (true)
+    {
+        uint64_t p = (rng() >> (64 - bits)) | (uint64_t(1) << (bits - 1)) | 1;
+        if (is_prime(p))
+            return p;
+    }
+}
+
+static double UsSince(std::chrono::steady_clock::time_point start, size_t n)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+static bool Verify(uint64_t n, const std::vector<uint64_t> &factors)
+{
+    unsigned __int128 product = 1;
+    for (uint64_t f : factors)
+    {
+        if (!is_prime(f))
+            return false;
+        product *= f;
+    }
+    return product == n && std::is_sorted(factors.begin(), factors.end());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000;
+    size_t threads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+
+    std::mt19937_64 rng(42);
+    struct Case
+    {
+        const char *name;
+        std::vector<uint64_t> numbers;
+    } cases[3] = {{"random 64-bit", {}}, {"semiprime 20x44", {}}, {"semiprime 32x32", {}}};
+    for (size_t i = 0; i < count; ++i)
+    {
+        cases[0].numbers.push_back(rng());
+        cases[1].numbers.push_back(RandomPrime(rng, 20) * RandomPrime(rng, 44));
+        cases[2].numbers.push_back(RandomPrime(rng, 32) * RandomPrime(rng, 32));
+    }
+
+    bool ok = true;
+    for (auto &c : cases)
+    {
+        std::vector<std::vector<uint64_t>> results(count);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i)
+            results[i] = factorize(c.numbers[i]);
+        double single = UsSince(start, count);
+        for (size_t i = 0; i < count; ++i)
+            ok &= Verify(c.numbers[i], results[i]);
+
+        std::vector<std::vector<uint64_t>> batch(count);
+        start = std::chrono::steady_clock::now();
+        factorize_batch(c.numbers.data(), count, batch.data(), threads);
+        double batched = UsSince(start, count);
+        ok &= batch == results;
+
+        printf("%-16s factorize %8.2f us, batch(%zu threads) %8.2f us", c.name, single, threads, batched);
+        if (&c != &cases[0])
+        {
+            // 半素数：只比较找到第一个因子的 rho 本身
+            start = std::chrono::steady_clock::now();
+            uint64_t sink = 0;
+            for (uint64_t n : c.numbers)
+                sink += NaiveBrent(n);
+            double naive = UsSince(start, count);
+            start = std::chrono::steady_clock::now();
+            for (uint64_t n : c.numbers)
+                sink -= factor_detail::pollard_brent(n);
+            double mont = UsSince(start, count);
+            printf(" | rho: montgomery %8.2f us, __int128 %%%8.2f us%s", mont, naive, sink ? " (different factors found)" : "");
+        }
+        printf("\n");
+    }
+    printf("%s\n", ok ? "all factorizations verified" : "VERIFY FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+//
+// 二进制 gcd 对比原来的辗转相除法和 std::gcd
+//
+// 用法: ./bench-gcd [pairs] [len]
+//  1. pairs 对(默认100万)随机 64 位数：原来的 gcd、std::gcd、现在的 gcd、gcd_batch；
+//  2. len 个元素(默认100万)的数组，gcdn 的元素都是一个公因子的倍数(不会很快累积到 1)，lcmn 的元素都是一个数的约数(不会溢出)：
+//     原来递归的 gcdn/lcmn、现在逐个累积的版本。递归版本在数组很长时会把栈用完，超过10万个元素不跑。
+//
+
+#include "factor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// 原来的实现
+static uint64_t legacy_gcd(uint64_t __m, uint64_t __n)
+{
+    while (__n != 0) {
+        uint64_t __t = __m % __n;
+        __m = __n;
+        __n = __t;
+    }
+    return __m;
+}
+
+static uint64_t legacy_lcm(uint64_t __m, uint64_t __n) {
+    return (__m != 0 && __n != 0) ? (__m / legacy_gcd(__m, __n)) * __n : 0;
+}
+
+static uint64_t legacy_gcdn(uint64_t *arr, int len) {
+    if (len == 0) {
+        return 0;
+    } else if (len == 1)
+        return (*arr);
+    return legacy_gcd(arr[len - 1], legacy_gcdn(arr, len - 1));
+}
+
+static uint64_t legacy_lcmn(uint64_t *arr, int len) {
+    if (len == 0) {
+        return 0;
+    } else if (len == 1)
+        return *arr;
+    else
+        return legacy_lcm(arr[len - 1], legacy_lcmn(arr, len - 1));
+}
+
+static double NsPer(std::chrono::steady_clock::time_point start, size_t n)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+template <typename F> static uint64_t Pairs(const char *name, const std::vector<uint64_t> &a, const std::vector<uint64_t> &b, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sum = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+        sum += f(a[i], b[i]);
+    printf("  %-12s %6.1f ns/gcd\n", name, NsPer(start, a.size()));
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t pairs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t len = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+
+    std::mt19937_64 rng(42);
+    std::vector<uint64_t> a(pairs), b(pairs), out(pairs);
+    for (size_t i = 0; i < pairs; ++i)
+    {
+        // 乘上一个小的公因子，让结果不总是 1；偶尔放一个 0
+        uint64_t common = rng() % 1000 + 1;
+        a[i] = (rng() >> 12) * common;
+        b[i] = i % 1000 == 0 ? 0 : (rng() >> 12) * common;
+    }
+
+    printf("%zu random pairs\n", pairs);
+    uint64_t expect = Pairs("legacy gcd", a, b, legacy_gcd);
+    bool ok = Pairs("std::gcd", a, b, [](uint64_t x, uint64_t y) { return std::gcd(x, y); }) == expect;
+    ok &= Pairs("binary gcd", a, b, gcd) == expect;
+    auto start = std::chrono::steady_clock::now();
+    gcd_batch(a.data(), b.data(), out.data(), pairs);
+    printf("  %-12s %6.1f ns/gcd\n", "gcd_batch", NsPer(start, pairs));
+    ok &= std::accumulate(out.begin(), out.end(), uint64_t(0)) == expect;
+
+    // gcdn 用的数组：公因子 2^5*3^3*7 乘一个小随机数
+    // lcmn 用的数组：都是 2^6*3^4*5^2*7*11*13*17*19 的约数，lcm 不会溢出
+    std::vector<uint64_t> arr(len), divisors(len);
+    for (auto &v : arr)
+        v = 6048 * (rng() % 1000000 + 1);
+    const uint64_t primes[] = {2, 3, 5, 7, 11, 13, 17, 19}, maxExp[] = {6, 4, 2, 1, 1, 1, 1, 1};
+    for (auto &v : divisors)
+    {
+        v = 1;
+        for (int p = 0; p < 8; ++p)
+            for (uint64_t e = rng() % (maxExp[p] + 1); e > 0; --e)
+                v *= primes[p];
+    }
+    for (size_t n : {size_t(1000), size_t(100000), len})
+    {
+        n = std::min(n, len);
+        printf("array of %zu:", n);
+        uint64_t legacyGcd = 0, legacyLcm = 0;
+        if (n <= 100000)
+        {
+            start = std::chrono::steady_clock::now();
+            legacyGcd = legacy_gcdn(arr.data(), n);
+            printf(" legacy gcdn %8.3f ms,", NsPer(start, 1000000));
+            start = std::chrono::steady_clock::now();
+            legacyLcm = legacy_lcmn(divisors.data(), n);
+            printf(" legacy lcmn %8.3f ms,", NsPer(start, 1000000));
+        }
+        else
+            printf(" legacy skipped (recursion depth),");
+        start = std::chrono::steady_clock::now();
+        uint64_t g = gcdn(arr.data(), n);
+        printf(" gcdn %8.3f ms,", NsPer(start, 1000000));
+        start = std::chrono::steady_clock::now();
+        uint64_t l = lcmn(divisors.data(), n);
+        printf(" lcmn %8.3f ms  (gcd %llu, lcm %llu)\n", NsPer(start, 1000000), (unsigned long long)g, (unsigned long long)l);
+        if (n <= 100000)
+            ok &= g == legacyGcd && l == legacyLcm;
+    }
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+//
+// 溢出检查和任意精度的 lcmn
+//
+// 用法: ./bench-lcmn [n]
+//  1. lcmn_checked 求 1..n(默认10000) 的最小公倍数，报告在第几个数溢出；
+//  2. lcmn_big 逐个累积求精确值，打印位数；
+//  3. 同一个值的另一种算法：1..n 的最小公倍数等于每个素数 p 不超过 n 的最高次幂之积，
+//     用乘积树(两两相乘)算出来，分别用竖式乘法和 Karatsuba，结果要和 2 一致；
+//  4. 不同长度的两个随机大数相乘：竖式乘法对比 Karatsuba。
+//
+
+#include "bigint.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Mul> static bigint ProductTree(std::vector<bigint> values, Mul mul)
+{
+    while (values.size() > 1)
+    {
+        std::vector<bigint> next;
+        for (size_t i = 0; i + 1 < values.size(); i += 2)
+            next.push_back(mul(values[i], values[i + 1]));
+        if (values.size() % 2)
+            next.push_back(values.back());
+        values.swap(next);
+    }
+    return values.empty() ? bigint(1) : values[0];
+}
+
+static bigint RandomBig(std::mt19937_64 &rng, size_t limbs)
+{
+    bigint r(1);
+    for (size_t i = 0; i < limbs; ++i)
+        r.mul_word(rng() | (uint64_t(1) << 63)); // 每次乘上一个64位数，大约多一个字
+    return r;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000;
+    bool ok = true;
+
+    std::vector<uint64_t> values(n);
+    for (uint64_t i = 0; i < n; ++i)
+        values[i] = i + 1;
+
+    uint64_t small = 0;
+    size_t at = 0;
+    if (lcmn_checked(values.data(), values.size(), &small, &at))
+        printf("lcmn_checked(1..%llu) = %llu\n", (unsigned long long)n, (unsigned long long)small);
+    else
+        printf("lcmn_checked(1..%llu): overflows uint64_t at %llu\n", (unsigned long long)n, (unsigned long long)values[at]);
+    uint64_t twenty = 0;
+    ok &= lcmn_checked(values.data(), std::min<size_t>(20, n), &twenty) && (n < 20 || twenty == 232792560);
+
+    auto start = std::chrono::steady_clock::now();
+    bigint exact = lcmn_big(values.data(), values.size());
+    double seqMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    std::string digits = exact.to_string();
+    double printMs = MsSince(start);
+    printf("lcmn_big(1..%llu): %zu bits, %zu digits (%.10s...), %.2f ms; to_string %.2f ms\n", (unsigned long long)n,
+           exact.bit_length(), digits.size(), digits.c_str(), seqMs, printMs);
+
+    // 素数的最高次幂
+    std::vector<bool> composite(n + 1);
+    std::vector<bigint> powers;
+    for (uint64_t p = 2; p <= n; ++p)
+    {
+        if (composite[p])
+            continue;
+        for (uint64_t q = p * p; q <= n; q += p)
+            composite[q] = true;
+        uint64_t pk = p;
+        while (pk <= n / p)
+            pk *= p;
+        powers.push_back(bigint(pk));
+    }
+    start = std::chrono::steady_clock::now();
+    bigint school = ProductTree(powers, bigint::schoolbook);
+    double schoolMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    bigint karatsuba = ProductTree(powers, [](const bigint &a, const bigint &b) { return a * b; });
+    double karatsubaMs = MsSince(start);
+    printf("product tree of %zu prime powers: schoolbook %.2f ms, karatsuba %.2f ms%s\n", powers.size(), schoolMs, karatsubaMs,
+           school == exact && karatsuba == exact ? "" : "  MISMATCH");
+    ok &= school == exact && karatsuba == exact;
+
+    std::mt19937_64 rng(42);
+    for (size_t limbs : {32, 128, 512, 2048, 8192})
+    {
+        bigint a = RandomBig(rng, limbs), b = RandomBig(rng, limbs);
+        int rounds = limbs <= 512 ? 20 : 2;
+        start = std::chrono::steady_clock::now();
+        bigint p1;
+        for (int r = 0; r < rounds; ++r)
+            p1 = bigint::schoolbook(a, b);
+        schoolMs = MsSince(start) / rounds;
+        start = std::chrono::steady_clock::now();
+        bigint p2;
+        for (int r = 0; r < rounds; ++r)
+            p2 = a * b;
+        karatsubaMs = MsSince(start) / rounds;
+        // 再用除以一个字验证：(a*b) mod d == (a mod d)*(b mod d) mod d
+        uint64_t d = 1000000007;
+        bool match = p1 == p2 && p2.mod_word(d) == (unsigned __int128)a.mod_word(d) * b.mod_word(d) % d;
+        printf("%5zu x %5zu limbs: schoolbook %9.3f ms, karatsuba %9.3f ms, %.1fx%s\n", a.limb_count(), b.limb_count(), schoolMs,
+               karatsubaMs, schoolMs / karatsubaMs, match ? "" : "  MISMATCH");
+        ok &= match;
+    }
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
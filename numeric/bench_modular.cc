@@ -0,0 +1,181 @@
+//
+// Montgomery / Barrett 模乘对比 __int128 取模
+//
+// 用法: ./bench-modular [len] [rounds]
+// 模数是一个随机的 62 位素数(barrett64 要求 n < 2^62)，len(默认65536) 个随机余数，每项测 rounds(默认20) 遍取平均：
+//  - mulmod 吞吐：数组逐元素相乘(mul_batch)，元素之间互相独立；
+//  - mulmod 延迟：x = x*x mod n 连续做 len 次，每一步都依赖上一步；
+//  - powmod：指数 n-2，逐个求模幂对比 pow_batch；
+//  - 逆元：费马小定理(模幂)、逐个扩展欧几里得、inverse_batch。
+// 时间都是每个元素(每次运算)的纳秒数，所有结果都和 __int128 取模的版本核对。
+// 最后用一个偶数模数单独检查 barrett64。
+//
+
+#include "factor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static uint64_t NaiveMul(uint64_t a, uint64_t b, uint64_t n)
+{
+    return (uint64_t)((unsigned __int128)a * b % n);
+}
+
+static uint64_t NaivePow(uint64_t base, uint64_t e, uint64_t n)
+{
+    uint64_t r = 1 % n;
+    for (; e; e >>= 1, base = NaiveMul(base, base, n))
+        if (e & 1)
+            r = NaiveMul(r, base, n);
+    return r;
+}
+
+// 跑 rounds 遍，返回每个元素的纳秒数
+template <typename F> static double NsPer(size_t rounds, size_t len, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r)
+        f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (rounds * len);
+}
+
+// 把内部表示转回普通余数
+template <typename Mod> static std::vector<uint64_t> FromForm(const Mod &mod, const std::vector<uint64_t> &v)
+{
+    std::vector<uint64_t> out(v.size());
+    for (size_t i = 0; i < v.size(); ++i)
+        out[i] = mod.from(v[i]);
+    return out;
+}
+
+template <typename Mod> static std::vector<uint64_t> ToForm(const Mod &mod, const std::vector<uint64_t> &v)
+{
+    std::vector<uint64_t> out(v.size());
+    for (size_t i = 0; i < v.size(); ++i)
+        out[i] = mod.to(v[i]);
+    return out;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = argc > 1 ? strtoul(argv[1], nullptr, 10) : 65536;
+    size_t rounds = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+
+    std::mt19937_64 rng(42);
+    uint64_t n;
+    do
+        n = (rng() >> 3) | (uint64_t(1) << 61) | 1;
+    while (!is_prime(n));
+    std::vector<uint64_t> a(len), b(len);
+    for (size_t i = 0; i < len; ++i)
+    {
+        a[i] = rng() % n;
+        b[i] = rng() % n;
+    }
+    printf("modulus %llu (62-bit prime), %zu elements\n", (unsigned long long)n, len);
+
+    mont64 mont(n);
+    barrett64 barrett(n);
+    std::vector<uint64_t> ma = ToForm(mont, a), mb = ToForm(mont, b);
+    std::vector<uint64_t> expected(len), out(len);
+    bool ok = true;
+    uint64_t sink = 0;
+
+    // 吞吐
+    double naive = NsPer(rounds, len, [&]() {
+        for (size_t i = 0; i < len; ++i)
+            expected[i] = NaiveMul(a[i], b[i], n);
+    });
+    double montNs = NsPer(rounds, len, [&]() { mul_batch(mont, ma.data(), mb.data(), out.data(), len); });
+    ok &= FromForm(mont, out) == expected;
+    double barrettNs = NsPer(rounds, len, [&]() { mul_batch(barrett, a.data(), b.data(), out.data(), len); });
+    ok &= out == expected;
+    printf("mulmod throughput: __int128 %% %6.2f ns, montgomery %6.2f ns, barrett %6.2f ns\n", naive, montNs, barrettNs);
+
+    // 延迟
+    uint64_t x0 = a[0], naiveX = 0, montX = 0, barrettX = 0;
+    naive = NsPer(rounds, len, [&]() {
+        uint64_t x = x0;
+        for (size_t i = 0; i < len; ++i)
+            x = NaiveMul(x, x, n);
+        naiveX = x;
+    });
+    montNs = NsPer(rounds, len, [&]() {
+        uint64_t x = mont.to(x0);
+        for (size_t i = 0; i < len; ++i)
+            x = mont.mul(x, x);
+        montX = mont.from(x);
+    });
+    barrettNs = NsPer(rounds, len, [&]() {
+        uint64_t x = x0;
+        for (size_t i = 0; i < len; ++i)
+            x = barrett.mul(x, x);
+        barrettX = x;
+    });
+    ok &= montX == naiveX && barrettX == naiveX;
+    printf("mulmod latency:    __int128 %% %6.2f ns, montgomery %6.2f ns, barrett %6.2f ns\n", naive, montNs, barrettNs);
+
+    // 模幂：元素少一些，每个要一百多次乘法
+    size_t powLen = std::max<size_t>(1, len / 16), powRounds = std::max<size_t>(1, rounds / 4);
+    uint64_t e = n - 2;
+    expected.resize(powLen);
+    out.resize(powLen);
+    naive = NsPer(powRounds, powLen, [&]() {
+        for (size_t i = 0; i < powLen; ++i)
+            expected[i] = NaivePow(a[i], e, n);
+    });
+    montNs = NsPer(powRounds, powLen, [&]() {
+        for (size_t i = 0; i < powLen; ++i)
+            out[i] = mont.pow(ma[i], e);
+    });
+    ok &= FromForm(mont, out) == expected;
+    double montBatch = NsPer(powRounds, powLen, [&]() { pow_batch(mont, ma.data(), e, out.data(), powLen); });
+    ok &= FromForm(mont, out) == expected;
+    barrettNs = NsPer(powRounds, powLen, [&]() {
+        for (size_t i = 0; i < powLen; ++i)
+            out[i] = barrett.pow(a[i], e);
+    });
+    ok &= out == expected;
+    double barrettBatch = NsPer(powRounds, powLen, [&]() { pow_batch(barrett, a.data(), e, out.data(), powLen); });
+    ok &= out == expected;
+    printf("powmod (e = n-2):  __int128 %% %6.0f ns, montgomery %6.0f ns, batch %6.0f ns, barrett %6.0f ns, batch %6.0f ns\n",
+           naive, montNs, montBatch, barrettNs, barrettBatch);
+
+    // 逆元：上面的 a^(n-2) 就是 a 的逆元
+    double euclid = NsPer(powRounds, powLen, [&]() {
+        for (size_t i = 0; i < powLen; ++i)
+            out[i] = mod_inverse(a[i], n);
+    });
+    ok &= out == expected;
+    montNs = NsPer(rounds, len, [&]() { inverse_batch(mont, ma.data(), out.data(), len); });
+    std::vector<uint64_t> inv = FromForm(mont, out);
+    barrettNs = NsPer(rounds, len, [&]() { inverse_batch(barrett, a.data(), out.data(), len); });
+    ok &= inv == out;
+    for (size_t i = 0; i < powLen; ++i)
+        ok &= inv[i] == expected[i];
+    printf("inverse:           fermat %6.0f ns, extended euclid %6.0f ns, batch montgomery %6.2f ns, batch barrett %6.2f ns\n",
+           naive, euclid, montNs, barrettNs);
+
+    // 不可逆的元素
+    std::vector<uint64_t> withZero = {mont.to(3), 0, mont.to(5)};
+    std::vector<uint64_t> invZero(3);
+    inverse_batch(mont, withZero.data(), invZero.data(), 3);
+    ok &= mont.from(invZero[0]) == NaivePow(3, e, n) && invZero[1] == 0 && mont.from(invZero[2]) == NaivePow(5, e, n);
+
+    // 偶数模数只能用 Barrett
+    uint64_t even = (rng() >> 3) & ~uint64_t(1);
+    barrett64 evenMod(even);
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint64_t x = a[i] % even, y = b[i] % even;
+        ok &= evenMod.mul(x, y) == NaiveMul(x, y, even);
+        sink += evenMod.inverse(x | 1) ? 0 : 1;
+    }
+    ok &= evenMod.powmod(a[1], b[1]) == NaivePow(a[1] % even, b[1], even);
+    printf("even modulus %llu: barrett ok, %llu odd elements without inverse\n", (unsigned long long)even, (unsigned long long)sink);
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
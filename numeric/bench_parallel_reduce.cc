@@ -0,0 +1,103 @@
+//
+// gcdn/lcmn 分块并行的扩展性
+//
+// 用法: ./bench-parallel-reduce [len] [max_threads]
+// len 个元素(默认2.5亿，占2GB内存)，线程数从1翻倍到 max_threads(默认16)：
+//  - gcdn：元素都是 6048 的倍数，要扫完整个数组；
+//  - gcdn，提前结束：同一个数组，在 1/3 处放一个和 6048 互素的数；
+//  - lcmn：元素都是 2^6*3^4*5^2*7*11*13*17*19 的约数，不会溢出。
+// 与顺序版本 gcdn/lcmn_checked 比较时间和结果。
+//
+
+#include "parallel_reduce.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = argc > 1 ? strtoull(argv[1], nullptr, 10) : 250000000;
+    size_t maxThreads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 16;
+
+    std::vector<uint64_t> arr(len);
+    std::mt19937_64 rng(42);
+    for (auto &v : arr)
+        v = 6048 * (rng() % 1000000 + 1);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t g = gcdn(arr.data(), len);
+    double gcdMs = MsSince(start);
+
+    uint64_t saved = arr[len / 3];
+    arr[len / 3] = 1000003;
+    start = std::chrono::steady_clock::now();
+    uint64_t gEarly = gcdn(arr.data(), len);
+    double earlyMs = MsSince(start);
+    arr[len / 3] = saved;
+
+    printf("%zu elements, %u hardware threads\n", len, std::thread::hardware_concurrency());
+    printf("sequential:  gcdn %8.1f ms (gcd %llu), early exit %8.1f ms (gcd %llu)\n", gcdMs, (unsigned long long)g, earlyMs,
+           (unsigned long long)gEarly);
+
+    bool ok = true;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        reduce_pool pool(threads);
+        start = std::chrono::steady_clock::now();
+        uint64_t pg = gcdn_parallel(pool, arr.data(), len);
+        double ms = MsSince(start);
+        arr[len / 3] = 1000003;
+        start = std::chrono::steady_clock::now();
+        uint64_t pEarly = gcdn_parallel(pool, arr.data(), len);
+        double pEarlyMs = MsSince(start);
+        arr[len / 3] = saved;
+        printf("%2zu threads: gcdn %8.1f ms (%.2fx), early exit %8.1f ms%s\n", threads, ms, gcdMs / ms, pEarlyMs,
+               pg == g && pEarly == gEarly ? "" : "  MISMATCH");
+        ok &= pg == g && pEarly == gEarly;
+    }
+
+    // 换成约数数组测 lcmn
+    const uint64_t primes[] = {2, 3, 5, 7, 11, 13, 17, 19}, maxExp[] = {6, 4, 2, 1, 1, 1, 1, 1};
+    for (auto &v : arr)
+    {
+        v = 1;
+        for (int p = 0; p < 8; ++p)
+            for (uint64_t e = rng() % (maxExp[p] + 1); e > 0; --e)
+                v *= primes[p];
+    }
+    uint64_t l = 0;
+    start = std::chrono::steady_clock::now();
+    ok &= lcmn_checked(arr.data(), len, &l);
+    double lcmMs = MsSince(start);
+    printf("sequential:  lcmn %8.1f ms (lcm %llu)\n", lcmMs, (unsigned long long)l);
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        reduce_pool pool(threads);
+        uint64_t pl = 0;
+        start = std::chrono::steady_clock::now();
+        bool fits = lcmn_parallel(pool, arr.data(), len, &pl);
+        double ms = MsSince(start);
+        printf("%2zu threads: lcmn %8.1f ms (%.2fx)%s\n", threads, ms, lcmMs / ms, fits && pl == l ? "" : "  MISMATCH");
+        ok &= fits && pl == l;
+    }
+
+    // 溢出和 0
+    reduce_pool pool(4);
+    std::vector<uint64_t> small(100000);
+    for (size_t i = 0; i < small.size(); ++i)
+        small[i] = i + 1;
+    uint64_t out = 0;
+    ok &= !lcmn_parallel(pool, small.data(), small.size(), &out);
+    small[small.size() - 1] = 0;
+    ok &= lcmn_parallel(pool, small.data(), small.size(), &out) && out == 0;
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
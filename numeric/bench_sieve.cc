@@ -0,0 +1,106 @@
+//
+// 分段筛法的速度和内存
+//
+// 用法: ./bench-sieve [limit] [max_threads]
+//  1. 和逐个数存一个 bool 的朴素筛法比较 1e7 以内的每个素数；
+//  2. for_each_prime 在区间 [1e12, 1e12+1e7) 里枚举，与 is_prime 逐个判断对比；
+//  3. count_primes 数 limit(默认1e10) 以内的素数，线程数从1翻倍到 max_threads(默认4)，
+//     并与已知的 π(10^k) 对照，报告峰值内存。
+//
+
+#include "prime_sieve.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <vector>
+
+static double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<uint64_t> NaiveSieve(uint64_t n)
+{
+    std::vector<bool> composite(n);
+    std::vector<uint64_t> primes;
+    for (uint64_t p = 2; p < n; ++p)
+    {
+        if (composite[p])
+            continue;
+        primes.push_back(p);
+        for (uint64_t q = p * p; q < n; q += p)
+            composite[q] = true;
+    }
+    return primes;
+}
+
+static long PeakRssMb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t limit = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000000ULL;
+    size_t maxThreads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 4;
+    bool ok = true;
+
+    const uint64_t small = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> naive = NaiveSieve(small);
+    double naiveMs = MsSince(start);
+    start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> segmented = primes_below(small);
+    double segMs = MsSince(start);
+    printf("primes below %llu: naive %zu in %.1f ms, segmented %zu in %.1f ms%s\n", (unsigned long long)small, naive.size(),
+           naiveMs, segmented.size(), segMs, naive == segmented ? "" : "  MISMATCH");
+    ok &= naive == segmented;
+    // 每个上界和 count_primes 对一遍，覆盖最后一个字节被截掉的各种情况
+    for (uint64_t hi = 0; hi < 1000; ++hi)
+        ok &= count_primes(hi, 1) == (uint64_t)(std::lower_bound(naive.begin(), naive.end(), hi) - naive.begin());
+
+    const uint64_t lo = 1000000000000ULL, hi = lo + small;
+    std::vector<uint64_t> window;
+    start = std::chrono::steady_clock::now();
+    for_each_prime(lo, hi, [&](uint64_t p) { window.push_back(p); });
+    double windowMs = MsSince(start);
+    size_t expected = 0;
+    for (uint64_t n = lo; n < hi; ++n)
+        expected += is_prime(n);
+    bool windowOk = window.size() == expected;
+    for (uint64_t p : window)
+        windowOk &= is_prime(p);
+    printf("primes in [1e12, 1e12+1e7): %zu in %.1f ms%s\n", window.size(), windowMs, windowOk ? "" : "  MISMATCH");
+    ok &= windowOk;
+
+    // π(10^k)
+    const uint64_t known[] = {0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534, 455052511, 4118054813ULL};
+    uint64_t pow10 = 1;
+    for (int k = 0; k < 12 && pow10 <= limit; ++k, pow10 *= 10)
+        if (pow10 < limit / 10 || pow10 == limit)
+            ok &= count_primes(pow10, maxThreads) == known[k];
+
+    uint64_t first = 0;
+    double firstMs = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        start = std::chrono::steady_clock::now();
+        uint64_t n = count_primes(limit, threads);
+        double ms = MsSince(start);
+        if (threads == 1)
+        {
+            first = n;
+            firstMs = ms;
+        }
+        printf("count_primes(%llu), %zu threads: %llu in %.2f s (%.2fx)%s\n", (unsigned long long)limit, threads,
+               (unsigned long long)n, ms / 1000, firstMs / ms, n == first ? "" : "  MISMATCH");
+        ok &= n == first;
+    }
+    printf("peak RSS %ld MB\n", PeakRssMb());
+    printf("%s\n", ok ? "results match" : "MISMATCH");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "factor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * 任意精度的非负整数，用来求不会溢出的 lcmn。
+ *
+ * 数值存成 64 位的字(limb)数组，低位在前，最高位的字不为 0(0 是空数组)。两个字相乘用 unsigned __int128。
+ *
+ * 除以一个字(lcm 里的 gcd、转十进制时的 10^19)是最常用的操作。64 位 CPU 的 128/64 除法指令很慢，
+ * 编译器对 unsigned __int128 的除法还要调用库函数，所以用 Möller-Granlund 的办法：
+ * 先把除数左移到最高位是 1，算一次它的倒数 v = floor((2^128-1)/d) - 2^64，
+ * 之后每个字的除法变成两次乘法加几次加减和最多两次修正。
+ *
+ * 乘法：较短的一方不超过 kKaratsubaLimbs 个字时用竖式乘法(schoolbook)，O(n*m)；
+ * 更长时用 Karatsuba：a = a1*B + a0，b = b1*B + b0，
+ * a*b = a1*b1*B^2 + (a0*b0 + a1*b1 - (a0-a1)*(b0-b1))*B + a0*b0，三次一半长度的乘法代替四次，O(n^1.585)。
+ * 递归在一次分配好的临时空间上进行，每层不再分配 vector。
+ *
+ * lcmn_big 求一组 uint64_t 的最小公倍数：累积值 r 是大数，下一个元素 x 是一个字，
+ * gcd(r, x) = gcd(x, r mod x)，lcm = r * (x / gcd)，每个元素只需要大数对一个字的一次取模和一次乘法；
+ * x 已经整除 r 时(比如求 1..n 的最小公倍数，绝大多数元素如此)连乘法都省了。
+ * */
+class bigint {
+public:
+    // 较短一方超过这么多个字时用 Karatsuba；在仓库默认的构建(全局开了 ASan)下测出来的分界点
+    static constexpr size_t kKaratsubaLimbs = 48;
+
+    bigint() {}
+    bigint(uint64_t value) {
+        if (value)
+            limbs_.push_back(value);
+    }
+
+    bool is_zero() const { return limbs_.empty(); }
+    size_t limb_count() const { return limbs_.size(); }
+    size_t bit_length() const { return limbs_.empty() ? 0 : limbs_.size() * 64 - __builtin_clzll(limbs_.back()); }
+    const std::vector<uint64_t> &limbs() const { return limbs_; }
+
+    bool operator==(const bigint &rhs) const { return limbs_ == rhs.limbs_; }
+    bool operator!=(const bigint &rhs) const { return limbs_ != rhs.limbs_; }
+
+    // *this *= x
+    void mul_word(uint64_t x) {
+        if (x == 0) {
+            limbs_.clear();
+            return;
+        }
+        uint64_t carry = 0;
+        for (uint64_t &limb : limbs_) {
+            unsigned __int128 t = (unsigned __int128)limb * x + carry;
+            limb = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        if (carry)
+            limbs_.push_back(carry);
+    }
+
+    // *this /= d，返回余数；d 不能为 0
+    uint64_t div_word(uint64_t d) {
+        uint64_t r = divide(d, limbs_.data());
+        trim();
+        return r;
+    }
+
+    // *this % d
+    uint64_t mod_word(uint64_t d) const { return divide(d, nullptr); }
+
+    friend bigint operator*(const bigint &a, const bigint &b) {
+        bigint r;
+        if (a.is_zero() || b.is_zero())
+            return r;
+        multiply(a.limbs_.data(), a.limbs_.size(), b.limbs_.data(), b.limbs_.size(), kKaratsubaLimbs, r.limbs_);
+        r.trim();
+        return r;
+    }
+
+    // 只用竖式乘法，用来和 Karatsuba 对比
+    static bigint schoolbook(const bigint &a, const bigint &b) {
+        bigint r;
+        if (a.is_zero() || b.is_zero())
+            return r;
+        multiply(a.limbs_.data(), a.limbs_.size(), b.limbs_.data(), b.limbs_.size(), SIZE_MAX, r.limbs_);
+        r.trim();
+        return r;
+    }
+
+    // 十进制：每次除以 10^19 取出 19 位
+    std::string to_string() const {
+        if (is_zero())
+            return "0";
+        bigint t = *this;
+        std::vector<uint64_t> chunks;
+        while (!t.is_zero())
+            chunks.push_back(t.div_word(10000000000000000000ULL));
+        std::string s = std::to_string(chunks.back());
+        for (size_t i = chunks.size() - 1; i-- > 0;) {
+            std::string part = std::to_string(chunks[i]);
+            s.append(19 - part.size(), '0');
+            s += part;
+        }
+        return s;
+    }
+
+private:
+    void trim() {
+        while (!limbs_.empty() && limbs_.back() == 0)
+            limbs_.pop_back();
+    }
+
+    // Möller-Granlund：(u1, u0) / d，要求 d 最高位为 1 且 u1 < d，v 是 d 的倒数
+    static uint64_t div_2by1(uint64_t u1, uint64_t u0, uint64_t d, uint64_t v, uint64_t *r) {
+        unsigned __int128 q = (unsigned __int128)v * u1;
+        q += ((unsigned __int128)(u1 + 1) << 64) | u0;
+        uint64_t q1 = (uint64_t)(q >> 64), q0 = (uint64_t)q;
+        uint64_t rem = u0 - q1 * d;
+        if (rem > q0) {
+            --q1;
+            rem += d;
+        }
+        if (rem >= d) {
+            ++q1;
+            rem -= d;
+        }
+        *r = rem;
+        return q1;
+    }
+
+    // 商写到 quotient(可以就是 limbs_)，为空时只求余数
+    uint64_t divide(uint64_t d, uint64_t *quotient) const {
+        int s = __builtin_clzll(d);
+        uint64_t dn = d << s;
+        uint64_t v = (uint64_t)(~(unsigned __int128)0 / dn - ((unsigned __int128)1 << 64));
+        // 被除数也左移 s 位：每次取当前字的高 s 位并到余数里
+        uint64_t r = 0;
+        for (size_t i = limbs_.size(); i-- > 0;) {
+            uint64_t limb = limbs_[i];
+            uint64_t u1 = s ? r | (limb >> (64 - s)) : r;
+            uint64_t q = div_2by1(u1, limb << s, dn, v, &r);
+            if (quotient)
+                quotient[i] = q;
+        }
+        return r >> s;
+    }
+
+    // 竖式乘法，out 有 na+nb 个字并且已经清零
+    static void mul_basic(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out) {
+        for (size_t i = 0; i < na; ++i) {
+            uint64_t carry = 0, ai = a[i];
+            for (size_t j = 0; j < nb; ++j) {
+                unsigned __int128 t = (unsigned __int128)ai * b[j] + out[i + j] + carry;
+                out[i + j] = (uint64_t)t;
+                carry = (uint64_t)(t >> 64);
+            }
+            out[i + nb] = carry;
+        }
+    }
+
+    // r[0..nr) += v[0..nv)，nv <= nr，返回最高位的进位
+    static uint64_t add_to(uint64_t *r, size_t nr, const uint64_t *v, size_t nv) {
+        uint64_t carry = 0;
+        size_t i = 0;
+        for (; i < nv; ++i) {
+            unsigned __int128 t = (unsigned __int128)r[i] + v[i] + carry;
+            r[i] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        for (; carry && i < nr; ++i)
+            carry = ++r[i] == 0;
+        return carry;
+    }
+
+    // r[0..nr) -= v[0..nv)，nv <= nr，返回借位
+    static uint64_t sub_from(uint64_t *r, size_t nr, const uint64_t *v, size_t nv) {
+        uint64_t borrow = 0;
+        size_t i = 0;
+        for (; i < nv; ++i) {
+            uint64_t t = r[i] - v[i];
+            uint64_t b = r[i] < v[i];
+            r[i] = t - borrow;
+            borrow = b | (t < borrow);
+        }
+        for (; borrow && i < nr; ++i)
+            borrow = r[i]-- == 0;
+        return borrow;
+    }
+
+    // r = |x - y|，nx >= ny，r 有 nx 个字；x < y 时返回 true
+    static bool abs_diff(uint64_t *r, const uint64_t *x, size_t nx, const uint64_t *y, size_t ny) {
+        bool less = false;
+        size_t i = nx;
+        while (i > ny && x[i - 1] == 0)
+            --i;
+        if (i == ny) {
+            while (i > 0 && x[i - 1] == y[i - 1])
+                --i;
+            less = i > 0 && x[i - 1] < y[i - 1];
+        }
+        if (less) {
+            // x 比 y 小时 x 高出 ny 的部分全是 0
+            std::copy(y, y + ny, r);
+            std::fill(r + ny, r + nx, 0);
+            sub_from(r, nx, x, ny);
+        } else {
+            std::copy(x, x + nx, r);
+            sub_from(r, nx, y, ny);
+        }
+        return less;
+    }
+
+    // mul_to 需要的临时空间，和 mul_to 的递归一一对应
+    static size_t scratch_limbs(size_t na, size_t nb, size_t threshold) {
+        size_t total = 0;
+        while (true) {
+            if (na < nb)
+                std::swap(na, nb);
+            if (nb <= threshold)
+                return total;
+            size_t h = (na + 1) / 2;
+            if (nb <= h) {
+                total += 2 * nb;
+                na = nb;
+            } else {
+                total += 6 * h + 1;
+                na = nb = h;
+            }
+        }
+    }
+
+    /*
+     * out[0..na+nb) = a * b，out 原来的内容不要求清零，scratch 至少有 scratch_limbs(na, nb) 个字。
+     * 递归只在调用者给的 out/scratch 上用指针和长度工作，不分配内存。
+     *
+     * Karatsuba 用减法的形式：h = ceil(na/2)，
+     * a0*b1 + a1*b0 = a0*b0 + a1*b1 - (a0-a1)*(b0-b1)，
+     * |a0-a1|、|b0-b1| 都不超过 h 个字，不会像 (a0+a1)*(b0+b1) 那样多出一个进位字，符号单独记。
+     */
+    static void mul_to(uint64_t *out, const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *scratch,
+                       size_t threshold) {
+        if (na < nb) {
+            std::swap(a, b);
+            std::swap(na, nb);
+        }
+        size_t n = na + nb;
+        if (nb <= threshold) {
+            std::fill(out, out + n, 0);
+            mul_basic(a, na, b, nb, out);
+            return;
+        }
+        size_t h = (na + 1) / 2;
+        if (nb <= h) {
+            // 长短悬殊：a 按 nb 个字一段切开，每段乘 b 再错位累加
+            uint64_t *part = scratch, *rest = scratch + 2 * nb;
+            std::fill(out, out + n, 0);
+            for (size_t off = 0; off < na; off += nb) {
+                size_t len = std::min(nb, na - off);
+                mul_to(part, a + off, len, b, nb, rest, threshold);
+                add_to(out + off, n - off, part, len + nb);
+            }
+            return;
+        }
+
+        // scratch：da(h) db(h) dd(2h) t(2h+1)，后面留给下一层
+        uint64_t *da = scratch, *db = da + h, *dd = db + h, *t = dd + 2 * h, *rest = t + 2 * h + 1;
+        bool negative = abs_diff(da, a, h, a + h, na - h) != abs_diff(db, b, h, b + h, nb - h);
+        mul_to(out, a, h, b, h, rest, threshold);                         // z0 -> out[0..2h)
+        mul_to(out + 2 * h, a + h, na - h, b + h, nb - h, rest, threshold); // z2 -> out[2h..n)
+        mul_to(dd, da, h, db, h, rest, threshold);
+
+        // t = z0 + z2 - (a0-a1)*(b0-b1)，即 a0*b1 + a1*b0，再加到 out[h..]
+        std::copy(out, out + 2 * h, t);
+        t[2 * h] = 0;
+        add_to(t, 2 * h + 1, out + 2 * h, n - 2 * h);
+        if (negative)
+            add_to(t, 2 * h + 1, dd, 2 * h);
+        else
+            sub_from(t, 2 * h + 1, dd, 2 * h);
+        // 积一共 n 个字，t 超出 out 的高位一定是 0
+        add_to(out + h, n - h, t, std::min(2 * h + 1, n - h));
+    }
+
+    // 结果写到 out(na+nb 个字，可能有前导 0)，临时空间只分配一次
+    static void multiply(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, size_t threshold, std::vector<uint64_t> &out) {
+        out.resize(na + nb);
+        std::vector<uint64_t> scratch(scratch_limbs(na, nb, threshold));
+        mul_to(out.data(), a, na, b, nb, scratch.data(), threshold);
+    }
+
+    std::vector<uint64_t> limbs_;
+};
+
+//n个数的最小公倍数，精确值；有元素为 0 时结果为 0，len 为 0 时也是 0(与 lcmn 相同)
+inline bigint lcmn_big(const uint64_t *arr, size_t len) {
+    if (len == 0)
+        return bigint();
+    bigint r(arr[0]);
+    for (size_t i = 1; i < len && !r.is_zero(); ++i) {
+        uint64_t x = arr[i];
+        if (x == 0)
+            return bigint();
+        // x 已经整除 r 时 r 不变，只有取模的代价
+        uint64_t g = gcd(x, r.mod_word(x));
+        if (g == x)
+            continue;
+        if (g != 1)
+            x /= g;
+        r.mul_word(x);
+    }
+    return r;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "factor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*
+ * 编译期生成的查找表，都是 constexpr 变量模板：表的内容在编译时算好放进只读数据段，
+ * 程序启动时不用再算，也能直接用在 static_assert 和模板实参里。
+ *
+ *  smallest_factor_table<N>   0..N-1 每个数的最小质因数(0 和 1 是 0)，用筛法生成，元素类型是能放下 N 的最小无符号整数；
+ *  small_primes<N>            小于 N 的素数，长度 kPrimeCountBelow<N> 也是编译期算出来的；
+ *  inverse_table<M, N>        0..N-1 每个数模 M 的逆元，不存在时是 0；M 是素数时用 inv[a] = -(M/a) * inv[M%a] 递推，
+ *                             每项一次乘法，否则用扩展欧几里得算法(modular.h 的 mod_inverse)逐个求；
+ *  factorize_small(n, out)    n < kSmallFactorLimit 时查最小质因数表分解，每一步一次查表一次除法，结果从小到大。
+ *
+ * 表的类型是 const_table(只包一个 C 数组)而不是 std::array：libstdc++ 的 std::array::operator[] 在编译期求值时
+ * 每次下标都要展开好几层函数调用，生成 65536 项的最小质因数表要 3 秒多，直接写数组成员不到 1 秒。
+ * 用到表的函数都是模板，只有真正调用时才生成表，只包含这个头文件不增加编译时间。
+ *
+ * GCC 对编译期求值有限制(单个循环最多 -fconstexpr-loop-limit=262144 次，总共 -fconstexpr-ops-limit=2^25 步)，
+ * N 到几十万都没问题，更大的表需要调大这两个参数，或者改成运行时生成。
+ * */
+//编译期生成的表：一个定长数组，可以下标、遍历
+template <typename T, size_t N> struct const_table {
+    T data[N];
+
+    constexpr const T &operator[](size_t i) const { return data[i]; }
+    constexpr size_t size() const { return N; }
+    constexpr const T *begin() const { return data; }
+    constexpr const T *end() const { return data + N; }
+};
+
+namespace table_detail {
+    // 能放下 0..N-1 的最小无符号整数类型
+    template <uint64_t N>
+    using index_t = std::conditional_t<(N <= (1u << 8)), uint8_t, std::conditional_t<(N <= (1u << 16)), uint16_t, uint32_t>>;
+
+    template <uint32_t N> constexpr const_table<index_t<N>, N> make_smallest_factor() {
+        const_table<index_t<N>, N> spf = {};
+        for (uint64_t p = 2; p < N; ++p) {
+            if (spf.data[p] != 0)
+                continue;
+            spf.data[p] = (index_t<N>)p;
+            for (uint64_t q = p * p; q < N; q += p)
+                if (spf.data[q] == 0)
+                    spf.data[q] = (index_t<N>)p;
+        }
+        return spf;
+    }
+}
+
+//编译期生成的最小质因数表
+template <uint32_t N> inline constexpr auto smallest_factor_table = table_detail::make_smallest_factor<N>();
+
+//小于 N 的素数个数
+template <uint32_t N> inline constexpr size_t kPrimeCountBelow = [] {
+    size_t count = 0;
+    for (uint32_t n = 2; n < N; ++n)
+        count += smallest_factor_table<N>.data[n] == n;
+    return count;
+}();
+
+namespace table_detail {
+    template <uint32_t N> constexpr const_table<uint32_t, kPrimeCountBelow<N>> make_small_primes() {
+        const_table<uint32_t, kPrimeCountBelow<N>> primes = {};
+        size_t count = 0;
+        for (uint32_t n = 2; n < N; ++n)
+            if (smallest_factor_table<N>.data[n] == n)
+                primes.data[count++] = n;
+        return primes;
+    }
+}
+
+//编译期生成的小于 N 的素数表
+template <uint32_t N> inline constexpr auto small_primes = table_detail::make_small_primes<N>();
+
+namespace table_detail {
+    template <uint32_t M, uint32_t N> constexpr const_table<index_t<M>, N> make_inverse_table() {
+        const_table<index_t<M>, N> inv = {};
+        bool prime = M >= 2;
+        for (uint64_t d = 2; d * d <= M && prime; ++d)
+            prime = M % d != 0;
+        for (uint64_t a = 1; a < N; ++a) {
+            if (!prime || a >= M)
+                inv.data[a] = (index_t<M>)mod_inverse(a, M);
+            else if (a == 1)
+                inv.data[a] = 1;
+            else // M = (M/a)*a + M%a，两边模 M 再乘上 a^-1 * (M%a)^-1，每项 O(1)
+                inv.data[a] = (index_t<M>)((M - M / a) * inv.data[M % a] % M);
+        }
+        return inv;
+    }
+}
+
+//编译期生成的逆元表：inverse_table<M, N>[a] * a ≡ 1 (mod M)
+template <uint32_t M, uint32_t N = M> inline constexpr auto inverse_table = table_detail::make_inverse_table<M, N>();
+
+//factorize_small 能分解的上限(不含)
+constexpr uint32_t kSmallFactorLimit = 1u << 16;
+
+//n 的最小质因数，n < Limit
+template <uint32_t Limit = kSmallFactorLimit> constexpr uint32_t smallest_prime_factor(uint32_t n) {
+    return smallest_factor_table<Limit>[n];
+}
+
+//分解 n < Limit，质因数从小到大写入 out(最多 32 个)，返回个数
+template <uint32_t Limit = kSmallFactorLimit> constexpr size_t factorize_small(uint32_t n, uint32_t *out) {
+    size_t count = 0;
+    for (; n > 1; n /= out[count++])
+        out[count] = smallest_factor_table<Limit>[n];
+    return count;
+}
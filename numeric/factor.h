@@ -1,38 +1,301 @@
+#pragma once
+
+#include "modular.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <thread>
+#include <vector>
+
+/*
+ * gcd 用 Stein 的二进制算法：只用移位、减法和数尾零(count trailing zeros，x86 上是一条 tzcnt/bsf 指令)，
+ * 不用除法。64 位除法要几十个周期，辗转相除法每一步都要做一次。
+ *
+ * 先把两个数共同的因子 2 提出来，然后两个数都是奇数：大的减小的，差是偶数，去掉差的尾零又是奇数，
+ * 如此反复直到两个数相等。差的尾零从减法结果直接算，不等取绝对值之后再算，缩短每一轮的依赖链。
+ *
+ * gcdn/lcmn 逐个累积，不再递归(递归深度等于数组长度，百万个元素会把栈用完)；
+ * gcdn 累积到 1 就提前结束，lcmn 累积到 0 也一样。
+ *
+ * gcdn 的累积值通常比后面的元素小得多(lcmn 则相反)，二进制算法对大小悬殊的两个数要减很多轮，
+ * 所以先用一次取模把大的缩到小的以下(整除时直接得到结果)，再用二进制算法。
+ *
+ * lcm/lcmn 超出 uint64_t 时悄悄回绕；lcm_checked/lcmn_checked 用 __builtin_mul_overflow 检查乘法，溢出时返回 false。
+ * 要精确结果用 bigint.h 里的 lcmn_big。
+ *
+ * gcd_batch 一次算很多对互相独立的 gcd。试过把几对交错在一起无分支地同步推进(模拟 SIMD 通道)，
+ * AVX2 没有 64 位的数尾零和无符号比较，只能用标量寄存器交错，结果和逐个调用 gcd 一样快甚至更慢：
+ * 乱序执行本来就会让相邻几次互相独立的 gcd 重叠执行，交错只多了等最慢通道的开销。所以这里就是逐个调用。
+ *
+ * 这一组函数都是 constexpr(C++14 起 constexpr 函数里可以有循环和局部变量，GCC 的 __builtin_ctzll 和
+ * __builtin_mul_overflow 也能在编译期求值)：参数是常量时可以直接用在 static_assert、模板实参和数组长度里，
+ * 编译期算好，不占运行时间；参数不是常量时和普通的 inline 函数一样。编译期生成的查找表见 constexpr_table.h。
+ * */
 
-//两个数求最大公约数 (since C++17) 辗转相除法（也叫欧几里得算法）
-uint64_t gcd(uint64_t __m, uint64_t __n)
+//两个数求最大公约数 (since C++17) Stein 二进制算法
+constexpr uint64_t gcd(uint64_t __m, uint64_t __n)
 {
-    while (__n != 0) {
-        uint64_t __t = __m % __n;
-        __m = __n;
-        __n = __t;
+    if (__m == 0 || __n == 0)
+        return __m | __n;
+    int __shift = __builtin_ctzll(__m | __n);
+    __m >>= __builtin_ctzll(__m);
+    __n >>= __builtin_ctzll(__n);
+    while (__m != __n) {
+        uint64_t __d = __n - __m;
+        int __z = __builtin_ctzll(__d);
+        uint64_t __min = __m < __n ? __m : __n;
+        __n = (__m < __n ? __d : __m - __n) >> __z;
+        __m = __min;
     }
-    return __m;
+    return __m << __shift;
 }
 
 //求最小公倍数 (since C++17)
-uint64_t lcm(uint64_t __m, uint64_t __n) {
-    return (__m != 0 && __n != 0) ? (abs(__m) / gcd(__m, __n)) * abs(__n) : 0;
+constexpr uint64_t lcm(uint64_t __m, uint64_t __n) {
+    return (__m != 0 && __n != 0) ? (__m / gcd(__m, __n)) * __n : 0;
+}
+
+
+//求最小公倍数，溢出时返回 false，*out 不变
+constexpr bool lcm_checked(uint64_t __m, uint64_t __n, uint64_t *out) {
+    if (__m == 0 || __n == 0) {
+        *out = 0;
+        return true;
+    }
+    return !__builtin_mul_overflow(__m / gcd(__m, __n), __n, out);
 }
 
 
 //n个数求最大公约数
-uint64_t gcdn(uint64_t *arr, int len) {
-    if (len == 0) {
+constexpr uint64_t gcdn(const uint64_t *arr, size_t len) {
+    if (len == 0)
         return 0;
-    } else if (len == 1)
-        return (*arr);
-    return gcd(arr[len - 1], gcdn(arr, len - 1));
+    uint64_t __r = arr[0];
+    for (size_t __i = 1; __i < len && __r != 1; ++__i)
+        __r = __r == 0 ? arr[__i] : gcd(__r, arr[__i] % __r);
+    return __r;
 }
 
 //求n个数的最小公倍数
-uint64_t lcmn(uint64_t *arr, int len) {
-    if (len == 0) {
+constexpr uint64_t lcmn(const uint64_t *arr, size_t len) {
+    if (len == 0)
         return 0;
-    } else if (len == 1)
-        return *arr;
-    else
-        return lcm(arr[len - 1], lcmn(arr, len - 1));
+    uint64_t __r = arr[0];
+    for (size_t __i = 1; __i < len && __r != 0; ++__i) {
+        uint64_t __x = arr[__i];
+        __r = __x == 0 ? 0 : __r / gcd(__x, __r % __x) * __x;
+    }
+    return __r;
+}
+
+//求n个数的最小公倍数，溢出时返回 false，*overflow_at(不为空时)是第一个放不下的元素的下标；不溢出时返回 true
+constexpr bool lcmn_checked(const uint64_t *arr, size_t len, uint64_t *out, size_t *overflow_at = nullptr) {
+    uint64_t __r = len == 0 ? 0 : arr[0];
+    for (size_t __i = 1; __i < len && __r != 0; ++__i) {
+        uint64_t __x = arr[__i];
+        if (__x == 0)
+            __r = 0;
+        else if (__builtin_mul_overflow(__r / gcd(__x, __r % __x), __x, &__r)) {
+            if (overflow_at)
+                *overflow_at = __i;
+            return false;
+        }
+    }
+    *out = __r;
+    return true;
+}
+
+//一次求 len 对数的最大公约数：out[i] = gcd(a[i], b[i])，out 可以和 a 或 b 是同一个数组
+constexpr void gcd_batch(const uint64_t *a, const uint64_t *b, uint64_t *out, size_t len) {
+    for (size_t __i = 0; __i < len; ++__i)
+        out[__i] = gcd(a[__i], b[__i]);
+}
+
+/*
+ * 质因数分解 factorize(n)，返回从小到大排列的质因数(重复的因数重复出现，n 为 0 或 1 时为空)：
+ *  1. 试除：用小于 kTrialPrimeLimit 的素数试除。每个素数 p 预先算好它模 2^64 的逆元 inv 和 lim = (2^64-1)/p，
+ *     n 能被 p 整除当且仅当 n*inv <= lim(乘法结果按 2^64 回绕)，一次乘法一次比较，不用除法；这张表是编译期算好的；
+ *     剩下的部分小于 kTrialPrimeLimit^2 时一定是素数。
+ *  2. Miller-Rabin：对 64 位整数用固定的 7 个底数{2, 325, 9375, 28178, 450775, 9780504, 1795265022}就是确定性的，不会误判。
+ *  3. Pollard-Brent rho：x -> x^2+c 的序列模 n 的某个因子 p 会在大约 sqrt(p) 步内进入循环，
+ *     用 Brent 的方法找循环，并且把 128 个 |x-y| 乘在一起才求一次 gcd；找到的因子递归分解。
+ * 后两步的模乘都用 Montgomery 乘法(modular.h 里的 mont64)：数值存成 x*2^64 mod n，两个数的积只需要乘法和移位就能约简回来，不用 128 位除法。
+ *
+ * factorize_batch 用多个线程分解一批数，线程抢着领下一个数。试过在一个线程里把几个数的 rho 交错着走，
+ * 想让几条模乘的依赖链重叠，但 rho 本身已经有 y 和累乘的 q 两条独立的链，再交错也没有更快。
+ * 平衡的 64 位半素数(两个约 32 位的素数之积)是最难的情况，rho 大约要走 2^16 步，几百微秒；
+ * 有小因子的数(大多数随机数)快得多。
+ * */
+
+//试除用的素数上限
+constexpr uint32_t kTrialPrimeLimit = 1024;
+
+namespace factor_detail {
+    struct trial_prime {
+        uint64_t p, inv, lim;
+    };
+
+    // 小于 kTrialPrimeLimit 的奇素数的个数
+    constexpr size_t odd_prime_count() {
+        bool composite[kTrialPrimeLimit] = {};
+        size_t count = 0;
+        for (uint64_t p = 3; p < kTrialPrimeLimit; p += 2) {
+            if (composite[p])
+                continue;
+            ++count;
+            for (uint64_t q = p * p; q < kTrialPrimeLimit; q += 2 * p)
+                composite[q] = true;
+        }
+        return count;
+    }
+
+    // 小于 kTrialPrimeLimit 的奇素数，编译期生成
+    constexpr std::array<trial_prime, odd_prime_count()> make_trial_primes() {
+        std::array<trial_prime, odd_prime_count()> v = {};
+        bool composite[kTrialPrimeLimit] = {};
+        size_t count = 0;
+        for (uint64_t p = 3; p < kTrialPrimeLimit; p += 2) {
+            if (composite[p])
+                continue;
+            for (uint64_t q = p * p; q < kTrialPrimeLimit; q += 2 * p)
+                composite[q] = true;
+            uint64_t inv = p;
+            for (int i = 0; i < 5; ++i)
+                inv *= 2 - p * inv;
+            v[count++] = {p, inv, UINT64_MAX / p};
+        }
+        return v;
+    }
+
+    inline constexpr auto kTrialPrimes = make_trial_primes();
+
+    constexpr const std::array<trial_prime, odd_prime_count()> &trial_primes() { return kTrialPrimes; }
+
+    inline bool miller_rabin(uint64_t n) {
+        mont64 m(n);
+        uint64_t d = n - 1;
+        int s = __builtin_ctzll(d);
+        d >>= s;
+        uint64_t minus_one = m.to(n - 1);
+        for (uint64_t a : {2ULL, 325ULL, 9375ULL, 28178ULL, 450775ULL, 9780504ULL, 1795265022ULL}) {
+            if (a % n == 0)
+                continue;
+            uint64_t x = m.pow(m.to(a), d);
+            if (x == m.one || x == minus_one)
+                continue;
+            bool composite = true;
+            for (int i = 1; i < s && composite; ++i) {
+                x = m.mul(x, x);
+                composite = x != minus_one;
+            }
+            if (composite)
+                return false;
+        }
+        return true;
+    }
+
+    // n 是奇合数，返回一个非平凡因子
+    inline uint64_t pollard_brent(uint64_t n) {
+        constexpr uint64_t kBatch = 128;
+        mont64 m(n);
+        for (uint64_t c0 = 1;; ++c0) {
+            uint64_t c = m.to(c0), y = m.to(2), x = y, ys = y, q = m.one, g = 1;
+            auto f = [&](uint64_t v) { return m.add(m.mul(v, v), c); };
+            for (uint64_t r = 1; g == 1; r <<= 1) {
+                x = y;
+                for (uint64_t i = 0; i < r; ++i)
+                    y = f(y);
+                for (uint64_t k = 0; k < r && g == 1; k += kBatch) {
+                    ys = y;
+                    for (uint64_t i = 0; i < std::min(kBatch, r - k); ++i) {
+                        y = f(y);
+                        q = m.mul(q, x > y ? x - y : y - x);
+                    }
+                    // q 是 Montgomery 形式，多乘的 2^64 与 n 互素，不影响 gcd
+                    g = gcd(q, n);
+                }
+            }
+            if (g == n) {
+                // 一批里乘到了 0，退回这一批的开头逐步找
+                do {
+                    ys = f(ys);
+                    g = gcd(x > ys ? x - ys : ys - x, n);
+                } while (g == 1);
+            }
+            if (g != n)
+                return g;
+        }
+    }
+
+    // n 没有小于 kTrialPrimeLimit 的因子
+    inline void factor_large(uint64_t n, std::vector<uint64_t> &out) {
+        if (n == 1)
+            return;
+        if (n < (uint64_t)kTrialPrimeLimit * kTrialPrimeLimit || miller_rabin(n)) {
+            out.push_back(n);
+            return;
+        }
+        uint64_t d = pollard_brent(n);
+        factor_large(d, out);
+        factor_large(n / d, out);
+    }
+}
+
+//判断素数
+inline bool is_prime(uint64_t n) {
+    if (n < 2)
+        return false;
+    if (n % 2 == 0)
+        return n == 2;
+    for (const auto &tp : factor_detail::trial_primes()) {
+        if (tp.p * tp.p > n)
+            return true;
+        if (n * tp.inv <= tp.lim)
+            return n == tp.p;
+    }
+    return factor_detail::miller_rabin(n);
+}
+
+//质因数分解，结果从小到大排列
+inline std::vector<uint64_t> factorize(uint64_t n) {
+    std::vector<uint64_t> out;
+    if (n < 2)
+        return out;
+    int twos = __builtin_ctzll(n);
+    out.insert(out.end(), twos, 2);
+    n >>= twos;
+    for (const auto &tp : factor_detail::trial_primes()) {
+        if (tp.p * tp.p > n)
+            break;
+        while (n * tp.inv <= tp.lim) {
+            out.push_back(tp.p);
+            n = n * tp.inv; // 整除时乘逆元就是商
+        }
+    }
+    size_t sorted = out.size();
+    factor_detail::factor_large(n, out);
+    std::sort(out.begin() + sorted, out.end());
+    return out;
+}
+
+//分解一批数：out[i] = factorize(in[i])；threads 为 0 时用硬件线程数
+inline void factorize_batch(const uint64_t *in, size_t len, std::vector<uint64_t> *out, size_t threads = 0) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max<size_t>(len, 1));
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < len;)
+            out[i] = factorize(in[i]);
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t)
+        workers.emplace_back(work);
+    work();
+    for (auto &worker : workers)
+        worker.join();
 }
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * 64 位模数的模乘、模幂和逆元。a*b mod n 直接写成 (unsigned __int128)a * b % n 会调用 128 位除法(__umodti3)，
+ * 最后是一条 div 指令，十几到几十个周期，并且不能流水；这里有两种只用乘法的约简：
+ *
+ *  mont64   Montgomery：数值存成 x*2^64 mod n(Montgomery 形式)，两个数的积 t 约简成 t/2^64 mod n 只要两次乘法和一次减法。
+ *           n 必须是奇数；进出 Montgomery 形式各要一次乘法(to/from)，适合连续做很多次模乘，比如模幂、Pollard rho。
+ *  barrett64 Barrett：n 有 k 位，预先算好 m = floor(4^k/n)，商用 ((t >> (k-1)) * m) >> (k+1) 估计，最多小 2，余数最多再减两次 n。
+ *           数值就是普通的余数，不用转换，n 可以是偶数；约简要两次乘法，比 Montgomery 多一次 128 位移位和一次比较。
+ *           余数在约简过程中可能到 3n，所以 n 要小于 2^62。
+ *           128/64 位除法快的 CPU 上(十几个周期)，Barrett 单次模乘的延迟不比 __int128 取模短，
+ *           好处在吞吐：乘法可以流水，除法不行，所以批量的模幂和逆元比 __int128 取模快一倍左右。
+ *
+ * 两个类型接口相同：to/from 在普通余数和内部表示之间转换(barrett64 里什么都不做)，
+ * mul/add/sub/pow/inverse 都作用在内部表示上，输入必须已经约简到 [0, n)；one 是 1 的内部表示。
+ * mulmod/powmod 是普通余数进、普通余数出的便利函数。
+ *
+ * 批量接口 mul_batch/pow_batch/inverse_batch(数组进、数组出)对两种类型都能用：
+ *  - mul_batch 每个元素互相独立、没有分支，乱序执行可以让相邻元素的乘法重叠；
+ *  - pow_batch 所有元素用同一个指数，按指数的位从高到低，每一位对一块(kPowBlock 个)元素都做一遍平方和乘法，
+ *    一块里的元素互相独立，而逐个求模幂时每一步都要等上一步的乘法结果；
+ *  - inverse_batch 用 Montgomery 的技巧：先求前缀积，只对总乘积求一次逆元(扩展欧几里得算法)，
+ *    再从后往前用 3 次乘法还原每个元素的逆元，len 个逆元只要一次除法链。
+ * AVX2 没有 64x64->128 位的乘法(只有 32x32->64 的 vpmuludq)，64 位模乘没法被编译器自动向量化成 SIMD，
+ * 批量接口靠的是指令级并行。
+ * */
+
+//a 模 m 的逆元，不存在(a 与 m 不互素)时返回 0
+constexpr uint64_t mod_inverse(uint64_t a, uint64_t m) {
+    if (m <= 1)
+        return 0;
+    __int128 t0 = 0, t1 = 1;
+    uint64_t r0 = m, r1 = a % m;
+    while (r1 != 0) {
+        uint64_t q = r0 / r1;
+        uint64_t r = r0 - q * r1;
+        r0 = r1;
+        r1 = r;
+        __int128 t = t0 - (__int128)q * t1;
+        t0 = t1;
+        t1 = t;
+    }
+    if (r0 != 1)
+        return 0;
+    return (uint64_t)(t0 < 0 ? t0 + m : t0);
+}
+
+//模 n 的 Montgomery 乘法，n 必须是奇数
+struct mont64 {
+    uint64_t n;
+    uint64_t inv; // n 模 2^64 的逆元
+    uint64_t one; // 2^64 mod n，即 1 的 Montgomery 形式
+    uint64_t r2;  // 2^128 mod n
+
+    explicit mont64(uint64_t modulus) : n(modulus) {
+        inv = n; // 牛顿迭代，每次正确的位数翻倍：3 -> 6 -> 12 -> 24 -> 48 -> 96
+        for (int i = 0; i < 5; ++i)
+            inv *= 2 - n * inv;
+        one = (0 - n) % n;
+        r2 = (unsigned __int128)one * one % n;
+    }
+
+    // a*b/2^64 mod n：t - m*n 的低 64 位是 0，只需要高 64 位相减
+    uint64_t mul(uint64_t a, uint64_t b) const {
+        unsigned __int128 t = (unsigned __int128)a * b;
+        uint64_t m = (uint64_t)t * inv;
+        uint64_t hi = (uint64_t)(t >> 64), mn = (uint64_t)(((unsigned __int128)m * n) >> 64);
+        return hi >= mn ? hi - mn : hi - mn + n;
+    }
+    uint64_t add(uint64_t a, uint64_t b) const {
+        uint64_t s = a + b;
+        return s >= n || s < a ? s - n : s;
+    }
+    uint64_t sub(uint64_t a, uint64_t b) const { return a >= b ? a - b : a - b + n; }
+    uint64_t to(uint64_t x) const { return mul(x % n, r2); }
+    uint64_t from(uint64_t x) const { return mul(x, 1); }
+    uint64_t pow(uint64_t base, uint64_t e) const {
+        uint64_t r = one;
+        for (; e; e >>= 1, base = mul(base, base))
+            if (e & 1)
+                r = mul(r, base);
+        return r;
+    }
+    // 逆元的 Montgomery 形式，不存在时返回 0
+    uint64_t inverse(uint64_t x) const { return to(mod_inverse(from(x), n)); }
+
+    // 普通余数进出：a*b mod n，a、b 都小于 n。mul(a, b) 多除了一个 2^64，再乘 r2 补回来
+    uint64_t mulmod(uint64_t a, uint64_t b) const { return mul(mul(a, b), r2); }
+    uint64_t powmod(uint64_t base, uint64_t e) const { return from(pow(to(base), e)); }
+};
+
+//模 n 的 Barrett 约简，2 <= n < 2^62
+struct barrett64 {
+    uint64_t n;
+    uint64_t m;  // floor(4^k / n)，不超过 k+1 位
+    int k;       // n 的位数
+    uint64_t one;
+
+    explicit barrett64(uint64_t modulus) : n(modulus), one(1) {
+        k = 64 - __builtin_clzll(n);
+        m = (uint64_t)(((unsigned __int128)1 << (2 * k)) / n);
+    }
+
+    // t mod n，t < n^2。q = ((t >> (k-1)) * m) >> (k+1) 比真正的商最多小 2，余数 t - q*n < 3n，只用低 64 位算。
+    // 两次移位的位数都小于 64，拆成 64 位的移位拼起来，编译器不用再处理移 64 位以上的情况
+    uint64_t reduce(unsigned __int128 t) const {
+        uint64_t t_hi = (uint64_t)(t >> 64), t_lo = (uint64_t)t;
+        uint64_t q1 = (t_hi << (65 - k)) | (t_lo >> (k - 1));
+        unsigned __int128 q2 = (unsigned __int128)q1 * m;
+        uint64_t q = ((uint64_t)(q2 >> 64) << (63 - k)) | ((uint64_t)q2 >> (k + 1));
+        uint64_t r = t_lo - q * n;
+        // 减几次 n 取决于数据，写成分支会经常预测失败，用掩码
+        r -= n & (0 - (uint64_t)(r >= n));
+        r -= n & (0 - (uint64_t)(r >= n));
+        return r;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce((unsigned __int128)a * b); }
+    uint64_t add(uint64_t a, uint64_t b) const {
+        uint64_t s = a + b;
+        return s >= n ? s - n : s;
+    }
+    uint64_t sub(uint64_t a, uint64_t b) const { return a >= b ? a - b : a - b + n; }
+    uint64_t to(uint64_t x) const { return x % n; }
+    uint64_t from(uint64_t x) const { return x; }
+    uint64_t pow(uint64_t base, uint64_t e) const {
+        uint64_t r = one;
+        for (; e; e >>= 1, base = mul(base, base))
+            if (e & 1)
+                r = mul(r, base);
+        return r;
+    }
+    uint64_t inverse(uint64_t x) const { return mod_inverse(x, n); }
+
+    uint64_t mulmod(uint64_t a, uint64_t b) const { return mul(a, b); }
+    uint64_t powmod(uint64_t base, uint64_t e) const { return pow(to(base), e); }
+};
+
+namespace modular_detail {
+    // pow_batch 一次处理的元素个数
+    constexpr size_t kPowBlock = 16;
+}
+
+//out[i] = a[i]*b[i]，都是 mod 的内部表示；out 可以和 a 或 b 是同一个数组
+template <typename Mod> void mul_batch(const Mod &mod, const uint64_t *a, const uint64_t *b, uint64_t *out, size_t len) {
+    for (size_t i = 0; i < len; ++i)
+        out[i] = mod.mul(a[i], b[i]);
+}
+
+//out[i] = base[i]^e，都是 mod 的内部表示；out 可以和 base 是同一个数组
+template <typename Mod> void pow_batch(const Mod &mod, const uint64_t *base, uint64_t e, uint64_t *out, size_t len) {
+    using modular_detail::kPowBlock;
+    int top = e ? 63 - __builtin_clzll(e) : -1;
+    for (size_t begin = 0; begin < len; begin += kPowBlock) {
+        size_t n = len - begin < kPowBlock ? len - begin : kPowBlock;
+        uint64_t b[kPowBlock], r[kPowBlock];
+        for (size_t i = 0; i < n; ++i) {
+            b[i] = base[begin + i];
+            r[i] = top >= 0 ? b[i] : mod.one;
+        }
+        // 从最高位的下一位开始：先平方，这一位是 1 再乘底数
+        for (int bit = top - 1; bit >= 0; --bit) {
+            for (size_t i = 0; i < n; ++i)
+                r[i] = mod.mul(r[i], r[i]);
+            if ((e >> bit) & 1)
+                for (size_t i = 0; i < n; ++i)
+                    r[i] = mod.mul(r[i], b[i]);
+        }
+        for (size_t i = 0; i < n; ++i)
+            out[begin + i] = r[i];
+    }
+}
+
+//out[i] = in[i] 的逆元，都是 mod 的内部表示；没有逆元的元素结果是 0。out 不能和 in 是同一个数组
+template <typename Mod> void inverse_batch(const Mod &mod, const uint64_t *in, uint64_t *out, size_t len) {
+    if (len == 0)
+        return;
+    // out 先存前缀积
+    uint64_t acc = mod.one;
+    for (size_t i = 0; i < len; ++i) {
+        out[i] = acc;
+        acc = mod.mul(acc, in[i]);
+    }
+    uint64_t inv = mod.inverse(acc);
+    if (inv == 0) {
+        // 有元素不可逆，总乘积也不可逆，逐个求
+        for (size_t i = 0; i < len; ++i)
+            out[i] = mod.inverse(in[i]);
+        return;
+    }
+    // inv 是 in[0..i] 之积的逆元：乘上 in[0..i-1] 之积得到 in[i] 的逆元，乘上 in[i] 得到 in[0..i-1] 之积的逆元
+    for (size_t i = len; i-- > 0;) {
+        uint64_t prefix = out[i];
+        out[i] = mod.mul(inv, prefix);
+        inv = mod.mul(inv, in[i]);
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "factor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * gcd 和 lcm 都满足结合律，n 个数的 gcd/lcm 可以分段求，再把各段的结果合起来：
+ * 数组切成若干块，线程池里的线程抢着领块(块数是线程数的几倍，快的线程多做几块)，每块逐个累积，
+ * 最后把各块的结果按块的顺序合并。
+ *
+ * 提前结束：gcd 一旦是 1 就不会再变，lcm 一旦是 0(有元素是 0)或者溢出也不用再算。
+ * 任何一块遇到这种情况就置一个共享标记，其它线程每处理 kCheckEvery 个元素看一次标记，看到就放弃手上的块。
+ *
+ * lcmn_parallel 和 lcmn_checked 一样检查溢出：溢出后的回绕值和计算顺序有关，分段计算没法和顺序计算一致，
+ * 所以溢出时返回 false，不给出结果。有元素是 0 时结果总是 0，即使别的块先溢出了
+ * (lcmn_checked 顺序计算，0 前面就溢出时返回 false)，这样结果不随线程的快慢变化。
+ *
+ * reduce_pool 的调用线程也参与计算，threads 个线程就是 threads-1 个工作线程加调用者。
+ * 同一时刻只能有一个线程调用 run。
+ * */
+class reduce_pool {
+public:
+    explicit reduce_pool(size_t threads) {
+        for (size_t i = 1; i < std::max<size_t>(threads, 1); ++i)
+            workers_.emplace_back([this]() { work(); });
+    }
+
+    ~reduce_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto &worker : workers_)
+            worker.join();
+    }
+
+    reduce_pool(const reduce_pool &) = delete;
+    reduce_pool &operator=(const reduce_pool &) = delete;
+
+    size_t size() const { return workers_.size() + 1; }
+
+    // 对 0..tasks-1 每个编号调用一次 body，全部完成后返回
+    void run(size_t tasks, const std::function<void(size_t)> &body) {
+        if (tasks == 0)
+            return;
+        {
+            // 上一轮醒得晚的线程可能还拿着上一轮的任务数在领任务，等它们退出再重置计数
+            std::unique_lock<std::mutex> lock(mutex_);
+            finished_.wait(lock, [this]() { return active_ == 0; });
+            body_ = &body;
+            tasks_ = tasks;
+            next_.store(0, std::memory_order_relaxed);
+            done_ = 0;
+            ++generation_;
+        }
+        wake_.notify_all();
+        drain(body, tasks);
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this]() { return done_ == tasks_; });
+    }
+
+private:
+    // 领任务直到领完
+    void drain(const std::function<void(size_t)> &body, size_t tasks) {
+        size_t finished = 0;
+        for (size_t task; (task = next_.fetch_add(1, std::memory_order_relaxed)) < tasks; ++finished)
+            body(task);
+        if (finished) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ += finished;
+            if (done_ == tasks_)
+                finished_.notify_all();
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            const std::function<void(size_t)> *body;
+            size_t tasks;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&]() { return stopping_ || generation_ != seen; });
+                if (stopping_)
+                    return;
+                seen = generation_;
+                body = body_;
+                tasks = tasks_;
+                ++active_;
+            }
+            drain(*body, tasks);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0)
+                finished_.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_, finished_;
+    const std::function<void(size_t)> *body_ = nullptr;
+    size_t tasks_ = 0;
+    size_t done_ = 0;
+    size_t active_ = 0; // 正在领任务的工作线程数
+    std::atomic<size_t> next_{0};
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+};
+
+namespace parallel_detail {
+    // 每处理这么多个元素看一次提前结束的标记
+    constexpr size_t kCheckEvery = 4096;
+    // 每个线程平均分到的块数
+    constexpr size_t kChunksPerThread = 4;
+
+    inline size_t chunk_count(const reduce_pool &pool, size_t len) {
+        return std::max<size_t>(1, std::min(len / kCheckEvery, pool.size() * kChunksPerThread));
+    }
+}
+
+//n个数求最大公约数，分块并行
+inline uint64_t gcdn_parallel(reduce_pool &pool, const uint64_t *arr, size_t len) {
+    using namespace parallel_detail;
+    size_t chunks = chunk_count(pool, len);
+    if (chunks == 1)
+        return gcdn(arr, len);
+    std::vector<uint64_t> partial(chunks, 0);
+    std::atomic<bool> one(false);
+    pool.run(chunks, [&](size_t c) {
+        size_t begin = len * c / chunks, end = len * (c + 1) / chunks;
+        uint64_t r = 0;
+        for (size_t i = begin; i < end && r != 1; i += kCheckEvery) {
+            if (one.load(std::memory_order_relaxed))
+                return;
+            size_t n = std::min(kCheckEvery, end - i);
+            uint64_t g = gcdn(arr + i, n);
+            r = r == 0 ? g : gcd(r, g);
+        }
+        partial[c] = r;
+        if (r == 1)
+            one.store(true, std::memory_order_relaxed);
+    });
+    if (one.load(std::memory_order_relaxed))
+        return 1;
+    return gcdn(partial.data(), partial.size());
+}
+
+//求n个数的最小公倍数，分块并行；溢出时返回 false
+inline bool lcmn_parallel(reduce_pool &pool, const uint64_t *arr, size_t len, uint64_t *out) {
+    using namespace parallel_detail;
+    size_t chunks = chunk_count(pool, len);
+    if (chunks == 1)
+        return lcmn_checked(arr, len, out);
+    std::vector<uint64_t> partial(chunks, 1);
+    // 0：照常；1：遇到了元素 0，结果是 0；2：溢出
+    std::atomic<int> stop(0);
+    pool.run(chunks, [&](size_t c) {
+        size_t begin = len * c / chunks, end = len * (c + 1) / chunks;
+        uint64_t r = 1;
+        for (size_t i = begin; i < end; i += kCheckEvery) {
+            if (stop.load(std::memory_order_relaxed))
+                return;
+            size_t n = std::min(kCheckEvery, end - i);
+            uint64_t l;
+            if (!lcmn_checked(arr + i, n, &l) || !lcm_checked(r, l, &r)) {
+                int expected = 0;
+                stop.compare_exchange_strong(expected, 2, std::memory_order_relaxed);
+                return;
+            }
+            if (r == 0) {
+                stop.store(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        partial[c] = r;
+    });
+    if (stop.load(std::memory_order_relaxed) == 1) {
+        *out = 0;
+        return true;
+    }
+    // 别的块里可能有还没轮到的 0
+    if (stop.load(std::memory_order_relaxed) == 2) {
+        if (std::find(arr, arr + len, uint64_t(0)) != arr + len) {
+            *out = 0;
+            return true;
+        }
+        return false;
+    }
+    return lcmn_checked(partial.data(), partial.size(), out);
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "parallel_reduce.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/*
+ * 分段的埃拉托斯特尼筛法，用来枚举和计数素数。
+ *
+ *  - 模 30 的轮(wheel)：与 30 互素的余数只有 {1,7,11,13,17,19,23,29} 8 个，每 30 个数正好用一个字节的 8 位表示，
+ *    2、3、5 的倍数根本不存，内存是逐个数存一位的 8/30；
+ *  - 分段：一次只筛 kSegmentBytes 字节(32KB，放得进 L1 缓存，一段覆盖 96 万个数)，
+ *    筛 [lo, hi) 只需要不超过 sqrt(hi) 的素数(筛 1e10 以内是 9592 个)和一段的缓冲区；
+ *  - 划掉倍数：素数 p 的倍数里只有 p*q(q 与 30 互素)落在表里，q 按轮的间隔 {6,4,2,4,2,4,6,2} 前进。
+ *    p = 30a+b 时，相邻两个倍数的字节差是 a*间隔 + 一个只和 (b, 轮的位置) 有关的小数，要清的位也只和 (b, 轮的位置) 有关，
+ *    都预先算成表，划掉一个倍数只需要一次查表、一次加法和一次与运算，不用除法；
+ *  - 多线程：把所有段按顺序切成若干块(每块 kSegmentsPerChunk 段)，reduce_pool 里的线程抢着领块，
+ *    每块开头重新算每个素数在块里的第一个倍数，之后各线程互不相干。
+ *
+ *  count_primes(hi)              [0, hi) 里的素数个数，多线程
+ *  for_each_prime(lo, hi, f)     按从小到大的顺序对 [lo, hi) 里的每个素数调用 f(p)，单线程
+ *  primes_below(hi)              [0, hi) 里的素数放进 vector
+ * */
+namespace sieve_detail {
+    constexpr size_t kSegmentBytes = 32 * 1024;
+    constexpr size_t kSegmentsPerChunk = 64;
+
+    constexpr uint8_t kResidues[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+    constexpr uint8_t kGaps[8] = {6, 4, 2, 4, 2, 4, 6, 2};
+
+    // 余数 -> 位的编号，不与 30 互素的余数为 -1
+    constexpr int bit_of(uint64_t r) {
+        for (int i = 0; i < 8; ++i)
+            if (kResidues[i] == r)
+                return i;
+        return -1;
+    }
+
+    // 素数 p = 30a + b，b 是 kResidues[bi]；当前倍数 p*q，q 模 30 是 kResidues[wi]
+    struct wheel_tables {
+        uint8_t mask[8][8];       // 当前倍数要清的位
+        uint8_t byte_step[8][8];  // 到下一个倍数，字节号除了 a*kGaps[wi] 以外还要加的部分
+        wheel_tables() {
+            for (int bi = 0; bi < 8; ++bi)
+                for (int wi = 0; wi < 8; ++wi) {
+                    uint64_t b = kResidues[bi], w = kResidues[wi], next = w + kGaps[wi];
+                    mask[bi][wi] = (uint8_t)(1u << bit_of(b * w % 30));
+                    byte_step[bi][wi] = (uint8_t)(b * next / 30 - b * w / 30);
+                }
+        }
+    };
+
+    inline const wheel_tables &tables() {
+        static const wheel_tables t;
+        return t;
+    }
+
+    // 一个素数在筛的过程中的状态：下一个要划掉的倍数所在的字节号(绝对编号)和轮的位置
+    struct sieving_prime {
+        uint32_t a;  // p / 30
+        uint8_t bi;  // p % 30 的位编号
+        uint8_t wi;
+        uint64_t byte;
+    };
+
+    // 7 到 limit(含)之间的素数，简单筛法
+    inline std::vector<uint32_t> base_primes(uint64_t limit) {
+        std::vector<uint32_t> primes;
+        std::vector<bool> composite(limit + 1);
+        for (uint64_t p = 2; p <= limit; ++p) {
+            if (composite[p])
+                continue;
+            for (uint64_t q = p * p; q <= limit; q += p)
+                composite[q] = true;
+            if (p >= 7)
+                primes.push_back((uint32_t)p);
+        }
+        return primes;
+    }
+
+    inline uint64_t isqrt(uint64_t n) {
+        uint64_t r = (uint64_t)std::sqrt((double)n);
+        while (r * r > n)
+            --r;
+        while ((r + 1) * (r + 1) <= n)
+            ++r;
+        return r;
+    }
+
+    // 第一个不小于 max(p*p, 30*byte_lo) 的 p*q(q 与 30 互素)
+    inline sieving_prime first_multiple(uint32_t p, uint64_t byte_lo) {
+        uint64_t lo = byte_lo * 30;
+        uint64_t q = std::max<uint64_t>(p, (lo + p - 1) / p);
+        while (bit_of(q % 30) < 0)
+            ++q;
+        return {p / 30, (uint8_t)bit_of(p % 30), (uint8_t)bit_of(q % 30), (uint64_t)p * q / 30};
+    }
+
+    // 筛字节区间 [byte_lo, byte_lo + len)，seg 的第 i 个字节对应数 30*(byte_lo+i) + kResidues[bit]
+    inline void sieve_segment(uint8_t *seg, uint64_t byte_lo, size_t len, std::vector<sieving_prime> &primes) {
+        const wheel_tables &t = tables();
+        std::memset(seg, 0xff, len);
+        if (byte_lo == 0)
+            seg[0] &= ~1; // 1 不是素数
+        uint64_t byte_hi = byte_lo + len;
+        for (sieving_prime &sp : primes) {
+            uint64_t byte = sp.byte;
+            unsigned wi = sp.wi;
+            const uint8_t *mask = t.mask[sp.bi], *step = t.byte_step[sp.bi];
+            // 连续 8 个倍数是一轮，一轮正好前进 p 个字节：先算出一轮里每个倍数相对第一个的偏移和掩码，
+            // 8 次写互不依赖，比逐个推进的依赖链快得多
+            uint64_t p = (uint64_t)sp.a * 30 + kResidues[sp.bi];
+            if (byte + p < byte_hi) {
+                uint64_t off[8];
+                uint8_t keep[8];
+                uint64_t o = 0;
+                for (unsigned j = 0, w = wi; j < 8; ++j, w = (w + 1) & 7) {
+                    off[j] = o;
+                    keep[j] = (uint8_t)~mask[w];
+                    o += (uint64_t)sp.a * kGaps[w] + step[w];
+                }
+                size_t i = byte - byte_lo;
+                for (size_t last = len - off[7]; i < last; i += p) {
+                    seg[i + off[0]] &= keep[0];
+                    seg[i + off[1]] &= keep[1];
+                    seg[i + off[2]] &= keep[2];
+                    seg[i + off[3]] &= keep[3];
+                    seg[i + off[4]] &= keep[4];
+                    seg[i + off[5]] &= keep[5];
+                    seg[i + off[6]] &= keep[6];
+                    seg[i + off[7]] &= keep[7];
+                }
+                byte = byte_lo + i;
+            }
+            while (byte < byte_hi) {
+                seg[byte - byte_lo] &= (uint8_t)~mask[wi];
+                byte += (uint64_t)sp.a * kGaps[wi] + step[wi];
+                wi = (wi + 1) & 7;
+            }
+            sp.byte = byte;
+            sp.wi = (uint8_t)wi;
+        }
+    }
+
+    // 只保留小于 hi 的数对应的位
+    inline void clip(uint8_t *seg, uint64_t byte_lo, size_t len, uint64_t hi) {
+        for (size_t i = 0; i < len; ++i) {
+            uint64_t base = (byte_lo + i) * 30;
+            if (base + 29 < hi)
+                continue;
+            for (int bit = 0; bit < 8; ++bit)
+                if (base + kResidues[bit] >= hi)
+                    seg[i] &= (uint8_t)~(1u << bit);
+        }
+    }
+
+    inline uint64_t popcount(const uint8_t *seg, size_t len) {
+        uint64_t n = 0;
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, seg + i, 8);
+            n += __builtin_popcountll(word);
+        }
+        for (; i < len; ++i)
+            n += __builtin_popcount(seg[i]);
+        return n;
+    }
+}
+
+//[0, hi) 里素数的个数；threads 为 0 时用硬件线程数
+inline uint64_t count_primes(uint64_t hi, size_t threads = 0) {
+    using namespace sieve_detail;
+    uint64_t count = 0;
+    for (uint64_t p : {2, 3, 5})
+        count += p < hi;
+    if (hi <= 7)
+        return count;
+
+    std::vector<uint32_t> base = base_primes(isqrt(hi - 1));
+    uint64_t bytes = (hi + 29) / 30;
+    uint64_t chunkBytes = kSegmentBytes * kSegmentsPerChunk;
+    size_t chunks = (bytes + chunkBytes - 1) / chunkBytes;
+    std::vector<uint64_t> partial(chunks, 0);
+
+    reduce_pool pool(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    pool.run(chunks, [&](size_t c) {
+        uint64_t chunkLo = c * chunkBytes, chunkHi = std::min(bytes, chunkLo + chunkBytes);
+        std::vector<uint8_t> seg(kSegmentBytes);
+        std::vector<sieving_prime> primes;
+        uint64_t segHi = chunkLo;
+        size_t active = 0; // 只有 p*p 落在已经处理到的范围里的素数才需要参与
+        uint64_t n = 0;
+        for (uint64_t lo = chunkLo; lo < chunkHi; lo += kSegmentBytes) {
+            size_t len = std::min<uint64_t>(kSegmentBytes, chunkHi - lo);
+            segHi = lo + len;
+            while (active < base.size() && (uint64_t)base[active] * base[active] / 30 < segHi)
+                primes.push_back(first_multiple(base[active++], lo));
+            sieve_segment(seg.data(), lo, len, primes);
+            if (segHi * 30 > hi)
+                clip(seg.data(), lo, len, hi);
+            n += popcount(seg.data(), len);
+        }
+        partial[c] = n;
+    });
+    for (uint64_t n : partial)
+        count += n;
+    return count;
+}
+
+//按从小到大的顺序对 [lo, hi) 里的每个素数调用 f(p)
+template <typename F> void for_each_prime(uint64_t lo, uint64_t hi, F &&f) {
+    using namespace sieve_detail;
+    for (uint64_t p : {2, 3, 5})
+        if (p >= lo && p < hi)
+            f(p);
+    if (hi <= 7)
+        return;
+
+    std::vector<uint32_t> base = base_primes(isqrt(hi - 1));
+    uint64_t byteLo = lo / 30, bytes = (hi + 29) / 30;
+    std::vector<uint8_t> seg(kSegmentBytes);
+    std::vector<sieving_prime> primes;
+    size_t active = 0;
+    for (uint64_t segLo = byteLo; segLo < bytes; segLo += kSegmentBytes) {
+        size_t len = std::min<uint64_t>(kSegmentBytes, bytes - segLo);
+        while (active < base.size() && (uint64_t)base[active] * base[active] / 30 < segLo + len)
+            primes.push_back(first_multiple(base[active++], segLo));
+        sieve_segment(seg.data(), segLo, len, primes);
+        for (size_t i = 0; i < len; ++i) {
+            for (uint8_t bits = seg[i]; bits; bits &= bits - 1) {
+                uint64_t p = (segLo + i) * 30 + kResidues[__builtin_ctz(bits)];
+                if (p >= lo && p < hi)
+                    f(p);
+            }
+        }
+    }
+}
+
+//[0, hi) 里的素数
+inline std::vector<uint64_t> primes_below(uint64_t hi) {
+    std::vector<uint64_t> out;
+    for_each_prime(0, hi, [&](uint64_t p) { out.push_back(p); });
+    return out;
+}
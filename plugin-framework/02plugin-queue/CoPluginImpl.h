@@ -0,0 +1,418 @@
+#pragma once
+
+/**
+ * 基于C++20协程的采集插件接口
+ *
+ * collector.cc 的写法是每个采集插件自己开一个 std::thread，用 isRuning 标志控制退出，
+ * 上千个采集对象就是上千个线程，每个线程都有自己的栈。
+ *
+ * 这里换一种写法：采集逻辑是一个协程，
+ *      co_await SleepFor(1s);  // 等定时器
+ *      co_await event;         // 等就绪事件
+ *      co_yield pData;         // 交出一条数据，放进宿主的队列
+ * 所有协程挂在宿主持有的一个小执行器 CoExecutor 上，由少数几个工作线程轮流推进。
+ * 挂起中的协程只占一个协程帧(几百字节)，没有独立的栈。
+ *
+ * 执行器调度的单位是 CoNode，它直接嵌在等待体(awaiter)或 promise 里，
+ * 而等待体在挂起期间就存放在协程帧里，所以调度过程本身不需要分配内存。
+ *
+ * 需要 -std=c++20
+ */
+
+#include "PluginImpl.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+class CoExecutor;
+class CoCollectorImpl;
+
+// 执行器里的一个调度项：到点(或立即)调用 run
+struct CoNode
+{
+    void (*run)(CoNode *node) = nullptr;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+class CollectorTask
+{
+public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    // co_yield 的等待体：放不进队列时挂起，1ms后重试，直到放进去为止
+    struct YieldAwaiter : CoNode
+    {
+        promise_type *promise;
+        ProtocolDataVar *data;
+        std::coroutine_handle<> handle;
+
+        YieldAwaiter(promise_type *p, ProtocolDataVar *d) : promise(p), data(d) {}
+        YieldAwaiter(const YieldAwaiter &) = delete;
+        // 协程在这里挂起时被执行器销毁，还没交出去的数据要还给插件
+        ~YieldAwaiter();
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        void await_resume() {}
+        static void Retry(CoNode *node);
+    };
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        void await_suspend(handle_type h) noexcept;
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type : CoNode
+    {
+        CoExecutor *executor = nullptr;
+        DataQueue *queue = nullptr;
+        CoCollectorImpl *owner = nullptr;
+
+        CollectorTask get_return_object() { return CollectorTask(handle_type::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        YieldAwaiter yield_value(ProtocolDataVar *pData) { return YieldAwaiter(this, pData); }
+        void return_void() {}
+        void unhandled_exception()
+        {
+            try
+            {
+                std::rethrow_exception(std::current_exception());
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "collector coroutine: " << e.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "collector coroutine: unknown exception" << std::endl;
+            }
+        }
+    };
+
+    CollectorTask(CollectorTask &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    CollectorTask(const CollectorTask &) = delete;
+    CollectorTask &operator=(const CollectorTask &) = delete;
+    ~CollectorTask()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    // 交给执行器后由执行器负责销毁
+    handle_type release()
+    {
+        handle_type h = handle_;
+        handle_ = nullptr;
+        return h;
+    }
+
+private:
+    explicit CollectorTask(handle_type h) : handle_(h) {}
+    handle_type handle_;
+};
+
+class CoExecutor
+{
+public:
+    explicit CoExecutor(size_t threads)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            threads_.emplace_back(&CoExecutor::Loop, this);
+    }
+
+    ~CoExecutor() { Stop(); }
+
+    CoExecutor(const CoExecutor &) = delete;
+    CoExecutor &operator=(const CoExecutor &) = delete;
+
+    // 把一个采集协程挂到执行器上，co_yield 出来的数据进入 queue，执行器停止时未交出的数据交给 owner 回收
+    void Spawn(CollectorTask task, DataQueue *queue, CoCollectorImpl *owner)
+    {
+        CollectorTask::handle_type h = task.release();
+        CollectorTask::promise_type &promise = h.promise();
+        promise.executor = this;
+        promise.queue = queue;
+        promise.owner = owner;
+        promise.run = [](CoNode *node) {
+            CollectorTask::handle_type::from_promise(*static_cast<CollectorTask::promise_type *>(node)).resume();
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.insert(h.address());
+        }
+        Post(&promise);
+    }
+
+    void Post(CoNode *node)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(node);
+        }
+        cv_.notify_one();
+    }
+
+    void PostAt(CoNode *node, std::chrono::steady_clock::time_point deadline)
+    {
+        node->deadline = deadline;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timers_.push(node);
+        }
+        cv_.notify_one();
+    }
+
+    // 停止所有工作线程，然后销毁还挂起着的协程
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &t : threads_)
+            t.join();
+
+        for (void *address : tasks_)
+            std::coroutine_handle<>::from_address(address).destroy();
+        tasks_.clear();
+    }
+
+    size_t TaskCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tasks_.size();
+    }
+
+    // 协程执行完毕时调用
+    void Retire(std::coroutine_handle<> h)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.erase(h.address());
+        }
+        h.destroy();
+    }
+
+private:
+    struct Later
+    {
+        bool operator()(const CoNode *a, const CoNode *b) const { return a->deadline > b->deadline; }
+    };
+
+    void Loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+            auto now = std::chrono::steady_clock::now();
+            while (!timers_.empty() && timers_.top()->deadline <= now)
+            {
+                ready_.push_back(timers_.top());
+                timers_.pop();
+            }
+
+            if (!ready_.empty())
+            {
+                CoNode *node = ready_.front();
+                ready_.pop_front();
+                lock.unlock();
+                node->run(node);
+                lock.lock();
+                continue;
+            }
+
+            if (timers_.empty())
+                cv_.wait(lock);
+            else
+                cv_.wait_until(lock, timers_.top()->deadline);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<CoNode *> ready_;
+    std::priority_queue<CoNode *, std::vector<CoNode *>, Later> timers_;
+    std::unordered_set<void *> tasks_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
+
+// co_await SleepFor(100ms);
+class SleepFor : public CoNode
+{
+public:
+    explicit SleepFor(std::chrono::steady_clock::duration d) : duration_(d) {}
+
+    bool await_ready() { return duration_.count() <= 0; }
+    void await_suspend(CollectorTask::handle_type h)
+    {
+        handle_ = h;
+        run = [](CoNode *node) { static_cast<SleepFor *>(node)->handle_.resume(); };
+        h.promise().executor->PostAt(this, std::chrono::steady_clock::now() + duration_);
+    }
+    void await_resume() {}
+
+private:
+    std::chrono::steady_clock::duration duration_;
+    std::coroutine_handle<> handle_;
+};
+
+/**
+ * 就绪事件(自动复位)：外部线程调用 Set()，等待的协程被放回执行器
+ * 只支持一个协程等待，Set 在没有协程等待时会被记住，下一次 co_await 直接通过
+ * 等待中的协程被 CoExecutor::Stop 销毁时，等待体的析构会把登记撤掉，之后的 Set 只是记下事件
+ */
+class CoEvent : private CoNode
+{
+public:
+    CoEvent() { run = &CoEvent::Wake; }
+
+    void Set()
+    {
+        CoExecutor *executor = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!waiter_)
+            {
+                set_ = true;
+                return;
+            }
+            // 把等待者摘下来再投递，避免连续两次 Set 把同一个调度项投递两次
+            woken_ = waiter_;
+            waiter_ = nullptr;
+            executor = executor_;
+        }
+        executor->Post(this);
+    }
+
+    struct Awaiter
+    {
+        CoEvent *event;
+        std::coroutine_handle<> handle;
+
+        // 挂起期间等待体存放在协程帧里，协程帧被销毁时这里会被调用
+        ~Awaiter()
+        {
+            if (!handle)
+                return;
+            std::lock_guard<std::mutex> lock(event->mutex_);
+            if (event->waiter_ == handle)
+            {
+                event->waiter_ = nullptr;
+                event->executor_ = nullptr;
+            }
+            if (event->woken_ == handle)
+                event->woken_ = nullptr;
+        }
+
+        bool await_ready() { return false; }
+        bool await_suspend(CollectorTask::handle_type h)
+        {
+            std::lock_guard<std::mutex> lock(event->mutex_);
+            if (event->set_)
+            {
+                event->set_ = false;
+                return false;
+            }
+            handle = h;
+            event->waiter_ = h;
+            event->executor_ = h.promise().executor;
+            return true;
+        }
+        void await_resume() {}
+    };
+
+    Awaiter operator co_await() { return Awaiter{this, nullptr}; }
+
+private:
+    static void Wake(CoNode *node)
+    {
+        CoEvent *self = static_cast<CoEvent *>(node);
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            h = self->woken_;
+        }
+        if (h)
+            h.resume();
+    }
+
+    std::mutex mutex_;
+    bool set_ = false;
+    std::coroutine_handle<> waiter_;
+    std::coroutine_handle<> woken_;
+    CoExecutor *executor_ = nullptr;
+};
+
+// 协程版采集插件的接口类，插件同样导出 extern "C" void *Instance()
+class CoCollectorImpl
+{
+public:
+    virtual ~CoCollectorImpl() {}
+
+    virtual const char *Name() = 0;
+
+    // 返回第index个采集协程，宿主调用多次得到多个采集对象
+    virtual CollectorTask Collect(int index) = 0;
+
+    virtual int ReleaseData(ProtocolDataVar *pData)
+    {
+        delete pData;
+        return 0;
+    }
+};
+
+inline CollectorTask::YieldAwaiter::~YieldAwaiter()
+{
+    if (data)
+        promise->owner->ReleaseData(data);
+}
+
+inline bool CollectorTask::YieldAwaiter::await_ready()
+{
+    if (promise->queue->Push(data))
+    {
+        data = nullptr;
+        return true;
+    }
+    return false;
+}
+
+inline void CollectorTask::YieldAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    handle = h;
+    run = &YieldAwaiter::Retry;
+    promise->executor->PostAt(this, std::chrono::steady_clock::now() + std::chrono::milliseconds(1));
+}
+
+inline void CollectorTask::YieldAwaiter::Retry(CoNode *node)
+{
+    YieldAwaiter *self = static_cast<YieldAwaiter *>(node);
+    if (self->promise->queue->Push(self->data))
+    {
+        self->data = nullptr;
+        self->handle.resume();
+        return;
+    }
+    self->promise->executor->PostAt(self, std::chrono::steady_clock::now() + std::chrono::milliseconds(1));
+}
+
+inline void CollectorTask::FinalAwaiter::await_suspend(handle_type h) noexcept
+{
+    h.promise().executor->Retire(h);
+}
@@ -11,7 +11,8 @@ consume
 */
 
 #include <string>
-#include <queue>
+#include <cstdint>
+#include <cstddef>
 
 struct ProtocolDataVar
 {
@@ -20,10 +21,29 @@ struct ProtocolDataVar
     std::string group;  //数据所属分组
     std::string source; //数据从哪个模块来
     uint64_t getTime;   //产生时间
+    double value;       //数值
 };
 
 #pragma once
 
+/**
+ * 采集插件往里放数据，宿主从里面批量取数据
+ * 队列满时 Push 返回false，由插件决定等待还是丢弃
+ */
+class DataQueue
+{
+public:
+    virtual ~DataQueue() {}
+
+    virtual bool Push(ProtocolDataVar *pData) = 0;
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max) = 0;
+    virtual size_t Size() = 0;
+};
+
+struct StagePlacement;
+class EventLoop;
+class Clock;
+
 class PluginImpl
 {
 private:
@@ -43,12 +63,27 @@ public:
 	virtual bool Start() { return true; }
 	virtual bool Stop() { return true; }
 
+	/*
+	 * 宿主在 Start 之前下发本插件的CPU/NUMA摆放，见 placement.h
+	 * 自己开线程的插件应在线程里绑核，并在对应节点上分配内存
+	 */
+	virtual void SetPlacement(const StagePlacement &placement) {}
+
+	// 硬件参数，具体含义由插件自己定义，比如I/O类采集插件的设备路径
+	virtual bool SetHardwareParam(void *pHardwareConfig) { return false; }
+
+	// 宿主的事件循环服务，I/O类采集插件把fd注册上去，不再自己开线程阻塞读，见 event_loop.h
+	virtual void SetEventLoop(EventLoop *pLoop) {}
+
+	// 宿主的时钟，插件取时间、等待都通过它，回放测试时换成虚拟时钟，见 clock.h
+	virtual void SetClock(Clock *pClock) {}
+
 
     // ==================采集类插件接口==================
     /**
      * 控制数据的生成和销毁，中间由加工类插件处理
     */
-	virtual void SetDataQueue(std::queue<ProtocolDataVar*>* pQueue) {};
+	virtual void SetDataQueue(DataQueue *pQueue) {};
     virtual int ReleaseData(ProtocolDataVar *pData) { return 0; };
 
 
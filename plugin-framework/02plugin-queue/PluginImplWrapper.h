@@ -0,0 +1,53 @@
+#pragma once
+
+#include <iostream>
+#include <dlfcn.h> // dlopen, dlerror, dlsym, dlclose
+
+// 利用RAII封装插件的加载、实例化和卸载，T为插件的接口类
+template <typename T>
+class PluginImplWrapper
+{
+public:
+	explicit PluginImplWrapper(const char *lib_path, const char *instance)
+	{
+		// 加载插件
+		handle_ = dlopen(lib_path, RTLD_LAZY);
+		if (!handle_)
+		{
+			std::cout << dlerror() << std::endl;
+		}
+
+		// 获取实例
+		// 插件导出的是 extern "C" void *Instance()，这里按实际的接口类型转换
+		typedef void *GetInstanceFunc();
+		GetInstanceFunc *GetInstance = (GetInstanceFunc *)dlsym(handle_, instance);
+		if (!GetInstance)
+		{
+			std::cout << "Error Instance function" << std::endl;
+			return;
+		}
+
+		ptr_ = static_cast<T *>(GetInstance());
+
+		if (!ptr_)
+		{
+			std::cout << "Error GetInstance" << std::endl;
+		}
+	}
+	~PluginImplWrapper()
+	{
+		delete ptr_;
+		if (handle_)
+			dlclose(handle_);
+	}
+
+	T &operator*() const { return *ptr_; } //用 * 运算符解引用
+	T *operator->() const { return ptr_; } //用 -> 运算符指向对象成员
+	operator bool() const { return ptr_; } //像指针一样用在布尔表达式里
+
+	T *get() const { return ptr_; }
+
+private:
+	void *handle_ = nullptr;
+	T *ptr_ = nullptr;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * 宿主消费循环的自适应批大小
+ *
+ * 固定批大小两头不讨好：负载高时批太小，每批的固定开销(取队列、下游刷新)占比大；
+ * 负载低时为了凑批要等，延迟上去了。原来的消费循环队列一空就睡10ms，低负载下平均延迟也有5ms。
+ *
+ * AdaptiveBatcher 按延迟目标(SLO)决定两件事：
+ *  - 每次最多取多少条：用最近处理耗时估计每条的处理时间 c，一批的处理时间不超过 SLO 的一半，
+ *    即上限 SLO/2/c；队列里还有积压就往上限涨(一次翻倍)，积压消失后逐步缩回，每次最多减半；
+ *  - 队列空时等多久：从 kMinIdle 开始每次翻倍，最多 SLO/4，有数据就回到 kMinIdle。
+ * 不凑批：取到多少处理多少，批大小只是上限。
+ *
+ * 只在消费线程里使用，不加锁；BatchSize() 可以当作指标发布出去(比如写进 LatestValueTable)。
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+class AdaptiveBatcher
+{
+public:
+    explicit AdaptiveBatcher(std::chrono::nanoseconds slo, size_t minBatch = 1, size_t maxBatch = 1024)
+        : slo_(slo.count()), minBatch_(minBatch), maxBatch_(std::max(minBatch, maxBatch)), batch_(minBatch),
+          idleWait_(kMinIdle)
+    {
+    }
+
+    size_t BatchSize() const { return batch_; }
+    std::chrono::nanoseconds IdleWait() const { return std::chrono::nanoseconds(idleWait_); }
+    double PerRecordNs() const { return perRecord_; }
+
+    // 处理完一批后调用：n 为本批条数，backlog 为处理完后队列里剩下的条数，elapsed 为本批的处理耗时
+    void OnBatch(size_t n, size_t backlog, std::chrono::nanoseconds elapsed)
+    {
+        if (n == 0)
+            return;
+        idleWait_ = kMinIdle;
+
+        double cost = (double)elapsed.count() / n;
+        perRecord_ = perRecord_ == 0 ? cost : perRecord_ + (cost - perRecord_) / 8;
+
+        // 一批的处理时间不超过 SLO 的一半，另一半留给排队
+        double budget = slo_ / 2 / std::max(perRecord_, 1.0);
+        size_t cap = (size_t)std::min<double>(budget, (double)maxBatch_);
+        cap = std::max(cap, minBatch_);
+
+        size_t target;
+        if (backlog > 0)
+            target = std::min(std::max(batch_ * 2, n + backlog), cap);
+        else
+            target = std::max(std::min(n, cap), batch_ / 2);
+        batch_ = std::max(std::min(target, cap), minBatch_);
+    }
+
+    // 取不到数据时调用，等待 IdleWait() 之后再取
+    void OnIdle() { idleWait_ = std::min<long long>(idleWait_ * 2, std::max<long long>(slo_ / 4, kMinIdle)); }
+
+private:
+    static constexpr long long kMinIdle = 20000; // 20us
+
+    long long slo_;
+    size_t minBatch_;
+    size_t maxBatch_;
+    size_t batch_;
+    long long idleWait_;
+    double perRecord_ = 0;
+};
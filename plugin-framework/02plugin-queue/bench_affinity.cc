@@ -0,0 +1,87 @@
+/**
+ * 跨核队列吞吐对比：不绑核 vs 生产者/消费者绑到指定CPU
+ *
+ * 用法: ./bench-affinity [count] [producer_cpu] [consumer_cpu]
+ * 默认 count=20000000，生产者CPU 0，消费者CPU 1(只有一个CPU时两者都绑到0)
+ * 要看跨socket的效果，把两个CPU分别选在不同的NUMA节点上，并对比同节点的结果。
+ */
+
+#include "placement.h"
+#include "spsc_queue.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+struct BenchResult
+{
+    double mops;
+    int producerCpu;
+    int consumerCpu;
+};
+
+static BenchResult Run(uint64_t count, const StagePlacement &producer, const StagePlacement &consumer)
+{
+    // 队列内存放在生产者所在节点上，和宿主 main.cc 里 RingDataQueue 的摆放一致
+    SpscQueue<uint64_t> queue(4096, producer.node);
+    BenchResult result{0, -1, -1};
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producerThread([&]() {
+        placement::PinCurrentThread(producer.cpus);
+        result.producerCpu = placement::CurrentCpu();
+        for (uint64_t i = 1; i <= count; ++i)
+        {
+            while (!queue.TryPush(i))
+                std::this_thread::yield();
+        }
+    });
+
+    std::thread consumerThread([&]() {
+        placement::PinCurrentThread(consumer.cpus);
+        result.consumerCpu = placement::CurrentCpu();
+        uint64_t batch[256];
+        uint64_t received = 0, sum = 0;
+        while (received < count)
+        {
+            size_t n = queue.TryPopBatch(batch, 256);
+            for (size_t i = 0; i < n; ++i)
+                sum += batch[i];
+            received += n;
+            if (n == 0)
+                std::this_thread::yield();
+        }
+        if (sum != count * (count + 1) / 2)
+            std::cerr << "checksum mismatch" << std::endl;
+    });
+
+    producerThread.join();
+    consumerThread.join();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.mops = count / elapsed.count() / 1e6;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 20000000;
+    int cpus = placement::CpuCount();
+    int producerCpu = argc > 2 ? atoi(argv[2]) : 0;
+    int consumerCpu = argc > 3 ? atoi(argv[3]) : (cpus > 1 ? 1 : 0);
+
+    PlacementConfig config("producer=" + std::to_string(producerCpu) + ";consumer=" + std::to_string(consumerCpu));
+    std::cout << config.Report();
+
+    BenchResult unpinned = Run(count, StagePlacement(), StagePlacement());
+    std::cout << "unpinned: " << unpinned.mops << " Mops/s (producer on cpu" << unpinned.producerCpu
+              << ", consumer on cpu" << unpinned.consumerCpu << ")" << std::endl;
+
+    BenchResult pinned = Run(count, config.Get("producer"), config.Get("consumer"));
+    std::cout << "pinned:   " << pinned.mops << " Mops/s (producer on cpu" << pinned.producerCpu
+              << ", consumer on cpu" << pinned.consumerCpu << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+/**
+ * 自适应批大小与固定批大小的对比
+ *
+ * 用法: ./bench-batch [slo_us] [record_ns] [batch_overhead_us] [low_rate] [saturation_records]
+ * 生产线程往 RingDataQueue 里放数据(value 里是放入时刻)，消费线程按不同策略取出、处理：
+ *  - 每条处理耗时 record_ns(默认200ns)，每批另有固定开销 batch_overhead_us(默认20us，相当于下游一次刷新/系统调用)，都用忙等模拟；
+ *  - 固定批大小 1/64/1024：和改之前的宿主消费循环一样，每次 PopBatch 最多取这么多条，取到多少处理多少，
+ *    只在队列空的时候睡 10ms；其中 64 就是原来的宿主(标 host)；
+ *  - 自适应：AdaptiveBatcher(adaptive_batch.h)，延迟目标 slo_us(默认2000)。
+ * 两个场景：
+ *  1. 低速：每秒 low_rate 条(默认2000)，持续1秒，统计放入到处理完的延迟分位数；
+ *  2. 饱和：生产者全速放 saturation_records 条(默认1000000)，统计每秒处理条数。
+ */
+
+#include "adaptive_batch.h"
+#include "data_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+static uint64_t SteadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void BusyWait(uint64_t ns)
+{
+    uint64_t until = SteadyNow() + ns;
+    while (SteadyNow() < until)
+    {
+    }
+}
+
+static const size_t kQueueCapacity = 65536;
+static const size_t kMaxBatch = 1024;
+static const size_t kHostBatch = 64;           // 原来的宿主每次取的条数
+static const uint64_t kIdleSleep = 10000000;   // 原来的宿主队列空时睡 10ms
+
+struct Result
+{
+    double seconds = 0;
+    std::vector<uint64_t> latencies;
+    uint64_t batches = 0;
+};
+
+class Bench
+{
+public:
+    Bench(uint64_t recordNs, uint64_t overheadNs) : recordNs_(recordNs), overheadNs_(overheadNs) {}
+
+    // rate 为0表示全速
+    Result Run(size_t fixedBatch, uint64_t sloNs, uint64_t records, uint64_t rate)
+    {
+        RingDataQueue queue(kQueueCapacity);
+        // 记录循环复用：队列里最多 kQueueCapacity 条，消费者手里最多 kMaxBatch 条，多留一倍余量就不会覆盖还没处理的
+        std::vector<ProtocolDataVar> pool(kQueueCapacity + 2 * kMaxBatch);
+        std::atomic<bool> done(false);
+        Result result;
+        result.latencies.reserve(records);
+
+        std::thread producer([&] {
+            uint64_t start = SteadyNow();
+            for (uint64_t i = 0; i < records; ++i)
+            {
+                if (rate)
+                {
+                    uint64_t due = start + i * 1000000000 / rate;
+                    uint64_t now = SteadyNow();
+                    if (now < due)
+                        std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+                }
+                ProtocolDataVar *pData = &pool[i % pool.size()];
+                pData->getTime = i;
+                pData->value = (double)SteadyNow();
+                while (!queue.Push(pData))
+                    std::this_thread::yield();
+            }
+            done = true;
+        });
+
+        auto start = SteadyNow();
+        if (fixedBatch)
+            RunFixed(queue, done, fixedBatch, result);
+        else
+            RunAdaptive(queue, done, sloNs, result);
+        result.seconds = (SteadyNow() - start) / 1e9;
+        producer.join();
+        return result;
+    }
+
+    uint64_t batchSizeSum = 0; // 自适应时每批选中的批大小之和，用来算平均值
+
+private:
+    void Process(ProtocolDataVar **batch, size_t n, Result &result)
+    {
+        BusyWait(overheadNs_);
+        for (size_t i = 0; i < n; ++i)
+        {
+            BusyWait(recordNs_);
+            result.latencies.push_back(SteadyNow() - (uint64_t)batch[i]->value);
+        }
+        ++result.batches;
+    }
+
+    // 原来宿主的消费循环，只是每次取的条数换成 size
+    void RunFixed(DataQueue &queue, std::atomic<bool> &done, size_t size, Result &result)
+    {
+        std::vector<ProtocolDataVar *> batch(size);
+        while (true)
+        {
+            bool finished = done;
+            size_t n = queue.PopBatch(batch.data(), size);
+            if (n == 0)
+            {
+                if (finished)
+                    break;
+                std::this_thread::sleep_for(std::chrono::nanoseconds(kIdleSleep));
+                continue;
+            }
+            Process(batch.data(), n, result);
+        }
+    }
+
+    void RunAdaptive(DataQueue &queue, std::atomic<bool> &done, uint64_t sloNs, Result &result)
+    {
+        AdaptiveBatcher batcher{std::chrono::nanoseconds(sloNs), 1, kMaxBatch};
+        std::vector<ProtocolDataVar *> batch(kMaxBatch);
+        while (true)
+        {
+            bool finished = done;
+            size_t n = queue.PopBatch(batch.data(), batcher.BatchSize());
+            if (n == 0)
+            {
+                if (finished)
+                    break;
+                std::this_thread::sleep_for(batcher.IdleWait());
+                batcher.OnIdle();
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            Process(batch.data(), n, result);
+            batcher.OnBatch(n, queue.Size(), std::chrono::steady_clock::now() - start);
+            batchSizeSum += batcher.BatchSize();
+        }
+    }
+
+    uint64_t recordNs_;
+    uint64_t overheadNs_;
+};
+
+static uint64_t Percentile(std::vector<uint64_t> &v, double p)
+{
+    if (v.empty())
+        return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(v.size() * p));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t sloUs = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2000;
+    uint64_t recordNs = argc > 2 ? strtoull(argv[2], nullptr, 10) : 200;
+    uint64_t overheadUs = argc > 3 ? strtoull(argv[3], nullptr, 10) : 20;
+    uint64_t lowRate = argc > 4 ? strtoull(argv[4], nullptr, 10) : 2000;
+    uint64_t saturation = argc > 5 ? strtoull(argv[5], nullptr, 10) : 1000000;
+
+    printf("slo %llu us, %llu ns/record, %llu us/batch overhead\n", (unsigned long long)sloUs,
+           (unsigned long long)recordNs, (unsigned long long)overheadUs);
+    printf("%-16s | %-37s | %s\n", "", "low rate latency (us)", "saturation");
+    printf("%-16s | %9s %9s %9s %7s | %10s %12s\n", "policy", "p50", "p99", "max", "batch", "M rec/s", "rec/batch");
+
+    const size_t sizes[] = {1, 64, 1024, 0};
+    for (size_t size : sizes)
+    {
+        Bench bench(recordNs, overheadUs * 1000);
+        Result low = bench.Run(size, sloUs * 1000, lowRate, lowRate);
+        double lowBatch = (double)lowRate / low.batches;
+
+        Bench busy(recordNs, overheadUs * 1000);
+        Result high = busy.Run(size, sloUs * 1000, saturation, 0);
+
+        std::string name = size ? "fixed " + std::to_string(size) + (size == kHostBatch ? " (host)" : "") : "adaptive";
+        printf("%-16s | %9.1f %9.1f %9.1f %7.1f | %10.3f %12.1f\n", name.c_str(), Percentile(low.latencies, 0.5) / 1e3,
+               Percentile(low.latencies, 0.99) / 1e3, Percentile(low.latencies, 1.0) / 1e3, lowBatch,
+               saturation / high.seconds / 1e6, (double)saturation / high.batches);
+        if (!size)
+            printf("%-16s   adaptive batch size limit, mean over batches: low %.1f, saturation %.1f\n", "",
+                   (double)bench.batchSizeSum / low.batches, (double)busy.batchSizeSum / high.batches);
+    }
+    return 0;
+}
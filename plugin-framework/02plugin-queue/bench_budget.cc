@@ -0,0 +1,137 @@
+/**
+ * 内存记账的开销与预算效果
+ *
+ * 用法: ./bench-budget [records] [budget_bytes]
+ *  1. 一个采集线程 Push、一个消费线程 PopBatch，对比不记账、记一个共享原子计数器、按线程槽位记账(memory_budget.h，
+ *     队列账户挂在插件账户下)三种情况的吞吐；
+ *  2. 消费线程每批停1ms，限额 budget_bytes(默认1MB)：检查高水位是否停在预算附近、被拒绝的 Push 次数。
+ */
+
+#include "data_queue.h"
+#include "memory_budget.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const size_t kQueueCapacity = 1 << 16;
+static const size_t kBatch = 256;
+
+// 对照组：所有线程加同一个原子计数器
+class SharedCounterQueue : public DataQueue
+{
+public:
+    explicit SharedCounterQueue(DataQueue &inner) : inner_(inner) {}
+
+    virtual bool Push(ProtocolDataVar *pData)
+    {
+        size_t bytes = RecordBytes(*pData);
+        if (!inner_.Push(pData))
+            return false;
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        return true;
+    }
+
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max)
+    {
+        size_t n = inner_.PopBatch(out, max);
+        for (size_t i = 0; i < n; ++i)
+            bytes_.fetch_sub(RecordBytes(*out[i]), std::memory_order_relaxed);
+        return n;
+    }
+
+    virtual size_t Size() { return inner_.Size(); }
+
+private:
+    DataQueue &inner_;
+    std::atomic<int64_t> bytes_{0};
+};
+
+// 返回每秒条数
+static double Run(DataQueue &queue, std::vector<ProtocolDataVar> &pool, uint64_t records, int pauseUs)
+{
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < records; ++i)
+        {
+            // 采集插件总要填记录
+            ProtocolDataVar *pData = &pool[i % pool.size()];
+            pData->getTime = i;
+            pData->value = (double)i;
+            while (!queue.Push(pData))
+                std::this_thread::yield();
+        }
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    ProtocolDataVar *batch[kBatch];
+    uint64_t got = 0;
+    double sum = 0;
+    while (got < records)
+    {
+        size_t n = queue.PopBatch(batch, kBatch);
+        // 消费者总要读记录，对照组也读一遍，不然比的是碰不碰记录的内存
+        for (size_t i = 0; i < n; ++i)
+            sum += batch[i]->value + batch[i]->name.size();
+        got += n;
+        if (n == 0)
+            std::this_thread::yield();
+        else if (pauseUs)
+            std::this_thread::sleep_for(std::chrono::microseconds(pauseUs));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    producer.join();
+    if (sum < 0)
+        printf("%f\n", sum);
+    return records / elapsed.count();
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t records = argc > 1 ? strtoull(argv[1], nullptr, 10) : 5000000;
+    std::string limit = argc > 2 ? argv[2] : "1048576";
+
+    // 队列里最多 kQueueCapacity 条，消费者手里最多 kBatch 条，记录循环复用不会覆盖还没取走的
+    std::vector<ProtocolDataVar> pool(kQueueCapacity + 2 * kBatch);
+    for (auto &data : pool)
+    {
+        data.name = "cpu.user.percent.core-00";
+        data.unit = "percent";
+        data.group = "rack-12/host-0042";
+        data.source = "collector";
+    }
+    printf("record bytes %zu\n", RecordBytes(pool[0]));
+
+    {
+        RingDataQueue ring(kQueueCapacity);
+        printf("no accounting:       %8.2f M records/s\n", Run(ring, pool, records, 0) / 1e6);
+    }
+    {
+        RingDataQueue ring(kQueueCapacity);
+        SharedCounterQueue queue(ring);
+        printf("shared atomic:       %8.2f M records/s\n", Run(queue, pool, records, 0) / 1e6);
+    }
+    {
+        MemoryBudget budget;
+        RingDataQueue ring(kQueueCapacity);
+        BudgetedDataQueue queue(ring, *budget.Account("queue.bench", budget.Account("plugin.bench")));
+        printf("per-thread counters: %8.2f M records/s\n", Run(queue, pool, records, 0) / 1e6);
+        printf("%s", budget.Report().c_str());
+    }
+
+    // 慢消费者：队列容量够大，只有预算挡得住
+    {
+        MemoryBudget budget("queue.slow=" + limit);
+        RingDataQueue ring(kQueueCapacity);
+        BudgetedDataQueue queue(ring, *budget.Account("queue.slow", budget.Account("plugin.slow")));
+        uint64_t slowRecords = records / 20;
+        double rate = Run(queue, pool, slowRecords, 1000);
+        printf("slow consumer, budget %s: %.3f M records/s, max queued %zu records\n", limit.c_str(), rate / 1e6,
+               (size_t)(budget.Account("queue.slow")->HighWater() / RecordBytes(pool[0])));
+        printf("%s", budget.Report().c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * 过滤/路由阶段的吞吐测试
+ *
+ * 用法: ./bench-filter [records] [passes]
+ * 先跑一组语法和语义的检查(通配符、!、区间、带引号的字符串、语法错误)，不通过时退出码非0；
+ * 再对同一批数据分别用编译后的 FilterRouter::Classify 和逐条解释的语法树(每个节点一次虚函数调用)
+ * 计算去向，比较每秒处理的条数，并检查两者结果一致。
+ * 宿主里刚出队的一批数据一般还在cache里，默认的数据量按这个情况取；
+ * records 取得很大时两边都受内存带宽限制，差距会被拉平。
+ */
+
+#include "filter_router.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// 对照组：每条数据沿语法树逐个节点调用虚函数
+struct Predicate
+{
+    virtual ~Predicate() {}
+    virtual bool Match(const ProtocolDataVar &data) const = 0;
+};
+
+struct ValueAtLeast : Predicate
+{
+    double low;
+    explicit ValueAtLeast(double l) : low(l) {}
+    bool Match(const ProtocolDataVar &data) const { return data.value >= low; }
+};
+
+struct ValueBelow : Predicate
+{
+    double high;
+    explicit ValueBelow(double h) : high(h) {}
+    bool Match(const ProtocolDataVar &data) const { return data.value < high; }
+};
+
+struct NamePrefix : Predicate
+{
+    std::string prefix;
+    explicit NamePrefix(const std::string &p) : prefix(p) {}
+    bool Match(const ProtocolDataVar &data) const { return data.name.compare(0, prefix.size(), prefix) == 0; }
+};
+
+struct GroupEquals : Predicate
+{
+    std::string group;
+    explicit GroupEquals(const std::string &g) : group(g) {}
+    bool Match(const ProtocolDataVar &data) const { return data.group == group; }
+};
+
+struct And : Predicate
+{
+    std::unique_ptr<Predicate> a, b;
+    And(Predicate *l, Predicate *r) : a(l), b(r) {}
+    bool Match(const ProtocolDataVar &data) const { return a->Match(data) && b->Match(data); }
+};
+
+struct Or : Predicate
+{
+    std::unique_ptr<Predicate> a, b;
+    Or(Predicate *l, Predicate *r) : a(l), b(r) {}
+    bool Match(const ProtocolDataVar &data) const { return a->Match(data) || b->Match(data); }
+};
+
+struct Rule
+{
+    std::unique_ptr<Predicate> predicate;
+    int target;
+};
+
+struct Case
+{
+    const char *name;
+    const char *rules;
+    std::vector<Rule> tree;
+};
+
+// 一条规则对一条数据的去向，expect 为目标名，"drop" 表示丢弃
+struct Expectation
+{
+    const char *rules;
+    const char *name;
+    const char *group;
+    double value;
+    const char *expect;
+};
+
+static bool CheckRules()
+{
+    static const Expectation expectations[] = {
+        // 通配符
+        {"hit: name ~ cpu?user", "cpu.user", "sys", 0, "hit"},
+        {"hit: name ~ cpu?user", "cpu..user", "sys", 0, "drop"},
+        {"hit: name ~ *.rx", "net.rx", "sys", 0, "hit"},
+        {"hit: name ~ c*u*r", "cpu.user", "sys", 0, "hit"},
+        {"hit: name ~ c*u*r", "cpu.users", "sys", 0, "drop"},
+        {"hit: name ~ mem.used", "mem.used", "sys", 0, "hit"},
+        {"hit: name ~ mem.used", "mem.usedx", "sys", 0, "drop"},
+        // ! 和优先级
+        {"hit: !group == sys", "a", "app", 0, "hit"},
+        {"hit: !group == sys", "a", "sys", 0, "drop"},
+        {"hit: !(group == sys || value > 5)", "a", "app", 3, "hit"},
+        {"hit: !(group == sys || value > 5)", "a", "app", 6, "drop"},
+        {"hit: group == app || group == sys && value > 5", "a", "app", 0, "hit"},
+        {"hit: group != sys && !!true", "a", "net", 0, "hit"},
+        // 区间，方括号闭、圆括号开
+        {"hit: value in [0, 10)", "a", "sys", 0, "hit"},
+        {"hit: value in [0, 10)", "a", "sys", 10, "drop"},
+        {"hit: value in (0, 10]", "a", "sys", 0, "drop"},
+        {"hit: value in (0, 10]", "a", "sys", 10, "hit"},
+        {"hit: value in [-1.5, -0.5]", "a", "sys", -1, "hit"},
+        {"hit: value != 3", "a", "sys", 3, "drop"},
+        // 带引号的字符串，引号里的分号不切开规则
+        {"hit: name == \"a;b\"; default: main", "a;b", "sys", 0, "hit"},
+        {"hit: name == \"a;b\"; default: main", "a", "sys", 0, "main"},
+        {"hit: name ~ \"disk read*\"", "disk read.bytes", "sys", 0, "hit"},
+        {"hit: group == \"a&&b\" || group == \"(x)\"", "a", "(x)", 0, "hit"},
+        // 多条规则，第一条命中的生效，空行和多余的分号忽略
+        {"\n a: value > 5;;\n\n b: value > 1\n default: c\n", "a", "sys", 3, "b"},
+        {"a: value > 5\r\nb: value > 1", "a", "sys", 9, "a"},
+        {"drop: true; a: true", "a", "sys", 0, "drop"},
+    };
+    // 每条都必须报错
+    static const char *errors[] = {
+        "hit name == a",         "hit: name = a",         "hit: name == \"a",     "hit: value in [1, 2",
+        "hit: value in 1, 2]",   "hit: value >= x",       "hit: size > 1",         "hit: (value > 1",
+        "hit: value > 1 )",      "hit: name == a b",      "default: a b",          "hit: name ~ \"a\nb\"",
+        ": value > 1",           "hit: value > 1 &&",     "hit: !",                "hit: name == a; default:",
+    };
+
+    bool ok = true;
+    for (auto &e : expectations)
+    {
+        ProtocolDataVar data;
+        data.name = e.name;
+        data.group = e.group;
+        data.value = e.value;
+        ProtocolDataVar *batch[1] = {&data};
+        int target = FilterRouter::kDrop;
+        try
+        {
+            FilterRouter router(e.rules);
+            router.Classify(batch, 1, &target);
+        }
+        catch (const std::invalid_argument &ex)
+        {
+            std::cout << "unexpected error: " << ex.what() << std::endl;
+            ok = false;
+            continue;
+        }
+        std::string got = "drop";
+        if (target != FilterRouter::kDrop)
+            got = FilterRouter(e.rules).Targets()[target];
+        if (got != e.expect)
+        {
+            std::cout << "rules '" << e.rules << "' on " << e.name << "/" << e.group << "=" << e.value << ": expect "
+                      << e.expect << " but got " << got << std::endl;
+            ok = false;
+        }
+    }
+
+    for (const char *rules : errors)
+    {
+        try
+        {
+            FilterRouter router(rules);
+            std::cout << "rules '" << rules << "' should not parse" << std::endl;
+            ok = false;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+    }
+
+    // 错误信息指出第几行的哪条规则
+    try
+    {
+        FilterRouter router("a: value > 1\nb: name == \"x;y\" &&; c: true");
+        ok = false;
+    }
+    catch (const std::invalid_argument &ex)
+    {
+        std::string what = ex.what();
+        if (what.find("line 2 'b: name == \"x;y\" &&'") == std::string::npos)
+        {
+            std::cout << "bad error message: " << what << std::endl;
+            ok = false;
+        }
+    }
+
+    std::cout << "rule checks: " << (ok ? "ok" : "FAILED") << std::endl;
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!CheckRules())
+        return 1;
+
+    size_t records = argc > 1 ? atoi(argv[1]) : 8192;
+    int passes = argc > 2 ? atoi(argv[2]) : 1000;
+
+    static const char *names[] = {"cpu.user", "cpu.sys", "mem.used", "disk.read", "net.rx", "debug.trace"};
+    static const char *groups[] = {"sys", "app", "net"};
+    std::vector<ProtocolDataVar> storage(records);
+    std::vector<ProtocolDataVar *> data(records);
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < records; ++i)
+    {
+        storage[i].name = names[rng() % 6];
+        storage[i].group = groups[rng() % 3];
+        storage[i].value = (double)(rng() % 1000) / 10 - 5;
+        data[i] = &storage[i];
+    }
+
+    std::vector<Case> cases;
+    cases.push_back({"value range ", "hot: value >= 90; default: main", {}});
+    cases.back().tree.push_back({std::unique_ptr<Predicate>(new ValueAtLeast(90)), 0});
+
+    cases.push_back({"prefix+group", "cpu: name ~ cpu* && group == sys; default: main", {}});
+    cases.back().tree.push_back({std::unique_ptr<Predicate>(new And(new NamePrefix("cpu"), new GroupEquals("sys"))), 0});
+
+    cases.push_back({"mixed rules ", "drop: value < 0 || name ~ debug*; hot: name ~ cpu* && value >= 90; "
+                                     "net: group == net; default: main",
+                     {}});
+    cases.back().tree.push_back({std::unique_ptr<Predicate>(new Or(new ValueBelow(0), new NamePrefix("debug"))), -1});
+    cases.back().tree.push_back({std::unique_ptr<Predicate>(new And(new NamePrefix("cpu"), new ValueAtLeast(90))), 0});
+    cases.back().tree.push_back({std::unique_ptr<Predicate>(new GroupEquals("net")), 1});
+
+    std::vector<int> compiled(records), interpreted(records);
+    for (auto &c : cases)
+    {
+        FilterRouter router(c.rules);
+        int defaultTarget = router.Target("main");
+
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (size_t off = 0; off < records; off += FilterRouter::kBatch)
+            {
+                size_t n = records - off < FilterRouter::kBatch ? records - off : FilterRouter::kBatch;
+                router.Classify(&data[off], n, &compiled[off]);
+            }
+        }
+        std::chrono::duration<double> compiledTime = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (size_t i = 0; i < records; ++i)
+            {
+                int target = defaultTarget;
+                for (auto &rule : c.tree)
+                {
+                    if (rule.predicate->Match(*data[i]))
+                    {
+                        target = rule.target;
+                        break;
+                    }
+                }
+                interpreted[i] = target;
+            }
+        }
+        std::chrono::duration<double> interpretedTime = std::chrono::steady_clock::now() - start;
+
+        double total = (double)records * passes;
+        std::cout << c.name << ": compiled " << total / compiledTime.count() / 1e6 << " M records/s, interpreted "
+                  << total / interpretedTime.count() / 1e6 << " M records/s"
+                  << (compiled == interpreted ? "" : "  MISMATCH") << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * 最新值缓存的快照延迟测试
+ *
+ * 用法: ./bench-latest [series] [writers] [seconds]
+ * 默认10000个序列、2个写线程满速写入，1个读线程不停地做全量快照，统计快照延迟分布和写入速率。
+ * 对照组是一把互斥锁保护的数组：快照期间写者全部被挡住。
+ */
+
+#include "latest_value.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 对照组：互斥锁 + 数组
+class MutexLatestTable
+{
+public:
+    explicit MutexLatestTable(size_t capacity) : entries_(capacity) {}
+
+    void Update(uint32_t id, uint64_t getTime, double value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[id] = LatestValueTable::Entry{id, getTime, value};
+    }
+
+    size_t Snapshot(std::vector<LatestValueTable::Entry> &out)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out = entries_;
+        return out.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<LatestValueTable::Entry> entries_;
+};
+
+template <typename Table>
+static void Run(const char *name, Table &table, size_t series, int writers, int seconds)
+{
+    std::atomic<bool> isRunning(true);
+    std::atomic<uint64_t> updates(0);
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w)
+    {
+        threads.emplace_back([&, w]() {
+            std::mt19937 rng(w);
+            uint64_t n = 0, t = 0;
+            while (isRunning)
+            {
+                uint32_t id = rng() % series;
+                ++t;
+                table.Update(id, t, (double)t);
+                ++n;
+            }
+            updates += n;
+        });
+    }
+
+    std::vector<double> latencies;
+    std::vector<LatestValueTable::Entry> snapshot;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto start = std::chrono::steady_clock::now();
+        table.Snapshot(snapshot);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        latencies.push_back(elapsed.count());
+    }
+    isRunning = false;
+    for (auto &t : threads)
+        t.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << name << ": " << latencies.size() << " snapshots of " << snapshot.size() << " entries, latency us p50 "
+              << latencies[latencies.size() / 2] << " p99 " << latencies[latencies.size() * 99 / 100] << " max "
+              << latencies.back() << "; ingest " << updates / seconds / 1e6 << " M updates/s" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t series = argc > 1 ? atoi(argv[1]) : 10000;
+    int writers = argc > 2 ? atoi(argv[2]) : 2;
+    int seconds = argc > 3 ? atoi(argv[3]) : 2;
+
+    LatestValueTable table(series);
+    for (size_t i = 0; i < series; ++i)
+        table.Interner().Intern("group/series" + std::to_string(i));
+    Run("seqlock", table, series, writers, seconds);
+
+    MutexLatestTable mutexTable(series);
+    Run("mutex  ", mutexTable, series, writers, seconds);
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * 多路按时间归并的吞吐测试
+ *
+ * 用法: ./bench-merge [streams] [records_per_stream] [lateness]
+ * 默认16路，每路100万条。每路的时间戳递增但步长随机，路与路之间交错。
+ * 先测只把各队列取空的速度(即输入能达到的总速率)，再测经过 MergeStage 的速度，并检查输出有序。
+ * 最后把数据预先全部放进队列，单独测归并本身的处理能力，它必须高于输入总速率。
+ */
+
+#include "data_queue.h"
+#include "merge_stage.h"
+#include "record_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Streams
+{
+    std::vector<std::unique_ptr<RingDataQueue>> queues;
+    std::vector<std::unique_ptr<RecordPool>> pools;
+    std::vector<std::thread> producers;
+    std::atomic<size_t> finished{0};
+
+    Streams(size_t streams, uint64_t records)
+    {
+        for (size_t s = 0; s < streams; ++s)
+        {
+            queues.emplace_back(new RingDataQueue(4096));
+            pools.emplace_back(new RecordPool(8192));
+        }
+        for (size_t s = 0; s < streams; ++s)
+        {
+            producers.emplace_back([this, s, records]() {
+                std::mt19937_64 rng(s);
+                uint64_t t = s;
+                for (uint64_t i = 0; i < records; ++i)
+                {
+                    t += 1 + rng() % 32;
+                    ProtocolDataVar *pData = pools[s]->Acquire();
+                    pData->getTime = t;
+                    while (!queues[s]->Push(pData))
+                        std::this_thread::yield();
+                }
+                ++finished;
+            });
+        }
+    }
+
+    ~Streams()
+    {
+        for (auto &t : producers)
+            t.join();
+    }
+
+    // 记录属于哪一路的池子就还给哪一路
+    void Release(ProtocolDataVar *pData)
+    {
+        for (auto &pool : pools)
+        {
+            if (pool->Owns(pData))
+            {
+                pool->Release(pData);
+                return;
+            }
+        }
+        delete pData;
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    size_t streams = argc > 1 ? atoi(argv[1]) : 16;
+    uint64_t records = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    uint64_t lateness = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1000;
+    uint64_t total = streams * records;
+    ProtocolDataVar *batch[256];
+
+    double inputRate;
+    {
+        Streams s(streams, records);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t received = 0;
+        while (received < total)
+        {
+            for (auto &queue : s.queues)
+            {
+                size_t n = queue->PopBatch(batch, 256);
+                for (size_t i = 0; i < n; ++i)
+                    s.Release(batch[i]);
+                received += n;
+                if (n == 0)
+                    std::this_thread::yield();
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        inputRate = total / elapsed.count();
+        std::cout << "round-robin drain: " << inputRate / 1e6 << " M records/s" << std::endl;
+    }
+
+    {
+        Streams s(streams, records);
+        std::vector<DataQueue *> inputs;
+        for (auto &queue : s.queues)
+            inputs.push_back(queue.get());
+        MergeStage merge(inputs, lateness);
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t received = 0, last = 0, disorder = 0;
+        while (received < total)
+        {
+            size_t n = merge.PopBatch(batch, 256);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (batch[i]->getTime < last)
+                    ++disorder;
+                last = batch[i]->getTime;
+                s.Release(batch[i]);
+            }
+            received += n;
+            if (n == 0)
+            {
+                // 所有生产者都结束了，不再等待空的输入
+                if (s.finished == streams)
+                    merge.Close();
+                std::this_thread::yield();
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double mergeRate = total / elapsed.count();
+        std::cout << "merged " << streams << " streams: " << mergeRate / 1e6 << " M records/s ("
+                  << mergeRate / inputRate * 100 << "% of input rate), late " << merge.Late()
+                  << ", out of order " << disorder << std::endl;
+    }
+
+    {
+        std::vector<std::unique_ptr<RingDataQueue>> queues;
+        std::vector<DataQueue *> inputs;
+        std::vector<ProtocolDataVar> storage(total);
+        std::mt19937_64 rng(42);
+        for (size_t s = 0; s < streams; ++s)
+        {
+            queues.emplace_back(new RingDataQueue(records));
+            inputs.push_back(queues.back().get());
+            uint64_t t = s;
+            for (uint64_t i = 0; i < records; ++i)
+            {
+                t += 1 + rng() % 32;
+                ProtocolDataVar *pData = &storage[s * records + i];
+                pData->getTime = t;
+                queues.back()->Push(pData);
+            }
+        }
+        MergeStage merge(inputs, lateness);
+        merge.Close();
+
+        auto start = std::chrono::steady_clock::now();
+        uint64_t received = 0, checksum = 0;
+        size_t n;
+        while ((n = merge.PopBatch(batch, 256)) != 0)
+        {
+            for (size_t i = 0; i < n; ++i)
+                checksum += batch[i]->getTime;
+            received += n;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double mergeRate = received / elapsed.count();
+        std::cout << "merge capacity (preloaded): " << mergeRate / 1e6 << " M records/s ("
+                  << mergeRate / inputRate * 100 << "% of input rate), checksum " << checksum << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * socket 输出插件的吞吐测试
+ *
+ * 用法: ./bench-sink [records] [batch_bytes] [deadline_us] [slow_receiver]
+ * 本进程里起一个接收线程代替汇聚进程，监听临时的 Unix socket，按批头切分、校验并检查序号连续。
+ *  1. 每条数据编码成单独一批、一次 write：对照组；
+ *  2. 经过 libsocket-sink.so 批量发送：统计每秒条数、每条数据摊到的 sendmsg 次数、短写次数；
+ *  3. 每毫秒一条的低速数据：检查按 deadline 封口，统计从 ProcessData 到收到的延迟。
+ * slow_receiver 为1时接收方每读64次停1ms，用来制造 socket 写满、部分写入的情况。
+ */
+
+#include "PluginImplWrapper.h"
+#include "event_loop.h"
+#include "socket_sink.h"
+#include "wire_format.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static uint64_t SteadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 代替汇聚进程：接受一个连接，读到对端关闭为止
+class Receiver
+{
+public:
+    Receiver(const std::string &path, bool slow) : slow_(slow)
+    {
+        listenfd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        if (bind(listenfd_, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenfd_, 1) < 0)
+        {
+            perror("bind/listen");
+            exit(1);
+        }
+        path_ = path;
+        thread_ = std::thread(&Receiver::Run, this);
+    }
+
+    ~Receiver()
+    {
+        if (thread_.joinable())
+            thread_.join();
+        close(listenfd_);
+        unlink(path_.c_str());
+    }
+
+    void Wait() { thread_.join(); }
+
+    uint64_t records = 0;
+    uint64_t reads = 0;
+    uint64_t disorder = 0;
+    uint64_t latencySum = 0;
+    uint64_t latencyMax = 0;
+
+private:
+    void Run()
+    {
+        int fd = accept(listenfd_, nullptr, nullptr);
+        std::vector<char> buf(1 << 20);
+        size_t used = 0;
+        while (true)
+        {
+            if (used == buf.size())
+                buf.resize(buf.size() * 2);
+            ssize_t n = read(fd, buf.data() + used, buf.size() - used);
+            if (n <= 0)
+                break;
+            ++reads;
+            used += n;
+            if (slow_ && reads % 64 == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            // 按批头里的长度切分，不完整的批留到下次
+            size_t off = 0, size;
+            while ((size = wire::BatchView::PeekSize(buf.data() + off, used - off)) != 0 && size <= used - off)
+            {
+                wire::BatchView batch(buf.data() + off, size);
+                uint64_t now = SteadyNow();
+                for (size_t i = 0; i < batch.Count(); ++i)
+                {
+                    wire::RecordView record = batch[i];
+                    if (record.GetTime() != records)
+                        ++disorder;
+                    ++records;
+                    // value 里是发送时刻
+                    uint64_t latency = now - (uint64_t)record.Value();
+                    latencySum += latency;
+                    if (latency > latencyMax)
+                        latencyMax = latency;
+                }
+                off += size;
+            }
+            memmove(buf.data(), buf.data() + off, used - off);
+            used -= off;
+        }
+        close(fd);
+    }
+
+    int listenfd_;
+    std::string path_;
+    bool slow_;
+    std::thread thread_;
+};
+
+static int Connect(const std::string &path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static void Report(const char *title, const Receiver &receiver, uint64_t records, double seconds, uint64_t syscalls)
+{
+    std::cout << title << ": " << records / seconds / 1e6 << " M records/s, " << (double)syscalls / records
+              << " write syscalls/record, " << (double)receiver.reads / records << " reads/record, received "
+              << receiver.records << (receiver.records == records && !receiver.disorder ? "" : "  MISMATCH") << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t records = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    std::string batch = argc > 2 ? argv[2] : "65536";
+    std::string deadline = argc > 3 ? argv[3] : "2000";
+    bool slow = argc > 4 && atoi(argv[4]) != 0;
+    std::string path = "/tmp/plugin-sink-" + std::to_string(getpid()) + ".sock";
+
+    ProtocolDataVar data;
+    data.name = "cpu.user";
+    data.unit = "percent";
+    data.group = "host-1";
+    data.source = "collector";
+
+    // 1. 每条一次 write
+    {
+        Receiver receiver(path, slow);
+        int fd = Connect(path);
+        wire::BatchWriter writer;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < records; ++i)
+        {
+            data.getTime = i;
+            data.value = (double)SteadyNow();
+            writer.Reset();
+            writer.Add(data);
+            writer.Finish();
+            size_t off = 0;
+            while (off < writer.Size())
+            {
+                ssize_t n = write(fd, writer.Data() + off, writer.Size() - off);
+                if (n <= 0)
+                    break;
+                off += n;
+            }
+        }
+        close(fd);
+        receiver.Wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        Report("write per record", receiver, records, elapsed.count(), records);
+    }
+
+    EventLoop loop(1);
+    std::string param = path + ";batch=" + batch + ";deadline_us=" + deadline;
+
+    // 2. 经过插件批量发送，队列满被丢弃的重试，保证对端收全
+    {
+        Receiver receiver(path, slow);
+        PluginImplWrapper<SocketSink> sink("./libsocket-sink.so", "Instance");
+        if (!sink)
+            return 1;
+        sink->SetHardwareParam((void *)param.c_str());
+        sink->SetEventLoop(&loop);
+        if (!sink->Start())
+            return 1;
+
+        uint64_t retries = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < records; ++i)
+        {
+            data.getTime = i;
+            data.value = (double)SteadyNow();
+            while (sink->ProcessData(&data) != 0)
+            {
+                ++retries;
+                std::this_thread::yield();
+            }
+        }
+        sink->Stop();
+        receiver.Wait();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        Report("socket sink", receiver, records, elapsed.count(), sink->Syscalls());
+        std::cout << "  " << sink->Batches() << " batches (" << (double)records / sink->Batches() << " records/batch), "
+                  << sink->ShortWrites() << " short writes, " << retries << " rejected while queue full" << std::endl;
+    }
+
+    // 3. 低速数据，靠 deadline 封口
+    {
+        const uint64_t trickle = 200;
+        Receiver receiver(path, false);
+        PluginImplWrapper<SocketSink> sink("./libsocket-sink.so", "Instance");
+        sink->SetHardwareParam((void *)param.c_str());
+        sink->SetEventLoop(&loop);
+        if (!sink->Start())
+            return 1;
+        for (uint64_t i = 0; i < trickle; ++i)
+        {
+            data.getTime = i;
+            data.value = (double)SteadyNow();
+            sink->ProcessData(&data);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        sink->Stop();
+        receiver.Wait();
+        std::cout << "trickle 1 record/ms: received " << receiver.records << "/" << trickle << ", latency mean "
+                  << receiver.latencySum / 1000.0 / receiver.records << " us, max " << receiver.latencyMax / 1000.0
+                  << " us, " << sink->Batches() << " batches" << std::endl;
+    }
+
+    loop.Stop();
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * 二进制编码的吞吐测试
+ *
+ * 用法: ./bench-wire [records] [passes]
+ * 同一批记录分别用 wire_format.h 和最直接的 stringstream 写法编码、解码，比较每秒条数和每条的字节数。
+ * 二进制格式的读分两种：只通过 RecordView 访问字段(不拷贝)，和拷回 ProtocolDataVar。
+ */
+
+#include "wire_format.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 对照组：长度前缀的文本格式，字符串写成 "长度:内容"
+static void TextEncode(std::ostream &os, const ProtocolDataVar &data)
+{
+    os << data.name.size() << ':' << data.name << data.unit.size() << ':' << data.unit << data.group.size() << ':'
+       << data.group << data.source.size() << ':' << data.source << data.getTime << ' ' << std::setprecision(17)
+       << data.value << ' ';
+}
+
+static void TextString(std::istream &is, std::string &s)
+{
+    size_t size;
+    is >> size;
+    is.get();
+    s.resize(size);
+    is.read(&s[0], size);
+}
+
+static void TextDecode(std::istream &is, ProtocolDataVar &data)
+{
+    TextString(is, data.name);
+    TextString(is, data.unit);
+    TextString(is, data.group);
+    TextString(is, data.source);
+    is >> data.getTime >> data.value;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    size_t records = argc > 1 ? atoi(argv[1]) : 256;
+    int passes = argc > 2 ? atoi(argv[2]) : 2000;
+
+    static const char *names[] = {"cpu.user", "cpu.system", "memory.used", "disk.read_bytes", "net.rx_packets"};
+    static const char *units[] = {"percent", "bytes", "packets"};
+    std::vector<ProtocolDataVar> input(records), output(records);
+    std::mt19937_64 rng(1);
+    for (size_t i = 0; i < records; ++i)
+    {
+        input[i].name = names[rng() % 5];
+        input[i].unit = units[rng() % 3];
+        input[i].group = "host-" + std::to_string(rng() % 64);
+        input[i].source = "collector";
+        input[i].getTime = 1700000000000000000ULL + i * 1000;
+        input[i].value = (double)(rng() % 100000) / 7;
+    }
+    double total = (double)records * passes;
+
+    // 二进制编码
+    wire::BatchWriter writer;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        writer.Reset();
+        for (auto &data : input)
+            writer.Add(data);
+        writer.Finish();
+    }
+    double encodeTime = Seconds(start);
+    size_t wireBytes = writer.Size();
+
+    // 只读视图：校验一遍，再访问每条的字段
+    start = std::chrono::steady_clock::now();
+    double sum = 0;
+    size_t length = 0;
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        wire::BatchView batch(writer.Data(), writer.Size());
+        for (size_t i = 0; i < batch.Count(); ++i)
+        {
+            wire::RecordView record = batch[i];
+            sum += record.Value();
+            length += record.Name().size() + record.Group().size();
+        }
+    }
+    double viewTime = Seconds(start);
+
+    // 拷回 ProtocolDataVar，output 里的字符串容量复用
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        wire::BatchView batch(writer.Data(), writer.Size());
+        for (size_t i = 0; i < batch.Count(); ++i)
+            batch[i].CopyTo(output[i]);
+    }
+    double copyTime = Seconds(start);
+    bool wireOk = output.back().name == input.back().name && output.back().value == input.back().value;
+
+    // stringstream
+    std::string text;
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        std::ostringstream os;
+        for (auto &data : input)
+            TextEncode(os, data);
+        text = os.str();
+    }
+    double textEncodeTime = Seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        std::istringstream is(text);
+        for (size_t i = 0; i < records; ++i)
+            TextDecode(is, output[i]);
+    }
+    double textDecodeTime = Seconds(start);
+    bool textOk = output.back().name == input.back().name && output.back().value == input.back().value;
+
+    std::cout << "wire:   encode " << total / encodeTime / 1e6 << " M/s, view " << total / viewTime / 1e6
+              << " M/s, decode " << total / copyTime / 1e6 << " M/s, " << (double)wireBytes / records
+              << " bytes/record" << (wireOk ? "" : "  MISMATCH") << std::endl;
+    std::cout << "stream: encode " << total / textEncodeTime / 1e6 << " M/s, decode " << total / textDecodeTime / 1e6
+              << " M/s, " << (double)text.size() / records << " bytes/record" << (textOk ? "" : "  MISMATCH")
+              << std::endl;
+    std::cout << "(checksum " << sum + length << ")" << std::endl;
+
+    return 0;
+}
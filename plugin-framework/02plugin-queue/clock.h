@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * 插件用的时钟
+ *
+ * 采集插件原来直接 sleep_for 和 time(NULL)，性能测试没法复现：跑一次要等真实时间，数据的时间戳每次都不同。
+ * 宿主通过 PluginImpl::SetClock 下发时钟，插件所有取时间、等待都走它：
+ *  - SystemClock：真实时间，默认使用；
+ *  - VirtualClock：虚拟时间，SleepUntil 不阻塞，直接把时间拨到截止时刻。
+ *    回放测试给每个采集插件一个独立的 VirtualClock，数据的时间戳只取决于负载模型，
+ *    整条流水线能跑多快就跑多快。
+ * 时间单位都是纳秒；SystemClock 从1970年开始计，VirtualClock 从构造时给的起点开始计。
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    virtual uint64_t Now() = 0;
+    virtual void SleepUntil(uint64_t deadline) = 0;
+
+    void SleepFor(std::chrono::nanoseconds duration) { SleepUntil(Now() + duration.count()); }
+
+    static constexpr uint64_t kSecond = 1000000000ULL;
+};
+
+class SystemClock : public Clock
+{
+public:
+    virtual uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    virtual void SleepUntil(uint64_t deadline)
+    {
+        std::this_thread::sleep_until(std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(deadline))));
+    }
+
+    // 插件没有收到 SetClock 时使用
+    static SystemClock *Instance()
+    {
+        static SystemClock clock;
+        return &clock;
+    }
+};
+
+// 只能由一个线程 SleepUntil，其他线程可以随时 Now
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(uint64_t start = 0) : now_(start) {}
+
+    virtual uint64_t Now() { return now_.load(std::memory_order_acquire); }
+
+    virtual void SleepUntil(uint64_t deadline)
+    {
+        if (deadline > now_.load(std::memory_order_relaxed))
+            now_.store(deadline, std::memory_order_release);
+    }
+
+private:
+    std::atomic<uint64_t> now_;
+};
@@ -0,0 +1,49 @@
+#include "co_collector.h"
+
+#include <cstdlib>
+
+extern "C" void *Instance() { return new CoCollector; }
+
+CoCollector::CoCollector()
+{
+    // 采集间隔可以通过环境变量调整
+    if (const char *env = getenv("CO_COLLECTOR_INTERVAL_MS"))
+        interval_ = std::chrono::milliseconds(atoi(env));
+}
+
+const char *CoCollector::Name()
+{
+    return "CoCollector";
+}
+
+CollectorTask CoCollector::Collect(int index)
+{
+    std::string source = "co" + std::to_string(index);
+
+    // 各采集对象错开一点启动时间，避免同一时刻全部醒来
+    co_await SleepFor(interval_ * (index % 100) / 100);
+
+    // 不需要 isRuning 标志：宿主停止执行器时直接销毁挂起中的协程帧
+    while (true)
+    {
+        co_await SleepFor(interval_);
+
+        ProtocolDataVar *pData = new ProtocolDataVar{
+            .name = std::string("time"),
+            .unit = std::string("unit"),
+            .group = std::string("group"),
+            .source = source,
+            .getTime = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count(),
+        };
+
+        co_yield pData;
+    }
+}
+
+int CoCollector::ReleaseData(ProtocolDataVar *pData)
+{
+    delete pData;
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "CoPluginImpl.h"
+
+// 协程版的 Collector：每个采集对象按固定间隔产生一条数据
+class CoCollector : public CoCollectorImpl
+{
+public:
+    CoCollector();
+
+    // 获取插件名称
+    virtual const char *Name();
+    virtual CollectorTask Collect(int index);
+    virtual int ReleaseData(ProtocolDataVar *pData);
+
+private:
+    std::chrono::milliseconds interval_{100};
+};
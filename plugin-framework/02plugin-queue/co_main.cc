@@ -0,0 +1,110 @@
+/**
+ * 协程版采集插件的宿主
+ *
+ * 用法: ./co-plugin-queue [collectors] [threads] [seconds]
+ * 默认 10000 个采集协程跑在 4 个线程上，运行 3 秒；
+ * 最后起同样数量(最多1000个)的线程模拟 collector.cc 的写法，对比每个采集对象占用的内存。
+ */
+
+#include "CoPluginImpl.h"
+#include "PluginImplWrapper.h"
+#include "data_queue.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// 从 /proc/self/status 读取 VmRSS/VmSize，单位KB
+static long ReadStatusKB(const std::string &key)
+{
+    std::ifstream ifs("/proc/self/status");
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        if (line.compare(0, key.size(), key) == 0)
+            return atol(line.c_str() + key.size() + 1);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int collectors = argc > 1 ? atoi(argv[1]) : 10000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 3;
+    // atoi 遇到非数字返回0，运行时长为0时后面算吞吐会除以0
+    if (collectors <= 0 || threads <= 0 || seconds <= 0)
+    {
+        std::cerr << "usage: " << argv[0] << " [collectors] [threads] [seconds], all must be positive" << std::endl;
+        return 1;
+    }
+
+    PluginImplWrapper<CoCollectorImpl> plugin("./libco-collector.so", "Instance");
+    if (!plugin)
+        return 1;
+    std::cout << plugin->Name() << ": " << collectors << " collectors on " << threads << " threads" << std::endl;
+
+    LockedDataQueue queue(65536);
+    uint64_t received = 0;
+
+    {
+        long rssBefore = ReadStatusKB("VmRSS");
+        CoExecutor executor(threads);
+        for (int i = 0; i < collectors; ++i)
+            executor.Spawn(plugin->Collect(i), &queue, plugin.get());
+        long rssAfter = ReadStatusKB("VmRSS");
+        std::cout << "coroutines: " << (rssAfter - rssBefore) * 1024.0 / collectors << " bytes rss per collector" << std::endl;
+
+        ProtocolDataVar *batch[256];
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            size_t n = queue.PopBatch(batch, 256);
+            if (n == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            for (size_t i = 0; i < n; ++i)
+                plugin->ReleaseData(batch[i]);
+            received += n;
+        }
+
+        executor.Stop();
+
+        size_t n;
+        while ((n = queue.PopBatch(batch, 256)) != 0)
+        {
+            for (size_t i = 0; i < n; ++i)
+                plugin->ReleaseData(batch[i]);
+        }
+    }
+    std::cout << "received " << received << " records, " << received / seconds << " records/s" << std::endl;
+
+    // 对比：每个采集对象一个线程
+    int threadCollectors = collectors < 1000 ? collectors : 1000;
+    long rssBefore = ReadStatusKB("VmRSS");
+    long vmBefore = ReadStatusKB("VmSize");
+    std::atomic<bool> isRunning(true);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCollectors; ++i)
+    {
+        workers.emplace_back([&isRunning]() {
+            while (isRunning)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    long rssAfter = ReadStatusKB("VmRSS");
+    long vmAfter = ReadStatusKB("VmSize");
+    isRunning = false;
+    for (auto &t : workers)
+        t.join();
+
+    std::cout << "threads:    " << (rssAfter - rssBefore) * 1024.0 / threadCollectors << " bytes rss, "
+              << (vmAfter - vmBefore) * 1024.0 / threadCollectors << " bytes virtual per collector" << std::endl;
+
+    return 0;
+}
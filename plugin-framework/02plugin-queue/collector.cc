@@ -2,8 +2,6 @@
 
 #include <iostream>
 
-#include <time.h>
-
 extern "C" void *Instance() { return new Collector; }
 
 const char *Collector::Name()
@@ -15,20 +13,37 @@ bool Collector::Start()
 {
     isRuning = true;
 
+    // 记录池放在采集线程所在的节点上，数据由本线程写入
+    pool_.reset(new RecordPool(1024, placement_.node));
+
     auto func = [this]() {
+        if (!placement::PinCurrentThread(placement_.cpus))
+        {
+            std::cout << "Collector: pin thread failed" << std::endl;
+        }
+
         while (isRuning)
         {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            clock_->SleepFor(std::chrono::seconds(1));
 
-            ProtocolDataVar *pData = new ProtocolDataVar{
-                .name = std::string("time"),
-                .unit = std::string("unit"),
-                .group = std::string("group"),
-                .source = std::string("source"),
-                .getTime = (uint64_t)time(NULL),
-            };
+            ProtocolDataVar *pData = pool_->Acquire();
+            pData->name = "time";
+            pData->unit = "unit";
+            pData->group = "group";
+            pData->source = "source";
+            pData->getTime = clock_->Now() / Clock::kSecond;
+            pData->value = (double)pData->getTime;
 
-            pQueue_->push(pData);
+            // 队列满就等消费者，停止时还没放进去的直接回收
+            while (!pQueue_->Push(pData))
+            {
+                if (!isRuning)
+                {
+                    ReleaseData(pData);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
         }
     };
 
@@ -40,20 +55,34 @@ bool Collector::Start()
 bool Collector::Stop()
 {
     isRuning = false;
-    thread_.join();
+    if (thread_.joinable())
+        thread_.join();
 
     return true;
 }
 
+void Collector::SetPlacement(const StagePlacement &placement)
+{
+    placement_ = placement;
+}
+
+void Collector::SetClock(Clock *pClock)
+{
+    clock_ = pClock;
+}
+
 int Collector::ReleaseData(ProtocolDataVar *pData)
 {
-    delete pData;
+    if (pool_)
+        pool_->Release(pData);
+    else
+        delete pData;
     pData = nullptr;
     return 0;
 }
 
-void Collector::SetDataQueue(std::queue<ProtocolDataVar *> *pQueue)
+void Collector::SetDataQueue(DataQueue *pQueue)
 {
     pQueue_ = pQueue;
     return;
-}
\ No newline at end of file
+}
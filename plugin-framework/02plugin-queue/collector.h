@@ -1,6 +1,11 @@
 #pragma once
 
 #include "PluginImpl.h"
+#include "clock.h"
+#include "placement.h"
+#include "record_pool.h"
+#include <atomic>
+#include <memory>
 #include <thread>
 #include <chrono>
 
@@ -8,17 +13,22 @@ class Collector : public PluginImpl
 {
 private:
     /* data */
-    std::queue<ProtocolDataVar *> *pQueue_ = nullptr;
-    bool isRuning = false;
+    DataQueue *pQueue_ = nullptr;
+    std::atomic<bool> isRuning{false};
     std::thread thread_;
+    StagePlacement placement_;
+    std::unique_ptr<RecordPool> pool_;
+    Clock *clock_ = SystemClock::Instance();
 
 public:
     // 获取插件名称
     virtual const char *Name();
     virtual bool Start();
     virtual bool Stop();
+    virtual void SetPlacement(const StagePlacement &placement);
+    virtual void SetClock(Clock *pClock);
 
     // ==================生产类别插件接口==================
     virtual int ReleaseData(ProtocolDataVar *pData);
-    virtual void SetDataQueue(std::queue<ProtocolDataVar *> *pQueue);
+    virtual void SetDataQueue(DataQueue *pQueue);
 };
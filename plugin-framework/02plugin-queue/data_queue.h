@@ -0,0 +1,60 @@
+#pragma once
+
+#include "PluginImpl.h"
+#include "spsc_queue.h"
+
+#include <deque>
+#include <mutex>
+
+// 默认的数据队列：一个采集插件对应一个消费循环，直接用 SpscQueue 实现
+class RingDataQueue : public DataQueue
+{
+public:
+    explicit RingDataQueue(size_t capacity, int node = -1) : ring_(capacity, node) {}
+
+    virtual bool Push(ProtocolDataVar *pData) { return ring_.TryPush(pData); }
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max) { return ring_.TryPopBatch(out, max); }
+    virtual size_t Size() { return ring_.Size(); }
+
+private:
+    SpscQueue<ProtocolDataVar *> ring_;
+};
+
+// 多个线程同时往里放数据时使用(比如协程执行器的多个工作线程)，加锁实现
+class LockedDataQueue : public DataQueue
+{
+public:
+    explicit LockedDataQueue(size_t capacity) : capacity_(capacity) {}
+
+    virtual bool Push(ProtocolDataVar *pData)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= capacity_)
+            return false;
+        queue_.push_back(pData);
+        return true;
+    }
+
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t n = 0;
+        while (n < max && !queue_.empty())
+        {
+            out[n++] = queue_.front();
+            queue_.pop_front();
+        }
+        return n;
+    }
+
+    virtual size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<ProtocolDataVar *> queue_;
+    size_t capacity_;
+};
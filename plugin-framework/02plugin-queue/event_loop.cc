@@ -0,0 +1,194 @@
+#include "event_loop.h"
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// 当前线程正在执行哪个注册编号的回调，用来识别在回调里 Remove 自己的情况
+static thread_local uint64_t tls_current_id = 0;
+
+EventLoop::EventLoop(size_t threads)
+{
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0)
+        throw std::system_error(errno, std::system_category(), "epoll_create1");
+
+    wakefd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakefd_ < 0)
+    {
+        int err = errno;
+        close(epfd_);
+        throw std::system_error(err, std::system_category(), "eventfd");
+    }
+
+    // 编号0留给唤醒fd，水平触发且不带ONESHOT，Stop时所有线程都能看到
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = 0;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+
+    for (size_t i = 0; i < threads; ++i)
+        threads_.emplace_back(&EventLoop::Loop, this);
+}
+
+EventLoop::~EventLoop()
+{
+    Stop();
+    close(wakefd_);
+    close(epfd_);
+}
+
+bool EventLoop::Add(int fd, uint32_t events, Callback callback)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ids_.count(fd))
+    {
+        errno = EEXIST;
+        return false;
+    }
+
+    uint64_t id = nextId_++;
+    Watch &watch = watches_[id];
+    watch.fd = fd;
+    watch.events = events;
+    watch.callback = std::move(callback);
+
+    epoll_event ev{};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.u64 = id;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        int err = errno;
+        watches_.erase(id);
+        errno = err;
+        return false;
+    }
+    ids_[fd] = id;
+    return true;
+}
+
+bool EventLoop::Modify(int fd, uint32_t events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(fd);
+    if (it == ids_.end())
+    {
+        errno = ENOENT;
+        return false;
+    }
+
+    Watch &watch = watches_[it->second];
+    watch.events = events;
+    // 回调执行中的话等它结束时再重新打开；
+    // 事件已经被 epoll_wait 取走、还没开始执行的窗口里这里会提前打开，重复的事件在 Dispatch 里被丢弃
+    if (watch.running)
+        return true;
+
+    epoll_event ev{};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.u64 = it->second;
+    return epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+bool EventLoop::Remove(int fd)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = ids_.find(fd);
+    if (it == ids_.end())
+    {
+        errno = ENOENT;
+        return false;
+    }
+
+    uint64_t id = it->second;
+    ids_.erase(it);
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+
+    Watch &watch = watches_[id];
+    watch.removed = true;
+    if (id == tls_current_id)
+    {
+        watch.detached = true; // 回调还在栈上，由 Dispatch 返回后释放
+        return true;
+    }
+
+    idle_.wait(lock, [&]() { return !watch.running; });
+    watches_.erase(id);
+    return true;
+}
+
+void EventLoop::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+            return;
+        stopping_ = true;
+    }
+
+    uint64_t one = 1;
+    ssize_t ret = write(wakefd_, &one, sizeof(one));
+    (void)ret;
+
+    for (auto &t : threads_)
+        t.join();
+}
+
+void EventLoop::Loop()
+{
+    epoll_event events[16];
+    while (true)
+    {
+        int n = epoll_wait(epfd_, events, 16, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.u64 == 0)
+                return;
+            Dispatch(events[i].data.u64, events[i].events);
+        }
+    }
+}
+
+void EventLoop::Dispatch(uint64_t id, uint32_t events)
+{
+    Watch *watch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = watches_.find(id);
+        if (it == watches_.end() || it->second.removed || it->second.running)
+            return;
+        // unordered_map 的元素地址在rehash时也不变，回调期间 Remove 会等待 running 清零，可以放心用指针
+        watch = &it->second;
+        watch->running = true;
+    }
+
+    tls_current_id = id;
+    watch->callback(watch->fd, events);
+    tls_current_id = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watch->running = false;
+        if (watch->detached)
+        {
+            watches_.erase(id);
+        }
+        else if (!watch->removed)
+        {
+            epoll_event ev{};
+            ev.events = watch->events | EPOLLONESHOT;
+            ev.data.u64 = id;
+            epoll_ctl(epfd_, EPOLL_CTL_MOD, watch->fd, &ev);
+        }
+    }
+    idle_.notify_all();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+/**
+ * 基于epoll的事件循环服务，由宿主持有，I/O类采集插件把fd注册进来
+ *
+ * 串口、socket类的采集插件如果各自开线程阻塞在 read 上，设备一多线程数就跟着涨。
+ * 这里所有fd共用一个epoll实例，由一个小线程池调用 epoll_wait 分发就绪回调。
+ *
+ * 每个fd都以 EPOLLONESHOT 注册，回调执行完才重新打开，所以同一个fd的回调不会在两个线程上并发执行，
+ * 插件在回调里不需要为自己的读缓冲加锁。
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+class EventLoop
+{
+public:
+    // events 为本次就绪的事件(EPOLLIN/EPOLLOUT/EPOLLHUP/EPOLLERR...)
+    typedef std::function<void(int fd, uint32_t events)> Callback;
+
+    explicit EventLoop(size_t threads = 1);
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // 注册fd，失败返回false并保留errno；fd的所有权仍在调用者手里
+    bool Add(int fd, uint32_t events, Callback callback);
+
+    // 修改关注的事件，下一次回调开始生效
+    bool Modify(int fd, uint32_t events);
+
+    /*
+     * 取消注册。返回后保证该fd的回调不会再被调用：
+     * 如果回调正在别的线程上执行，会等它执行完再返回；在自己的回调里调用则立即返回。
+     */
+    bool Remove(int fd);
+
+    void Stop();
+
+private:
+    struct Watch
+    {
+        int fd;
+        uint32_t events;
+        Callback callback;
+        bool running = false;  // 回调正在执行
+        bool removed = false;  // 已经 Remove，不再重新打开
+        bool detached = false; // 在自己的回调里 Remove 的，回调返回后由 Dispatch 释放
+    };
+
+    void Loop();
+    void Dispatch(uint64_t id, uint32_t events);
+
+    int epfd_ = -1;
+    int wakefd_ = -1;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    // epoll_event.data 里存的是注册编号而不是指针，Remove之后迟到的事件查不到编号，直接丢弃
+    std::unordered_map<uint64_t, Watch> watches_;
+    std::unordered_map<int, uint64_t> ids_;
+    uint64_t nextId_ = 1;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,141 @@
+/**
+ * I/O类采集插件的宿主：所有设备共用一个epoll事件循环
+ *
+ * 用法: ./event-plugin-queue [lines] [loop_threads]
+ * 用管道、socketpair、伪终端代替真实的串口和socket，每个设备写入lines行，
+ * 检查全部被收到，并输出吞吐。
+ */
+
+#include "PluginImpl.h"
+#include "PluginImplWrapper.h"
+#include "data_queue.h"
+#include "event_loop.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void WriteLines(int fd, int lines)
+{
+    for (int i = 0; i < lines; ++i)
+    {
+        std::string line = "sample " + std::to_string(i) + "\n";
+        size_t off = 0;
+        while (off < line.size())
+        {
+            ssize_t n = write(fd, line.data() + off, line.size() - off);
+            if (n > 0)
+                off += n;
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int lines = argc > 1 ? atoi(argv[1]) : 10000;
+    int threads = argc > 2 ? atoi(argv[2]) : 2;
+
+    int pipefd[2];
+    int sv[2];
+    if (pipe(pipefd) < 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("pipe/socketpair");
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+
+    // 设备路径，fd:N 表示由插件接管宿主打开的fd
+    std::vector<std::string> devices = {
+        "fd:" + std::to_string(pipefd[0]),
+        "fd:" + std::to_string(sv[0]),
+        ptsname(master),
+    };
+    std::vector<int> writers = {pipefd[1], sv[1], master};
+
+    EventLoop loop(threads);
+    LockedDataQueue queue(65536);
+
+    std::vector<std::unique_ptr<PluginImplWrapper<PluginImpl>>> collectors;
+    for (auto &device : devices)
+    {
+        collectors.emplace_back(new PluginImplWrapper<PluginImpl>("./libio-collector.so", "Instance"));
+        PluginImpl *collector = collectors.back()->get();
+        collector->SetHardwareParam((void *)device.c_str());
+        collector->SetEventLoop(&loop);
+        collector->SetDataQueue(&queue);
+        if (!collector->Start())
+            return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> writerThreads;
+    for (int fd : writers)
+        writerThreads.emplace_back(WriteLines, fd, lines);
+
+    std::map<std::string, int> received;
+    size_t total = 0, expected = (size_t)lines * devices.size();
+    ProtocolDataVar *batch[256];
+    auto deadline = start + std::chrono::seconds(10);
+    while (total < expected && std::chrono::steady_clock::now() < deadline)
+    {
+        size_t n = queue.PopBatch(batch, 256);
+        if (n == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            ++received[batch[i]->source];
+            collectors[0]->get()->ReleaseData(batch[i]);
+        }
+        total += n;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (auto &t : writerThreads)
+        t.join();
+    for (auto &collector : collectors)
+        (*collector)->Stop();
+    loop.Stop();
+
+    size_t n;
+    while ((n = queue.PopBatch(batch, 256)) != 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            collectors[0]->get()->ReleaseData(batch[i]);
+    }
+
+    for (auto &device : devices)
+        std::cout << device << ": " << received[device] << "/" << lines << std::endl;
+    std::cout << total << " records in " << elapsed.count() << "s, " << total / elapsed.count() << " records/s on "
+              << threads << " loop threads" << std::endl;
+
+    for (int fd : {pipefd[0], pipefd[1], sv[0], sv[1], master})
+        close(fd);
+
+    if (total != expected)
+    {
+        std::cout << "FAILED: missing records" << std::endl;
+        return 1;
+    }
+    return 0;
+}
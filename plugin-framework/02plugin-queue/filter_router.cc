@@ -0,0 +1,563 @@
+#include "filter_router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// 递归下降解析，直接输出后缀表达式形式的指令
+// 换行和分号由词法分析当作规则之间的分隔符(记号 ";")，引号里的分号和字符串一起读走，不会把规则切开
+class RuleParser
+{
+public:
+    RuleParser(FilterRouter &router, const std::string &rules) : router_(router), rules_(rules) {}
+
+    void Parse()
+    {
+        while (true)
+        {
+            ruleBegin_ = pos_;
+            std::string token = Peek();
+            if (token.empty())
+                return;
+            if (token == ";")
+            {
+                Next();
+                continue;
+            }
+            ParseRule();
+            if (!AtRuleEnd())
+                Fail("unexpected '" + Peek() + "'");
+        }
+    }
+
+private:
+    void ParseRule()
+    {
+        std::string target = Next();
+        if (!IsWord(target))
+            Fail("expect target");
+        Expect(":");
+
+        if (target == "default")
+        {
+            router_.defaultTarget_ = TargetId(Next());
+            return;
+        }
+
+        int id = TargetId(target);
+        ParseOr();
+
+        FilterRouter::Insn route;
+        route.op = FilterRouter::Insn::kRoute;
+        route.target = id;
+        router_.program_.push_back(route);
+    }
+
+    static bool IsSpecial(char c) { return strchr(":()[],!&|<>=~\";", c) != nullptr; }
+    static bool IsWord(const std::string &token) { return !token.empty() && (token[0] == '"' || !IsSpecial(token[0])); }
+
+    bool AtRuleEnd()
+    {
+        std::string token = Peek();
+        return token.empty() || token == ";";
+    }
+
+    // 出错信息带上第几行和出错的那条规则，规则的范围到下一个不在引号里的分隔符为止
+    [[noreturn]] void Fail(const std::string &what)
+    {
+        size_t begin = ruleBegin_;
+        while (begin < rules_.size() && (isspace((unsigned char)rules_[begin]) || rules_[begin] == ';'))
+            ++begin;
+        size_t end = begin;
+        bool quoted = false;
+        for (; end < rules_.size() && rules_[end] != '\n' && (quoted || rules_[end] != ';'); ++end)
+        {
+            if (rules_[end] == '"')
+                quoted = !quoted;
+        }
+        size_t line = 1 + std::count(rules_.begin(), rules_.begin() + begin, '\n');
+        throw std::invalid_argument("filter rule at line " + std::to_string(line) + " '" + rules_.substr(begin, end - begin) +
+                                    "': " + what);
+    }
+
+    // 词法分析：返回下一个记号，结束时返回空串，规则分隔符返回 ";"；带引号的字符串保留开头的引号用来区分
+    std::string Lex(size_t &pos)
+    {
+        while (pos < rules_.size() && rules_[pos] != '\n' && isspace((unsigned char)rules_[pos]))
+            ++pos;
+        if (pos >= rules_.size())
+            return "";
+
+        char c = rules_[pos];
+        if (c == '\n' || c == ';')
+        {
+            ++pos;
+            return ";";
+        }
+        if (c == '"')
+        {
+            // 字符串不能跨行
+            size_t end = rules_.find_first_of("\"\n", pos + 1);
+            if (end == std::string::npos || rules_[end] != '"')
+                Fail("unterminated string");
+            std::string token = rules_.substr(pos, end - pos);
+            pos = end + 1;
+            return token;
+        }
+        if (IsSpecial(c))
+        {
+            static const char *ops[] = {"&&", "||", "==", "!=", "<=", ">="};
+            for (const char *op : ops)
+            {
+                if (rules_.compare(pos, 2, op) == 0)
+                {
+                    pos += 2;
+                    return op;
+                }
+            }
+            ++pos;
+            return std::string(1, c);
+        }
+
+        size_t begin = pos;
+        while (pos < rules_.size() && !isspace((unsigned char)rules_[pos]) && !IsSpecial(rules_[pos]))
+            ++pos;
+        return rules_.substr(begin, pos - begin);
+    }
+
+    std::string Peek()
+    {
+        size_t pos = pos_;
+        return Lex(pos);
+    }
+
+    std::string Next() { return Lex(pos_); }
+
+    void Expect(const std::string &token)
+    {
+        std::string got = Next();
+        if (got != token)
+            Fail("expect '" + token + "' but got '" + got + "'");
+    }
+
+    static std::string Unquote(const std::string &token) { return token[0] == '"' ? token.substr(1) : token; }
+
+    double Number()
+    {
+        std::string token = Next();
+        if (!IsWord(token) || token[0] == '"')
+            Fail("expect number but got '" + token + "'");
+        char *end = nullptr;
+        double number = strtod(token.c_str(), &end);
+        if (*end != '\0')
+            Fail("bad number '" + token + "'");
+        return number;
+    }
+
+    int TargetId(const std::string &name)
+    {
+        if (!IsWord(name))
+            Fail("bad target '" + name + "'");
+        if (name == "drop")
+            return FilterRouter::kDrop;
+        auto &targets = router_.targets_;
+        for (size_t i = 0; i < targets.size(); ++i)
+        {
+            if (targets[i] == name)
+                return (int)i;
+        }
+        targets.push_back(name);
+        return (int)targets.size() - 1;
+    }
+
+    void Emit(FilterRouter::Insn::Op op)
+    {
+        FilterRouter::Insn insn;
+        insn.op = op;
+        router_.program_.push_back(insn);
+    }
+
+    void ParseOr()
+    {
+        ParseAnd();
+        while (Peek() == "||")
+        {
+            Next();
+            Emit(FilterRouter::Insn::kElse);
+            ParseAnd();
+            Emit(FilterRouter::Insn::kOr);
+        }
+    }
+
+    void ParseAnd()
+    {
+        ParseUnary();
+        while (Peek() == "&&")
+        {
+            Next();
+            Emit(FilterRouter::Insn::kThen);
+            ParseUnary();
+            Emit(FilterRouter::Insn::kAnd);
+        }
+    }
+
+    void ParseUnary()
+    {
+        std::string token = Peek();
+        if (token == "!")
+        {
+            Next();
+            ParseUnary();
+            Emit(FilterRouter::Insn::kNot);
+        }
+        else if (token == "(")
+        {
+            Next();
+            ParseOr();
+            Expect(")");
+        }
+        else
+        {
+            ParseAtom();
+        }
+    }
+
+    void ParseAtom()
+    {
+        static const char *fields[] = {"name", "group", "unit", "source"};
+        std::string field = Next();
+        if (field == "true")
+        {
+            Emit(FilterRouter::Insn::kTrue);
+            return;
+        }
+        if (field == "value")
+        {
+            ParseValue();
+            return;
+        }
+
+        FilterRouter::Insn insn;
+        insn.field = -1;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (field == fields[i])
+                insn.field = i;
+        }
+        if (insn.field < 0)
+            Fail("unknown field '" + field + "'");
+
+        std::string op = Next();
+        std::string operand = Next();
+        if (!IsWord(operand))
+            Fail("expect string but got '" + operand + "'");
+        operand = Unquote(operand);
+
+        if (op == "==" || op == "!=")
+        {
+            insn.op = FilterRouter::Insn::kStrEq;
+            insn.operand = operand;
+            router_.program_.push_back(insn);
+            if (op == "!=")
+                Emit(FilterRouter::Insn::kNot);
+            return;
+        }
+        if (op != "~")
+            Fail("unknown string operator '" + op + "'");
+
+        // 常见的通配符形式编译成更便宜的指令
+        size_t stars = std::count(operand.begin(), operand.end(), '*');
+        bool question = operand.find('?') != std::string::npos;
+        if (!question && stars == 0)
+        {
+            insn.op = FilterRouter::Insn::kStrEq;
+            insn.operand = operand;
+        }
+        else if (!question && stars == 1 && operand.back() == '*')
+        {
+            insn.op = FilterRouter::Insn::kStrPrefix;
+            insn.operand = operand.substr(0, operand.size() - 1);
+        }
+        else if (!question && stars == 1 && operand.front() == '*')
+        {
+            insn.op = FilterRouter::Insn::kStrSuffix;
+            insn.operand = operand.substr(1);
+        }
+        else
+        {
+            insn.op = FilterRouter::Insn::kStrGlob;
+            insn.operand = operand;
+        }
+        router_.program_.push_back(insn);
+    }
+
+    void ParseValue()
+    {
+        const double inf = std::numeric_limits<double>::infinity();
+        FilterRouter::Insn insn;
+        insn.op = FilterRouter::Insn::kValueRange;
+        bool negate = false;
+
+        std::string op = Next();
+        if (op == "in")
+        {
+            std::string open = Next();
+            if (open != "[" && open != "(")
+                Fail("expect '[' or '('");
+            double low = Number();
+            Expect(",");
+            double high = Number();
+            std::string close = Next();
+            if (close != "]" && close != ")")
+                Fail("expect ']' or ')'");
+            insn.number = open == "(" ? std::nextafter(low, inf) : low;
+            insn.number2 = close == ")" ? std::nextafter(high, -inf) : high;
+        }
+        else
+        {
+            double number = Number();
+            insn.number = -inf;
+            insn.number2 = inf;
+            if (op == "<")
+                insn.number2 = std::nextafter(number, -inf);
+            else if (op == "<=")
+                insn.number2 = number;
+            else if (op == ">")
+                insn.number = std::nextafter(number, inf);
+            else if (op == ">=")
+                insn.number = number;
+            else if (op == "==" || op == "!=")
+            {
+                insn.number = insn.number2 = number;
+                negate = op == "!=";
+            }
+            else
+                Fail("unknown value operator '" + op + "'");
+        }
+
+        router_.program_.push_back(insn);
+        if (negate)
+            Emit(FilterRouter::Insn::kNot);
+    }
+
+    FilterRouter &router_;
+    const std::string &rules_;
+    size_t pos_ = 0;
+    size_t ruleBegin_ = 0;
+};
+
+// 对一批数据的某个字符串字段逐条判断，只看 care 里的那些；判断条件在循环外选好，循环里没有多余的分支
+template <typename Pred>
+static uint64_t MatchString(ProtocolDataVar *const *batch, uint64_t care, std::string ProtocolDataVar::*field, Pred pred)
+{
+    uint64_t mask = 0;
+    while (care)
+    {
+        int i = __builtin_ctzll(care);
+        care &= care - 1;
+        const std::string &s = batch[i]->*field;
+        mask |= (uint64_t)pred(s.data(), s.size()) << i;
+    }
+    return mask;
+}
+
+// 通配符匹配，* 匹配任意串，? 匹配任意一个字符
+static bool GlobMatch(const char *p, const char *pend, const char *s, const char *send)
+{
+    const char *star = nullptr, *retry = nullptr;
+    while (s < send)
+    {
+        if (p < pend && (*p == '?' || *p == *s))
+        {
+            ++p;
+            ++s;
+        }
+        else if (p < pend && *p == '*')
+        {
+            star = ++p;
+            retry = s;
+        }
+        else if (star)
+        {
+            p = star;
+            s = ++retry;
+        }
+        else
+            return false;
+    }
+    while (p < pend && *p == '*')
+        ++p;
+    return p == pend;
+}
+
+FilterRouter::FilterRouter(const std::string &rules)
+{
+    RuleParser(*this, rules).Parse();
+    queues_.assign(targets_.size(), nullptr);
+
+    // 执行时用定长数组做栈，编译时先检查深度；求值范围栈(kThen/kElse 压入)不会比结果栈深
+    int depth = 0;
+    for (auto &insn : program_)
+    {
+        if (insn.op == Insn::kNot || insn.op == Insn::kThen || insn.op == Insn::kElse)
+            continue;
+        depth += (insn.op == Insn::kAnd || insn.op == Insn::kOr || insn.op == Insn::kRoute) ? -1 : 1;
+        if (depth > kMaxDepth)
+            throw std::invalid_argument("filter rules nested too deep");
+    }
+}
+
+int FilterRouter::Target(const std::string &name) const
+{
+    if (name == "drop")
+        return kDrop;
+    for (size_t i = 0; i < targets_.size(); ++i)
+    {
+        if (targets_[i] == name)
+            return (int)i;
+    }
+    throw std::invalid_argument("unknown route target: " + name);
+}
+
+void FilterRouter::Bind(const std::string &target, DataQueue *queue)
+{
+    int id = Target(target);
+    if (id != kDrop)
+        queues_[id] = queue;
+}
+
+void FilterRouter::Classify(ProtocolDataVar *const *batch, size_t n, int *targets) const
+{
+    static std::string ProtocolDataVar::*const fields[] = {
+        &ProtocolDataVar::name, &ProtocolDataVar::group, &ProtocolDataVar::unit, &ProtocolDataVar::source};
+
+    // 数值列先抽出来放在连续的数组里，区间比较的循环就能向量化
+    double values[kBatch];
+    for (size_t i = 0; i < n; ++i)
+        values[i] = batch[i]->value;
+
+    uint64_t all = n == 64 ? ~0ULL : (1ULL << n) - 1;
+    uint64_t pending = all; // 还没有分配去向的
+    uint64_t stack[kMaxDepth];
+    int top = 0;
+    // 求值范围：结果只保证在 care 的那些位上正确，其余位由上层的与/或运算屏蔽掉
+    uint64_t cares[kMaxDepth + 1];
+    int careTop = 0;
+    uint64_t care = pending;
+
+    for (auto &insn : program_)
+    {
+        uint64_t mask = 0;
+        switch (insn.op)
+        {
+        case Insn::kStrEq:
+        case Insn::kStrPrefix:
+        case Insn::kStrSuffix:
+        case Insn::kStrGlob:
+        {
+            if (!care)
+            {
+                stack[top++] = 0;
+                break;
+            }
+            std::string ProtocolDataVar::*field = fields[insn.field];
+            const char *op = insn.operand.data();
+            size_t len = insn.operand.size();
+            if (insn.op == Insn::kStrEq)
+                mask = MatchString(batch, care, field, [=](const char *s, size_t size) {
+                    return size == len && memcmp(s, op, len) == 0;
+                });
+            else if (insn.op == Insn::kStrPrefix)
+                mask = MatchString(batch, care, field, [=](const char *s, size_t size) {
+                    return size >= len && memcmp(s, op, len) == 0;
+                });
+            else if (insn.op == Insn::kStrSuffix)
+                mask = MatchString(batch, care, field, [=](const char *s, size_t size) {
+                    return size >= len && memcmp(s + size - len, op, len) == 0;
+                });
+            else
+                mask = MatchString(batch, care, field, [=](const char *s, size_t size) {
+                    return GlobMatch(op, op + len, s, s + size);
+                });
+            stack[top++] = mask;
+            break;
+        }
+        case Insn::kValueRange:
+        {
+            double low = insn.number, high = insn.number2;
+            for (size_t i = 0; i < n; ++i)
+                mask |= (uint64_t)((values[i] >= low) & (values[i] <= high)) << i;
+            stack[top++] = mask;
+            break;
+        }
+        case Insn::kTrue:
+            stack[top++] = all;
+            break;
+        case Insn::kNot:
+            stack[top - 1] = ~stack[top - 1] & all;
+            break;
+        case Insn::kThen:
+            cares[careTop++] = care;
+            care &= stack[top - 1];
+            break;
+        case Insn::kElse:
+            cares[careTop++] = care;
+            care &= ~stack[top - 1];
+            break;
+        case Insn::kAnd:
+            --top;
+            stack[top - 1] &= stack[top];
+            care = cares[--careTop];
+            break;
+        case Insn::kOr:
+            --top;
+            stack[top - 1] |= stack[top];
+            care = cares[--careTop];
+            break;
+        case Insn::kRoute:
+        {
+            uint64_t hit = stack[--top] & pending;
+            pending &= ~hit;
+            care = pending;
+            while (hit)
+            {
+                targets[__builtin_ctzll(hit)] = insn.target;
+                hit &= hit - 1;
+            }
+            // 整批都有去向了，后面的规则不用再算
+            if (!pending)
+                return;
+            break;
+        }
+        }
+    }
+
+    while (pending)
+    {
+        targets[__builtin_ctzll(pending)] = defaultTarget_;
+        pending &= pending - 1;
+    }
+}
+
+void FilterRouter::Route(ProtocolDataVar *const *batch, size_t n)
+{
+    int targets[kBatch];
+    for (size_t off = 0; off < n; off += kBatch)
+    {
+        size_t count = n - off < kBatch ? n - off : kBatch;
+        Classify(batch + off, count, targets);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ProtocolDataVar *pData = batch[off + i];
+            DataQueue *queue = targets[i] == kDrop ? nullptr : queues_[targets[i]];
+            if (queue && queue->Push(pData))
+                continue;
+
+            ++dropped_;
+            if (dropHandler_)
+                dropHandler_(pData);
+        }
+    }
+}
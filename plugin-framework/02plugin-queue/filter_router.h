@@ -0,0 +1,103 @@
+#pragma once
+
+/**
+ * 过滤/路由阶段：把规则编译成一段扁平的判定程序，按批(64条)执行
+ *
+ * 以前每个加工插件自己判断要不要处理这条数据，每条数据都要一次虚函数调用加若干次字符串比较。
+ * 这里在宿主里统一做：规则只解析一次，编译成后缀表达式形式的指令序列，
+ * 执行时每条指令一次处理一整批，结果是一个64位掩码(第i位表示批里第i条是否满足)，
+ * 与/或/非就是掩码的位运算，数值比较的循环可以被编译器向量化。
+ * && 和 || 保留短路语义：右边的条件只对左边还没决定结果的那些数据求值，
+ * 已经被前面规则分走的数据也不再参与后面规则的字符串比较。
+ *
+ * 规则语法，每行(或分号分隔)一条，从上到下第一条命中的生效：
+ *      目标: 条件
+ *  目标是路由名(用 Bind 绑定到下游队列)或者 drop；
+ *  default: 目标      指定都不命中时的去向，不写则丢弃。
+ *  条件由以下原子条件经 && || ! 和括号组合而成：
+ *      name ~ cpu.*        字符串字段(name/group/unit/source)按通配符匹配，支持 * 和 ?
+ *      group == sys        字符串字段相等，!= 为不等
+ *      value >= 90         数值比较，支持 < <= > >= == !=
+ *      value in [0, 100)   数值区间，方括号闭、圆括号开
+ *      true                恒成立
+ *  含空格或特殊字符的字符串用双引号括起来，引号里的分号不算规则分隔符，字符串不能跨行。
+ *
+ * 例:
+ *      hot: name ~ cpu.* && value >= 90
+ *      drop: value < 0 || name ~ debug*
+ *      sys: group == sys
+ *      default: main
+ *
+ * 规则有语法错误时构造函数抛出 std::invalid_argument，错误信息里有出错规则的行号和原文。
+ */
+
+#include "PluginImpl.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class FilterRouter
+{
+public:
+    explicit FilterRouter(const std::string &rules);
+
+    // 路由目标的编号，drop 为 kDrop；未在规则里出现的名字抛出 std::invalid_argument
+    int Target(const std::string &name) const;
+    const std::vector<std::string> &Targets() const { return targets_; }
+
+    // 把路由目标绑定到下游队列，没绑定的目标等同于 drop
+    void Bind(const std::string &target, DataQueue *queue);
+
+    // 被丢弃的数据(包括下游队列满的)交给这个回调，一般是采集插件的 ReleaseData
+    void SetDropHandler(std::function<void(ProtocolDataVar *)> handler) { dropHandler_ = std::move(handler); }
+
+    // 只计算每条数据的去向，n 不超过 kBatch
+    void Classify(ProtocolDataVar *const *batch, size_t n, int *targets) const;
+
+    // 计算去向并放进对应的下游队列，n 不限
+    void Route(ProtocolDataVar *const *batch, size_t n);
+
+    uint64_t Dropped() const { return dropped_; }
+
+    static constexpr int kDrop = -1;
+    static constexpr size_t kBatch = 64;
+
+    // 编译后的指令，对外可见只是为了方便打印调试
+    struct Insn
+    {
+        enum Op
+        {
+            kStrEq,     // 字符串字段 == operand
+            kStrPrefix, // 以 operand 开头，"abc*"
+            kStrSuffix, // 以 operand 结尾，"*abc"
+            kStrGlob,   // 一般的通配符
+            kValueRange, // number <= value <= number2，开区间在编译时用 nextafter 换成闭区间
+            kNot,
+            kThen, // && 的右边开始：只对左边为真的数据求值
+            kElse, // || 的右边开始：只对左边为假的数据求值
+            kAnd,
+            kOr,
+            kTrue,
+            kRoute, // 弹出掩码，尚未分配去向且命中的数据去 target
+        } op;
+        int field = 0; // 字符串字段：0 name 1 group 2 unit 3 source
+        std::string operand;
+        double number = 0;
+        double number2 = 0;
+        int target = kDrop;
+    };
+    const std::vector<Insn> &Program() const { return program_; }
+
+private:
+    friend class RuleParser;
+
+    static constexpr int kMaxDepth = 32;
+
+    std::vector<Insn> program_;
+    std::vector<std::string> targets_;
+    std::vector<DataQueue *> queues_;
+    int defaultTarget_ = kDrop;
+    std::function<void(ProtocolDataVar *)> dropHandler_;
+    uint64_t dropped_ = 0;
+};
@@ -0,0 +1,106 @@
+#include "host_pipeline.h"
+
+#include "data_queue.h"
+#include "spill_queue.h"
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+static std::chrono::microseconds LatencySlo()
+{
+    const char *slo = getenv("PLUGIN_LATENCY_SLO_US");
+    long long sloUs = slo ? atoll(slo) : 0;
+    return std::chrono::microseconds(sloUs > 0 ? sloUs : 2000);
+}
+
+HostPipeline::HostPipeline(PluginImpl *collector, PluginImpl *processor, int queueNode)
+    : collector_(collector), processor_(processor), batcher_(LatencySlo(), 1, 1024), latest_(4096),
+      batch_(1024), targets_(batch_.size(), 0), lastAggregate_(std::chrono::steady_clock::now())
+{
+    const char *budgetSpec = getenv("PLUGIN_MEMORY_BUDGET");
+    if (budgetSpec)
+        budget_.Parse(budgetSpec);
+    const char *filterRules = getenv("PLUGIN_FILTER");
+    if (filterRules)
+        filter_.reset(new FilterRouter(filterRules));
+
+    const char *spillDir = getenv("PLUGIN_SPILL_DIR");
+    if (spillDir)
+    {
+        // 内存里超过 1MB 的记录转去写盘，写盘后的记录在采集线程上还给插件
+        spill_ = new SpillDataQueue(1 << 20, spillDir, [collector](ProtocolDataVar *pData) { collector->ReleaseData(pData); });
+        inner_.reset(spill_);
+    }
+    else
+    {
+        // 队列属于采集阶段，内存放在采集线程所在的节点上
+        inner_.reset(new RingDataQueue(1024, queueNode));
+    }
+
+    MemoryAccount *pluginAccount = budget_.Account(std::string("plugin.") + collector->Name());
+    MemoryAccount *queueAccount = budget_.Account("queue.main", pluginAccount);
+    queue_.reset(new BudgetedDataQueue(*inner_, *queueAccount));
+    // 写盘的记录已经还给插件，不再算在途
+    if (spill_)
+        spill_->SetAccount(queueAccount);
+
+    batchSizeId_ = latest_.Interner().Intern("host/batch_size");
+}
+
+size_t HostPipeline::RunOnce()
+{
+    // 各线程的记账计数器定期汇总，更新高水位
+    if (std::chrono::steady_clock::now() - lastAggregate_ >= std::chrono::milliseconds(100))
+    {
+        budget_.Aggregate();
+        lastAggregate_ = std::chrono::steady_clock::now();
+    }
+
+    size_t n = queue_->PopBatch(batch_.data(), batcher_.BatchSize());
+    if (n == 0)
+    {
+        std::this_thread::sleep_for(batcher_.IdleWait());
+        batcher_.OnIdle();
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (filter_)
+    {
+        for (size_t off = 0; off < n; off += FilterRouter::kBatch)
+            filter_->Classify(&batch_[off], n - off < FilterRouter::kBatch ? n - off : FilterRouter::kBatch, &targets_[off]);
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (targets_[i] == FilterRouter::kDrop)
+        {
+            ++filtered_;
+            collector_->ReleaseData(batch_[i]);
+            continue;
+        }
+
+        if (processor_)
+            processor_->ProcessData(batch_[i]);
+
+        latest_.Update(batch_[i]);
+
+        ++processed_;
+        collector_->ReleaseData(batch_[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    batcher_.OnBatch(n, queue_->Size(), end - start);
+    latest_.Update(batchSizeId_, std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+                   (double)batcher_.BatchSize());
+    return n;
+}
+
+void HostPipeline::Drain()
+{
+    size_t n;
+    while ((n = queue_->PopBatch(batch_.data(), batch_.size())) != 0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            collector_->ReleaseData(batch_[i]);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * 宿主的数据通路：采集插件 -> 队列 -> 消费循环(过滤、加工插件、最新值) -> 还给采集插件
+ *
+ * plugin-queue 和回放测试 pipeline-replay 共用这一份代码，回放测出来的就是宿主实际跑的通路：
+ *  - 队列：默认 RingDataQueue；设置环境变量 PLUGIN_SPILL_DIR 时换成溢出写盘的 SpillDataQueue，
+ *    内存里超过 1MB 的记录转去写盘；外面套 BudgetedDataQueue，账户为 plugin.<采集插件名> 和其下的 queue.main，
+ *    预算由 PLUGIN_MEMORY_BUDGET 指定；
+ *  - 消费：每次取多少条由 AdaptiveBatcher 决定，延迟目标由 PLUGIN_LATENCY_SLO_US 指定，默认2000微秒；
+ *    设置 PLUGIN_FILTER 时先按规则过滤，去向为 drop 的记录直接还给采集插件，
+ *    其余交给加工插件、更新 LatestValueTable，再还给采集插件；选中的批大小作为序列 host/batch_size 写进最新值缓存；
+ *  - 每 100ms 汇总一次记账。
+ *
+ * 配置格式错误时构造函数抛出 std::invalid_argument，溢出目录不可用时抛出 std::system_error。
+ * 采集插件只有一个，队列是单生产者的；RunOnce/Drain 只能在消费线程上调用。
+ */
+
+#include "PluginImpl.h"
+#include "adaptive_batch.h"
+#include "filter_router.h"
+#include "latest_value.h"
+#include "memory_budget.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class SpillDataQueue;
+
+class HostPipeline
+{
+public:
+    // collector 接收 ReleaseData，processor 可以为空；queueNode 是内存队列所在的NUMA节点
+    HostPipeline(PluginImpl *collector, PluginImpl *processor, int queueNode = -1);
+
+    HostPipeline(const HostPipeline &) = delete;
+    HostPipeline &operator=(const HostPipeline &) = delete;
+
+    // 交给采集插件 SetDataQueue 的队列
+    DataQueue *Queue() { return queue_.get(); }
+
+    // 取一批处理完，返回条数；队列为空时按 AdaptiveBatcher 的建议等待一会儿，返回0
+    size_t RunOnce();
+
+    // 采集插件停止后调用：队列里剩下的记录不经处理，直接还给采集插件
+    void Drain();
+
+    LatestValueTable &Latest() { return latest_; }
+    MemoryBudget &Budget() { return budget_; }
+    const AdaptiveBatcher &Batcher() const { return batcher_; }
+    SpillDataQueue *Spill() { return spill_; } // 没有开溢出写盘时为空
+
+    uint64_t Processed() const { return processed_; } // 交给加工插件的条数
+    uint64_t Filtered() const { return filtered_; }   // 被规则丢弃的条数
+
+private:
+    PluginImpl *collector_;
+    PluginImpl *processor_;
+    // 成员按依赖顺序声明：记账队列引用内层队列和账户，要先于它们析构
+    MemoryBudget budget_;
+    std::unique_ptr<FilterRouter> filter_;
+    std::unique_ptr<DataQueue> inner_;
+    SpillDataQueue *spill_ = nullptr;
+    std::unique_ptr<BudgetedDataQueue> queue_;
+    AdaptiveBatcher batcher_;
+    // 每个序列的最新值，看板类的读者随时 Snapshot，不经过加工插件
+    LatestValueTable latest_;
+    uint32_t batchSizeId_;
+
+    std::vector<ProtocolDataVar *> batch_;
+    std::vector<int> targets_;
+    std::chrono::steady_clock::time_point lastAggregate_;
+    uint64_t processed_ = 0;
+    uint64_t filtered_ = 0;
+};
@@ -0,0 +1,198 @@
+#include "io_collector.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" void *Instance() { return new IoCollector; }
+
+IoCollector::~IoCollector()
+{
+    Stop();
+}
+
+const char *IoCollector::Name()
+{
+    return "IoCollector";
+}
+
+bool IoCollector::SetHardwareParam(void *pHardwareConfig)
+{
+    if (!pHardwareConfig)
+        return false;
+    device_ = static_cast<const char *>(pHardwareConfig);
+    return true;
+}
+
+void IoCollector::SetEventLoop(EventLoop *pLoop)
+{
+    pLoop_ = pLoop;
+}
+
+void IoCollector::SetDataQueue(DataQueue *pQueue)
+{
+    pQueue_ = pQueue;
+}
+
+bool IoCollector::Start()
+{
+    if (!pLoop_ || !pQueue_ || device_.empty())
+        return false;
+
+    // open 也要非阻塞：没有写端的 FIFO、等载波的串口，阻塞打开会卡住宿主的启动
+    owned_ = device_.compare(0, 3, "fd:") != 0;
+    if (owned_)
+        fd_ = open(device_.c_str(), O_RDONLY | O_NOCTTY | O_CLOEXEC | O_NONBLOCK);
+    else
+        fd_ = fcntl(atoi(device_.c_str() + 3), F_DUPFD_CLOEXEC, 0);
+
+    if (fd_ < 0)
+    {
+        std::cout << "IoCollector: open " << device_ << " failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // fd: 接管的描述符和宿主共用打开文件，改 O_NONBLOCK 会连宿主自己的fd(比如终端上的stdin)一起改掉，
+    // 这里不动它的标志，读的时候再想办法不阻塞，见 ReadSome
+    struct stat st;
+    socket_ = !owned_ && fstat(fd_, &st) == 0 && S_ISSOCK(st.st_mode);
+
+    // 串口按原始模式读，关掉行缓冲和回显；只改自己打开的设备，Stop 时恢复
+    rawMode_ = false;
+    if (owned_ && isatty(fd_) && tcgetattr(fd_, &savedTio_) == 0)
+    {
+        termios tio = savedTio_;
+        cfmakeraw(&tio);
+        rawMode_ = tcsetattr(fd_, TCSANOW, &tio) == 0;
+    }
+
+    if (!pLoop_->Add(fd_, EPOLLIN, [this](int, uint32_t) { OnReadable(); }))
+    {
+        std::cout << "IoCollector: register " << device_ << " failed: " << strerror(errno) << std::endl;
+        if (rawMode_)
+            tcsetattr(fd_, TCSANOW, &savedTio_);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+bool IoCollector::Stop()
+{
+    if (fd_ < 0)
+        return true;
+
+    pLoop_->Remove(fd_);
+    if (rawMode_)
+        tcsetattr(fd_, TCSANOW, &savedTio_);
+    close(fd_);
+    fd_ = -1;
+    pending_.clear();
+    skipping_ = false;
+
+    if (dropped_)
+        std::cout << "IoCollector: " << device_ << " dropped " << dropped_ << " records" << std::endl;
+    return true;
+}
+
+ssize_t IoCollector::ReadSome(char *buf, size_t len)
+{
+    if (owned_)
+        return read(fd_, buf, len);
+    if (socket_)
+        return recv(fd_, buf, len, MSG_DONTWAIT);
+
+    // 接管的管道、终端没有 MSG_DONTWAIT，先用0超时的 poll 确认可读再读，不会阻塞在 read 上
+    pollfd pfd = {fd_, POLLIN, 0};
+    int ready = poll(&pfd, 1, 0);
+    if (ready == 0)
+        errno = EAGAIN;
+    if (ready <= 0)
+        return -1;
+    return read(fd_, buf, len);
+}
+
+void IoCollector::OnReadable()
+{
+    char buf[4096];
+    for (int i = 0; i < kReadsPerWakeup; ++i)
+    {
+        ssize_t n = ReadSome(buf, sizeof(buf));
+        if (n > 0)
+        {
+            pending_.append(buf, n);
+            SplitLines();
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        // 对端关闭(read返回0，pty对端关闭时是EIO)，不再关注这个fd，Stop时再关闭
+        pLoop_->Remove(fd_);
+        break;
+    }
+    // 没读完的数据还在内核里，fd是水平触发注册的，回调返回后重新打开会马上再次就绪
+}
+
+void IoCollector::SplitLines()
+{
+    size_t begin = 0, end;
+    while ((end = pending_.find('\n', begin)) != std::string::npos)
+    {
+        size_t len = end - begin;
+        if (len && pending_[end - 1] == '\r')
+            --len;
+        // 超长行的剩余部分，前半截已经丢掉计数了
+        if (skipping_)
+            skipping_ = false;
+        else
+            Emit(pending_.substr(begin, len));
+        begin = end + 1;
+    }
+    pending_.erase(0, begin);
+
+    // 设备一直不发换行时 pending_ 不能无限增长
+    if (pending_.size() > kMaxLineLength)
+    {
+        if (!skipping_)
+            ++dropped_;
+        skipping_ = true;
+        pending_.clear();
+    }
+}
+
+void IoCollector::Emit(const std::string &line)
+{
+    ProtocolDataVar *pData = new ProtocolDataVar{
+        .name = line,
+        .unit = std::string(""),
+        .group = std::string("io"),
+        .source = device_,
+        .getTime = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count(),
+    };
+
+    // 回调里不能阻塞，队列满就丢弃并计数
+    if (!pQueue_->Push(pData))
+    {
+        ++dropped_;
+        ReleaseData(pData);
+    }
+}
+
+int IoCollector::ReleaseData(ProtocolDataVar *pData)
+{
+    delete pData;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "PluginImpl.h"
+#include "event_loop.h"
+
+#include <atomic>
+#include <string>
+
+#include <termios.h>
+
+/**
+ * I/O驱动的采集插件：从串口/socket/管道按行读取数据
+ *
+ * SetHardwareParam 传入 const char * 设备路径，例如 "/dev/ttyS3"；
+ * 也可以是 "fd:N"，表示直接使用宿主已经打开的fd(插件内部会dup一份)，方便接管 socketpair、管道。
+ * dup 出来的fd和宿主共用同一个打开文件，所以插件不改它的 O_NONBLOCK 和终端属性，
+ * 只有自己 open 的设备才设成非阻塞、切到原始模式，Stop 时恢复终端属性。
+ * 不开线程，读操作全部在宿主事件循环的回调里完成。
+ */
+class IoCollector : public PluginImpl
+{
+private:
+    // 一次回调最多读几次，读不完留给下一次就绪，不让一个写得快的设备占住事件循环的线程
+    static const int kReadsPerWakeup = 4;
+    // 一行的最大长度，超过还没遇到换行就丢掉这一行并计入 dropped_
+    static const size_t kMaxLineLength = 64 * 1024;
+
+    std::string device_;
+    int fd_ = -1;
+    bool owned_ = false;   // 设备是插件自己 open 的，不是 fd:N 接管的
+    bool socket_ = false;  // 接管的fd是socket，可以用 MSG_DONTWAIT 非阻塞读
+    bool rawMode_ = false; // 切过原始模式，savedTio_ 是切换前的终端属性
+    termios savedTio_;
+    bool skipping_ = false; // 正在丢弃一行超长数据，直到下一个换行
+    EventLoop *pLoop_ = nullptr;
+    DataQueue *pQueue_ = nullptr;
+    std::string pending_; // 还没凑成一整行的数据
+    std::atomic<uint64_t> dropped_{0};
+
+    void OnReadable();
+    ssize_t ReadSome(char *buf, size_t len);
+    void SplitLines();
+    void Emit(const std::string &line);
+
+public:
+    virtual ~IoCollector();
+
+    // 获取插件名称
+    virtual const char *Name();
+    virtual bool Start();
+    virtual bool Stop();
+    virtual bool SetHardwareParam(void *pHardwareConfig);
+    virtual void SetEventLoop(EventLoop *pLoop);
+
+    // ==================生产类别插件接口==================
+    virtual int ReleaseData(ProtocolDataVar *pData);
+    virtual void SetDataQueue(DataQueue *pQueue);
+};
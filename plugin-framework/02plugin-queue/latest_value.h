@@ -0,0 +1,201 @@
+#pragma once
+
+/**
+ * 最新值缓存：每个序列只保留最新的一条
+ *
+ * 看板只关心每个序列的当前值，不应该挂在加工插件的处理路径上。
+ * 宿主在消费循环里顺手 Update，看板线程随时 Snapshot。
+ *
+ * 序列名(group/name)先 intern 成从0开始的整数编号，编号直接作为槽位下标。
+ * 每个槽位一把顺序锁(seqlock)：
+ *  - 写者把 seq 从偶数CAS成奇数，写完再加一变回偶数，同一个槽位的写者之间互斥，不同槽位互不影响；
+ *  - 读者不加锁，读前读后各看一次 seq，两次相同且为偶数就说明读到的是一致的值，否则重读。
+ * 读者从不阻塞写者，写者也不用等读者。
+ *
+ * Snapshot 保证每一条都是一致的(时间和值来自同一次写入)，但不同条目之间不是同一时刻的快照。
+ */
+
+#include "PluginImpl.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 序列名到编号的映射，编号一经分配不再改变
+class SeriesInterner
+{
+public:
+    explicit SeriesInterner(size_t capacity) : capacity_(capacity) {}
+
+    // 超出容量时返回 kInvalid
+    uint32_t Intern(const std::string &key)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(key);
+            if (it != ids_.end())
+                return it->second;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(key);
+        if (it != ids_.end())
+            return it->second;
+        if (names_.size() >= capacity_)
+            return kInvalid;
+
+        uint32_t id = (uint32_t)names_.size();
+        ids_.emplace(key, id);
+        names_.push_back(key);
+        return id;
+    }
+
+    std::string Name(uint32_t id)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return id < names_.size() ? names_[id] : std::string();
+    }
+
+    size_t Size()
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return names_.size();
+    }
+
+    static constexpr uint32_t kInvalid = ~0U;
+
+private:
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<std::string> names_;
+    size_t capacity_;
+};
+
+class LatestValueTable
+{
+public:
+    struct Entry
+    {
+        uint32_t id;
+        uint64_t getTime;
+        double value;
+    };
+
+    // 槽位一次分配好，之后不再扩容，读者不需要担心数组搬家
+    explicit LatestValueTable(size_t capacity) : interner_(capacity), slots_(new Slot[capacity]), capacity_(capacity) {}
+
+    SeriesInterner &Interner() { return interner_; }
+
+    // 宿主消费循环里调用：按 group/name 找到序列并更新
+    bool Update(const ProtocolDataVar *pData)
+    {
+        // 拼接用的缓冲区按线程复用，热路径上不分配内存
+        static thread_local std::string key;
+        key.assign(pData->group).append("/").append(pData->name);
+        uint32_t id = interner_.Intern(key);
+        if (id == SeriesInterner::kInvalid)
+            return false;
+        return Update(id, pData->getTime, pData->value);
+    }
+
+    // 已经知道编号的写者直接用这个，省掉一次字符串查找；编号无效(包括表满时 Intern 返回的 kInvalid)返回false
+    bool Update(uint32_t id, uint64_t getTime, double value)
+    {
+        if (id == SeriesInterner::kInvalid || id >= capacity_)
+            return false;
+
+        Slot &slot = slots_[id];
+        uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+        for (int spins = 0;; ++spins)
+        {
+            if (seq & 1)
+            {
+                Backoff(spins);
+                seq = slot.seq.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (slot.seq.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+        }
+        // 保证数据的写入不会被重排到 seq 变成奇数之前
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        slot.getTime.store(getTime, std::memory_order_relaxed);
+        slot.value.store(bits, std::memory_order_relaxed);
+
+        slot.seq.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    // 从未写过的序列返回false
+    bool Read(uint32_t id, Entry &entry) const
+    {
+        if (id >= capacity_)
+            return false;
+
+        const Slot &slot = slots_[id];
+        uint64_t before, after, getTime, bits;
+        for (int spins = 0;; Backoff(++spins))
+        {
+            before = slot.seq.load(std::memory_order_acquire);
+            getTime = slot.getTime.load(std::memory_order_relaxed);
+            bits = slot.value.load(std::memory_order_relaxed);
+            // 保证数据的读取不会被重排到第二次读 seq 之后
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = slot.seq.load(std::memory_order_relaxed);
+            if (!(before & 1) && before == after)
+                break;
+        }
+
+        if (before == 0)
+            return false;
+
+        entry.id = id;
+        entry.getTime = getTime;
+        memcpy(&entry.value, &bits, sizeof(bits));
+        return true;
+    }
+
+    // 读取所有写过的序列，返回条数；out 可以复用，稳定后不再分配内存
+    size_t Snapshot(std::vector<Entry> &out)
+    {
+        size_t size = interner_.Size();
+        out.resize(size);
+        size_t n = 0;
+        for (uint32_t id = 0; id < size; ++id)
+        {
+            if (Read(id, out[n]))
+                ++n;
+        }
+        out.resize(n);
+        return n;
+    }
+
+private:
+    // 写者在写到一半时被调度走，别的线程会一直看到奇数；自旋一阵子还不行就让出CPU
+    static void Backoff(int spins)
+    {
+        if (spins > 64)
+            std::this_thread::yield();
+    }
+
+    // 每个槽位独占一条cache line，相邻序列的写者不会互相干扰
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> seq{0}; // 奇数表示正在写
+        std::atomic<uint64_t> getTime{0};
+        std::atomic<uint64_t> value{0}; // double 的二进制位
+    };
+
+    SeriesInterner interner_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+};
@@ -1,102 +1,109 @@
 #include "PluginImpl.h"
+#include "PluginImplWrapper.h"
+#include "host_pipeline.h"
+#include "placement.h"
+#include <atomic>
 #include <iostream>
-#include <queue>
+#include <cstdlib>
+#include <stdexcept>
+#include <system_error>
 #include <chrono>
+#include <memory>
 #include <thread>
-#include <dlfcn.h> // dlopen, dlerror, dlsym, dlclose
-
-template <typename T>
-class PluginImplWrapper
+#include <vector>
+
+/*
+ * 用法: ./plugin-queue [placement]
+ * placement 格式见 placement.h，也可以通过环境变量 PLUGIN_PLACEMENT 指定，例如
+ *      ./plugin-queue "collector=1;main=2"
+ * 阶段名: collector(采集线程及其队列、记录池)，main(消费循环，加工插件在这里执行)
+ * 队列和消费循环在 HostPipeline(host_pipeline.h)里，回放测试 pipeline-replay 用的是同一份，环境变量：
+ *  PLUGIN_SPILL_DIR      队列换成溢出写盘的 SpillDataQueue(spill_queue.h)，消费跟不上时数据暂存到该目录
+ *  PLUGIN_LATENCY_SLO_US 批大小控制器 AdaptiveBatcher(adaptive_batch.h)的延迟目标，默认2000微秒；
+ *                        选中的批大小作为序列 host/batch_size 写进最新值缓存
+ *  PLUGIN_MEMORY_BUDGET  队列里的记录按字节记账(memory_budget.h)，账户为 plugin.<采集插件名> 和其下的 queue.main，
+ *                        例如 "plugin.Collector=256M;queue.main=64M"，超出预算时采集插件的 Push 失败
+ *  PLUGIN_FILTER         按其中的规则(filter_router.h)先过滤，去向为 drop 的记录不交给加工插件、不更新最新值，
+ *                        直接还给采集插件；宿主只有一个下游，其余去向都交给加工插件，例如
+ *                        "drop: name ~ debug* || value < 0; default: main"，不写 default 时都不命中的记录也被丢弃
+ */
+int main(int argc, char *argv[])
 {
-public:
-	explicit PluginImplWrapper(const char *lib_path, const char *instance)
+	PlacementConfig placement;
+	const char *spec = argc > 1 ? argv[1] : getenv("PLUGIN_PLACEMENT");
+	try
 	{
-		// 加载插件
-		handle_ = dlopen(lib_path, RTLD_LAZY);
-		if (!handle_)
-		{
-			std::cout << dlerror() << std::endl;
-		}
-
-		// 获取实例
-		GetPluginInterface *GetInstance = (GetPluginInterface *)dlsym(handle_, instance);
-		if (!GetInstance)
-		{
-			std::cout << "Error Instance function" << std::endl;
-		}
-
-		ptr_ = GetInstance();
-
-		if (!ptr_)
-		{
-			std::cout << "Error GetInstance" << std::endl;
-		}
+		if (spec)
+			placement.Parse(spec);
 	}
-	~PluginImplWrapper()
+	catch (const std::invalid_argument &e)
 	{
-		delete ptr_;
-		if (handle_)
-			dlclose(handle_);
+		std::cerr << e.what() << std::endl;
+		return 1;
 	}
+	std::cout << placement.Report();
 
-	T &operator*() const { return *ptr_; } //用 * 运算符解引用
-	T *operator->() const { return ptr_; } //用 -> 运算符指向对象成员
-	operator bool() const { return ptr_; } //像指针一样用在布尔表达式里
-
-	T *get() const { return ptr_; }
-
-private:
-	void *handle_ = nullptr;
-	T *ptr_ = nullptr;
-};
-
-int main()
-{
+	StagePlacement mainPlacement = placement.Get("main");
+	if (!placement::PinCurrentThread(mainPlacement.cpus))
+	{
+		std::cout << "pin main thread failed" << std::endl;
+	}
 
 	PluginImplWrapper<PluginImpl> collector("./libcollector.so", "Instance");
 	PluginImplWrapper<PluginImpl> processor("./libprocessor.so", "Instance");
 
-	std::queue<ProtocolDataVar *> queue;
+	StagePlacement collectorPlacement = placement.Get("collector");
+	std::unique_ptr<HostPipeline> pipeline;
+	try
+	{
+		pipeline.reset(new HostPipeline(collector.get(), processor.get(), collectorPlacement.node));
+	}
+	catch (const std::invalid_argument &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	catch (const std::system_error &e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	DataQueue *queue = pipeline->Queue();
 
 	std::cout << collector->Name() << std::endl;
-	collector->SetDataQueue(&queue);
+	collector->SetPlacement(collectorPlacement);
+	collector->SetDataQueue(queue);
 	collector->Start();
 
 	//测试5秒后退出
-	bool isRunning = true;
-	auto func = [](bool *isRunning) {std::this_thread::sleep_for(std::chrono::seconds(5)); *isRunning = false; };
+	std::atomic<bool> isRunning(true);
+	auto func = [](std::atomic<bool> *isRunning) {std::this_thread::sleep_for(std::chrono::seconds(5)); *isRunning = false; };
 	std::thread t1(func, &isRunning);
 
 	while (isRunning)
 	{
-		if (queue.empty())
-		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
-			continue;
-		}
-
-		ProtocolDataVar *pData = queue.front();
+		pipeline->RunOnce();
+	}
 
-		processor->ProcessData(pData);
+	std::cout << queue->Size() << std::endl;
 
-		collector->ReleaseData(pData);
+	collector->Stop();
 
-		queue.pop();
-	}
+	std::cout << queue->Size() << std::endl;
 
-	std::cout << queue.size() << std::endl;
+	pipeline->Drain();
 
-	collector->Stop();
+	t1.join();
 
-	std::cout << queue.size() << std::endl;
+	std::cout << pipeline->Budget().Report();
 
-	while (!queue.empty())
+	LatestValueTable &latest = pipeline->Latest();
+	std::vector<LatestValueTable::Entry> snapshot;
+	latest.Snapshot(snapshot);
+	for (auto &entry : snapshot)
 	{
-		collector->ReleaseData(queue.front());
-		queue.pop();
+		std::cout << latest.Interner().Name(entry.id) << " = " << entry.value << " @" << entry.getTime << std::endl;
 	}
 
-	t1.join();
-
 	return 0;
-}
\ No newline at end of file
+}
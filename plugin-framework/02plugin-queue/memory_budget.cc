@@ -0,0 +1,113 @@
+#include "memory_budget.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+MemoryAccount::MemoryAccount(const std::string &name, size_t budget, MemoryAccount *parent)
+    : name_(name), budget_(budget), parent_(parent), slack_(budget ? (int64_t)(budget / 32) : (1 << 20))
+{
+    if (slack_ < 1)
+        slack_ = 1;
+}
+
+size_t MemoryAccount::AssignSlot()
+{
+    static std::atomic<size_t> next{0};
+    size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot < kShared ? slot : kShared;
+}
+
+int64_t MemoryAccount::Aggregate()
+{
+    int64_t total = 0;
+    for (auto &slot : slots_)
+        total += slot.bytes.load(std::memory_order_relaxed);
+    bytes_.store(total, std::memory_order_relaxed);
+
+    int64_t high = highWater_.load(std::memory_order_relaxed);
+    while (total > high && !highWater_.compare_exchange_weak(high, total, std::memory_order_relaxed))
+    {
+    }
+    return total;
+}
+
+// 汇总的值可能还没扣掉消费线程刚取走的数据，拒绝之前重新汇总一次
+bool MemoryAccount::Recheck()
+{
+    return Aggregate() >= (int64_t)budget_;
+}
+
+static size_t ParseBytes(const std::string &text)
+{
+    char *end = nullptr;
+    unsigned long long value = strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str())
+        throw std::invalid_argument("bad byte count: " + text);
+
+    std::string suffix(end);
+    if (suffix == "K" || suffix == "k")
+        value <<= 10;
+    else if (suffix == "M" || suffix == "m")
+        value <<= 20;
+    else if (suffix == "G" || suffix == "g")
+        value <<= 30;
+    else if (!suffix.empty())
+        throw std::invalid_argument("bad byte count: " + text);
+    return value;
+}
+
+void MemoryBudget::Parse(const std::string &spec)
+{
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ';'))
+    {
+        if (item.empty())
+            continue;
+
+        size_t eq = item.find('=');
+        if (eq == std::string::npos || eq == 0)
+            throw std::invalid_argument("bad memory budget: " + item);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        budgets_[item.substr(0, eq)] = ParseBytes(item.substr(eq + 1));
+    }
+}
+
+MemoryAccount *MemoryBudget::Account(const std::string &name, MemoryAccount *parent)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &account : accounts_)
+    {
+        if (account->Name() == name)
+            return account.get();
+    }
+
+    auto it = budgets_.find(name);
+    accounts_.emplace_back(new MemoryAccount(name, it == budgets_.end() ? 0 : it->second, parent));
+    return accounts_.back().get();
+}
+
+void MemoryBudget::Aggregate()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &account : accounts_)
+        account->Aggregate();
+}
+
+std::string MemoryBudget::Report()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream oss;
+    for (auto &account : accounts_)
+    {
+        oss << account->Name() << ": " << account->Aggregate() << " bytes, high water " << account->HighWater();
+        if (account->Budget())
+            oss << ", budget " << account->Budget();
+        else
+            oss << ", no budget";
+        oss << ", rejected " << account->Rejected() << std::endl;
+    }
+    return oss.str();
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+/**
+ * 在途记录的内存记账与预算
+ *
+ * 以前没有任何地方知道队列里压着多少字节的 ProtocolDataVar(连同字符串)，下游一卡住进程就被 OOM 杀掉。
+ * 每个 MemoryAccount 记一个队列或一个插件的在途字节数，可以挂在父账户下面(比如队列挂在产生数据的插件下面)，
+ * 记账时沿着父账户一路加上去。
+ *
+ * 热路径上只写当前线程自己的计数器(每个线程一个槽位，各占一条 cache line，普通的读和写，没有带 lock 前缀的指令)，
+ * 不和其它线程抢同一个计数器；
+ * Aggregate 把各槽位加起来得到当前值并更新高水位。汇总的时机：
+ *  - 宿主定期调用 MemoryBudget::Aggregate；
+ *  - 某个线程自上次汇总以来记入的字节数超过 slack(预算的1/32，没有预算时1MB)时自己顺手汇总一次，
+ *    所以超出预算的量最多是 线程数*slack；
+ *  - 判断超预算准备拒绝之前再汇总一次，不会因为消费线程的扣减还没汇总而多拒绝。
+ * 高水位取的是各次汇总时的值，两次汇总之间的尖峰会漏掉，误差同样在 线程数*slack 以内。
+ *
+ * 预算配置格式同 placement.h，分号分隔："账户名=字节数"，字节数可以带 K/M/G 后缀，
+ *  例: "plugin.Collector=256M;queue.main=64M"，没有配置的账户不限额，只记账。
+ *
+ * BudgetedDataQueue 包装任意 DataQueue：Push 时记账，超预算时 Push 返回false(同队列满，由插件决定等待还是丢弃)，
+ * PopBatch 时扣账。包装 SpillDataQueue 时把同一个账户交给它的 SetAccount，写盘的记录会从账上扣掉(见 spill_queue.h)。
+ */
+
+#include "PluginImpl.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace budget_detail
+{
+    // 短字符串的缓冲区在对象内部
+    inline size_t HeapBytes(const std::string &s)
+    {
+        std::less_equal<const void *> le;
+        const char *self = reinterpret_cast<const char *>(&s);
+        if (le(self, s.data()) && le(s.data(), self + sizeof(s) - 1))
+            return 0;
+        return s.capacity() + 1;
+    }
+}
+
+// 一条记录占用的字节数：对象本身，加上字符串在堆上的缓冲区(短字符串存在对象内部，不另算)
+inline size_t RecordBytes(const ProtocolDataVar &data)
+{
+    using budget_detail::HeapBytes;
+    return sizeof(ProtocolDataVar) + HeapBytes(data.name) + HeapBytes(data.unit) + HeapBytes(data.group) +
+           HeapBytes(data.source);
+}
+
+class MemoryAccount
+{
+public:
+    // budget 为0表示不限额
+    MemoryAccount(const std::string &name, size_t budget, MemoryAccount *parent = nullptr);
+
+    MemoryAccount(const MemoryAccount &) = delete;
+    MemoryAccount &operator=(const MemoryAccount &) = delete;
+
+    // 记入(bytes>0)或扣除(bytes<0)，同时记到所有父账户上
+    void Charge(int64_t bytes)
+    {
+        for (MemoryAccount *account = this; account; account = account->parent_)
+            account->ChargeLocal(bytes);
+    }
+
+    // 本账户或任一父账户超出预算
+    bool OverBudget()
+    {
+        for (MemoryAccount *account = this; account; account = account->parent_)
+        {
+            if (account->budget_ && account->Bytes() >= (int64_t)account->budget_ && account->Recheck())
+                return true;
+        }
+        return false;
+    }
+
+    // 汇总各线程的计数器，返回当前字节数
+    int64_t Aggregate();
+
+    void CountRejected() { rejected_.fetch_add(1, std::memory_order_relaxed); }
+
+    const std::string &Name() const { return name_; }
+    size_t Budget() const { return budget_; }
+    MemoryAccount *Parent() const { return parent_; }
+    int64_t Bytes() const { return bytes_.load(std::memory_order_relaxed); } // 最近一次汇总的结果
+    int64_t HighWater() const { return highWater_.load(std::memory_order_relaxed); }
+    uint64_t Rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+    static constexpr size_t kSlots = 64;
+
+private:
+    struct alignas(64) Slot
+    {
+        std::atomic<int64_t> bytes{0};
+        std::atomic<int64_t> unsynced{0}; // 上次汇总以来本槽位记入的字节数
+    };
+
+    // 前 kSlots-1 个线程各自独占一个槽位，只有自己写，不需要原子的读改写；之后的线程共用最后一个槽位
+    static constexpr size_t kShared = kSlots - 1;
+    static constexpr size_t kUnassigned = ~(size_t)0;
+    static size_t AssignSlot();
+    static inline thread_local size_t threadSlot_ = kUnassigned;
+
+    bool Recheck();
+
+    static void Add(std::atomic<int64_t> &counter, int64_t bytes, bool exclusive)
+    {
+        if (exclusive)
+            counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        else
+            counter.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void ChargeLocal(int64_t bytes)
+    {
+        if (threadSlot_ == kUnassigned)
+            threadSlot_ = AssignSlot();
+        bool exclusive = threadSlot_ != kShared;
+        Slot &slot = slots_[threadSlot_];
+        Add(slot.bytes, bytes, exclusive);
+        if (bytes > 0)
+        {
+            Add(slot.unsynced, bytes, exclusive);
+            if (slot.unsynced.load(std::memory_order_relaxed) >= slack_)
+            {
+                slot.unsynced.store(0, std::memory_order_relaxed);
+                Aggregate();
+            }
+        }
+    }
+
+    std::string name_;
+    size_t budget_;
+    MemoryAccount *parent_;
+    int64_t slack_;
+
+    Slot slots_[kSlots];
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<int64_t> highWater_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+// 所有账户的注册表：按配置给账户定预算，宿主定期汇总并打印报告
+class MemoryBudget
+{
+public:
+    MemoryBudget() {}
+    explicit MemoryBudget(const std::string &spec) { Parse(spec); }
+
+    // 解析失败抛出 std::invalid_argument
+    void Parse(const std::string &spec);
+
+    // 同名账户只创建一次，预算取自配置；返回的指针在 MemoryBudget 析构前有效
+    MemoryAccount *Account(const std::string &name, MemoryAccount *parent = nullptr);
+
+    void Aggregate();
+
+    // 每个账户一行：当前值、高水位、预算、被拒绝的次数
+    std::string Report();
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, size_t> budgets_;
+    std::vector<std::unique_ptr<MemoryAccount>> accounts_;
+};
+
+class BudgetedDataQueue : public DataQueue
+{
+public:
+    BudgetedDataQueue(DataQueue &inner, MemoryAccount &account) : inner_(inner), account_(account) {}
+
+    virtual bool Push(ProtocolDataVar *pData)
+    {
+        if (account_.OverBudget())
+        {
+            account_.CountRejected();
+            return false;
+        }
+        size_t bytes = RecordBytes(*pData);
+        if (!inner_.Push(pData))
+            return false;
+        account_.Charge(bytes);
+        return true;
+    }
+
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max)
+    {
+        size_t n = inner_.PopBatch(out, max);
+        int64_t bytes = 0;
+        for (size_t i = 0; i < n; ++i)
+            bytes += RecordBytes(*out[i]);
+        if (bytes)
+            account_.Charge(-bytes);
+        return n;
+    }
+
+    virtual size_t Size() { return inner_.Size(); }
+
+private:
+    DataQueue &inner_;
+    MemoryAccount &account_;
+};
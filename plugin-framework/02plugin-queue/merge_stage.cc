@@ -0,0 +1,153 @@
+#include "merge_stage.h"
+
+#include <utility>
+
+MergeStage::MergeStage(const std::vector<DataQueue *> &inputs, uint64_t lateness) : lateness_(lateness)
+{
+    inputs_.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        inputs_[i].queue = inputs[i];
+        inputs_[i].buffer.resize(kBatch);
+        inputs_[i].times.resize(kBatch);
+    }
+
+    while (leaves_ < inputs_.size())
+        leaves_ <<= 1;
+    keys_.assign(leaves_, kEmpty);
+    tree_.assign(leaves_, 0);
+    Build();
+}
+
+void MergeStage::Build()
+{
+    // 自底向上比一轮：winner[node] 是该子树的胜者，败者留在 tree_[node]
+    std::vector<size_t> winner(leaves_ * 2);
+    for (size_t i = 0; i < leaves_; ++i)
+        winner[leaves_ + i] = i;
+    for (size_t node = leaves_ - 1; node >= 1; --node)
+    {
+        size_t a = winner[node * 2], b = winner[node * 2 + 1];
+        winner[node] = Less(a, b) ? a : b;
+        tree_[node] = Less(a, b) ? b : a;
+    }
+    tree_[0] = winner[1];
+}
+
+void MergeStage::Update(size_t leaf)
+{
+    // 只对刚输出过的胜者有效：沿着到根的路径和各节点保存的败者重新比一次。
+    // 时间戳是随机的，分支几乎每次都猜错，这里写成无分支的形式让编译器生成cmov
+    size_t winner = leaf;
+    uint64_t winnerKey = keys_[leaf];
+    for (size_t node = (leaf + leaves_) >> 1; node >= 1; node >>= 1)
+    {
+        size_t loser = tree_[node];
+        uint64_t loserKey = keys_[loser];
+        bool swap = (loserKey < winnerKey) | ((loserKey == winnerKey) & (loser < winner));
+        tree_[node] = swap ? winner : loser;
+        winner = swap ? loser : winner;
+        winnerKey = swap ? loserKey : winnerKey;
+    }
+    tree_[0] = winner;
+}
+
+bool MergeStage::Refill(size_t i)
+{
+    Input &input = inputs_[i];
+    input.head = 0;
+    input.count = input.queue->PopBatch(input.buffer.data(), kBatch);
+    if (input.count == 0)
+    {
+        keys_[i] = kEmpty;
+        return false;
+    }
+    if (input.closed)
+        --closedEmpty_;
+
+    for (size_t k = 0; k < input.count; ++k)
+    {
+        input.times[k] = input.buffer[k]->getTime;
+        if (input.times[k] > maxSeen_)
+            maxSeen_ = input.times[k];
+    }
+    keys_[i] = input.times[0];
+    ++nonEmpty_;
+    return true;
+}
+
+size_t MergeStage::PopBatch(ProtocolDataVar **out, size_t max)
+{
+    // 空的输入先补一次；叶子从空变成有数据相当于键变小，败者树不能局部调整，整棵重建(N很小，代价可以忽略)
+    bool refilled = false;
+    for (size_t i = 0; i < inputs_.size(); ++i)
+    {
+        if (inputs_[i].head == inputs_[i].count)
+            refilled |= Refill(i);
+    }
+    if (refilled)
+        Build();
+
+    size_t n = 0;
+    while (n < max)
+    {
+        size_t w = tree_[0];
+        uint64_t key = keys_[w];
+        if (key == kEmpty)
+            break;
+
+        // 有输入没数据时只输出等待超过 lateness 的部分，其余等下一次
+        if (!closed_ && nonEmpty_ + closedEmpty_ < inputs_.size() && (maxSeen_ < lateness_ || key > maxSeen_ - lateness_))
+            break;
+
+        Input &input = inputs_[w];
+        ProtocolDataVar *pData = input.buffer[input.head++];
+        if (key < lastEmitted_)
+        {
+            ++late_;
+            if (lateHandler_)
+                lateHandler_(pData);
+            else
+                out[n++] = pData;
+        }
+        else
+        {
+            lastEmitted_ = key;
+            out[n++] = pData;
+        }
+
+        if (input.head < input.count)
+        {
+            keys_[w] = input.times[input.head];
+        }
+        else
+        {
+            --nonEmpty_;
+            if (input.closed)
+                ++closedEmpty_;
+            Refill(w);
+        }
+        Update(w);
+    }
+
+    emitted_ += n;
+    return n;
+}
+
+void MergeStage::CloseInput(size_t i)
+{
+    Input &input = inputs_[i];
+    if (input.closed)
+        return;
+    input.closed = true;
+    if (input.head == input.count)
+        ++closedEmpty_;
+}
+
+size_t MergeStage::Size()
+{
+    size_t size = 0;
+    for (auto &input : inputs_)
+        size += input.count - input.head + input.queue->Size();
+    return size;
+}
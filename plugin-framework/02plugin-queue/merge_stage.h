@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * 多路按时间归并
+ *
+ * 多个采集插件各自一个队列，每个队列内部按 getTime 有序，但宿主轮流取各队列时，
+ * 加工插件看到的数据整体上是乱序的，按时间窗口统计就会出错。
+ *
+ * MergeStage 读N个输入队列，用败者树(tournament tree)做多路归并，对外表现为一个按 getTime 有序的 DataQueue，
+ * 宿主的消费循环直接对它 PopBatch 即可。每输出一条只需要沿树走 log2(N) 次比较。
+ *
+ * 只有当所有输入都有数据时，最小值才一定是全局最小；某个输入暂时没数据时：
+ *  - 最小值比所有输入里见过的最大时间早 lateness 以上，就不再等它，直接输出；
+ *  - 之后这个输入再来的、比已输出时间更早的数据算作迟到，计数后照常输出(或交给 SetLateHandler 设置的回调)。
+ * lateness 的单位与 getTime 相同。
+ * 输入全部结束(比如停机)后调用 Close()，之后不再等待没数据的输入，剩下的数据全部按序输出。
+ * 只有某一路结束时调用 CloseInput(i)：这一路取空后不再等它。否则其他输入的队列满了、
+ * 缓存的数据又都在 lateness 之内时，归并会一直等这一路，整条流水线卡住。
+ *
+ * 只能由一个线程调用 PopBatch。
+ */
+
+#include "PluginImpl.h"
+
+#include <functional>
+#include <vector>
+
+class MergeStage : public DataQueue
+{
+public:
+    MergeStage(const std::vector<DataQueue *> &inputs, uint64_t lateness);
+
+    // 迟到数据的处理方式，不设置时照常按到达顺序输出
+    void SetLateHandler(std::function<void(ProtocolDataVar *)> handler) { lateHandler_ = std::move(handler); }
+
+    void Close() { closed_ = true; }
+    void CloseInput(size_t i);
+
+    // 归并阶段只读不写
+    virtual bool Push(ProtocolDataVar *pData) { return false; }
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max);
+    virtual size_t Size();
+
+    uint64_t Emitted() const { return emitted_; }
+    uint64_t Late() const { return late_; }
+
+private:
+    // 每个输入在本地缓存一批数据，减少对输入队列的访问次数
+    struct Input
+    {
+        DataQueue *queue;
+        std::vector<ProtocolDataVar *> buffer;
+        std::vector<uint64_t> times; // buffer 里各条的 getTime，归并时不用再逐条解引用
+        size_t head = 0;
+        size_t count = 0;
+        bool closed = false;
+    };
+
+    static constexpr uint64_t kEmpty = ~0ULL;
+    static constexpr size_t kBatch = 64;
+
+    bool Refill(size_t i);
+    void Build();
+    void Update(size_t leaf);
+    bool Less(size_t a, size_t b) const
+    {
+        // 时间相同按输入编号，保证结果确定
+        return keys_[a] < keys_[b] || (keys_[a] == keys_[b] && a < b);
+    }
+
+    std::vector<Input> inputs_;
+    size_t leaves_ = 1;          // 叶子数，补齐到2的幂
+    std::vector<uint64_t> keys_; // 每个叶子当前队头的时间，空为 kEmpty
+    std::vector<size_t> tree_;   // tree_[0]是胜者，tree_[1..leaves_-1]是各内部节点的败者
+    size_t nonEmpty_ = 0;        // 有数据的输入个数
+    size_t closedEmpty_ = 0;     // 已经结束且取空了的输入个数，不用再等
+    uint64_t lateness_;
+    uint64_t maxSeen_ = 0;       // 所有输入里见过的最大时间
+    uint64_t lastEmitted_ = 0;
+    uint64_t emitted_ = 0;
+    uint64_t late_ = 0;
+    bool closed_ = false;
+    std::function<void(ProtocolDataVar *)> lateHandler_;
+};
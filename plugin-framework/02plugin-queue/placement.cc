@@ -0,0 +1,195 @@
+#include "placement.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// 不依赖libnuma，直接走系统调用，常量取自 <numaif.h>
+#define PLACEMENT_MPOL_PREFERRED 1
+
+static std::string ReadFirstLine(const std::string &path)
+{
+    std::ifstream ifs(path);
+    std::string line;
+    std::getline(ifs, line);
+    return line;
+}
+
+static std::string JoinCpus(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+        return "any";
+    std::ostringstream oss;
+    for (size_t i = 0; i < cpus.size(); ++i)
+        oss << (i ? "," : "") << cpus[i];
+    return oss.str();
+}
+
+namespace placement
+{
+    std::vector<int> ParseCpuList(const std::string &list)
+    {
+        std::vector<int> cpus;
+        std::istringstream iss(list);
+        std::string range;
+        while (std::getline(iss, range, ','))
+        {
+            if (range.empty())
+                continue;
+            size_t dash = range.find('-');
+            try
+            {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                if (first < 0 || last < first)
+                    throw std::invalid_argument(range);
+                for (int cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            catch (const std::logic_error &)
+            {
+                throw std::invalid_argument("bad cpu list: " + list);
+            }
+        }
+        return cpus;
+    }
+
+    int CpuCount()
+    {
+        auto cpus = ParseCpuList(ReadFirstLine("/sys/devices/system/cpu/online"));
+        if (cpus.empty())
+            return (int)sysconf(_SC_NPROCESSORS_ONLN);
+        return cpus.back() + 1;
+    }
+
+    int NodeCount()
+    {
+        auto nodes = ParseCpuList(ReadFirstLine("/sys/devices/system/node/online"));
+        return nodes.empty() ? 1 : nodes.back() + 1;
+    }
+
+    int NodeOfCpu(int cpu)
+    {
+        for (int node = 0; node < NodeCount(); ++node)
+        {
+            std::ifstream ifs("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/node" + std::to_string(node) + "/cpulist");
+            if (ifs)
+                return node;
+        }
+        return 0;
+    }
+
+    int CurrentCpu()
+    {
+        return sched_getcpu();
+    }
+
+    bool PinCurrentThread(const std::vector<int> &cpus)
+    {
+        if (cpus.empty())
+            return true;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+            CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    void *AllocOnNode(size_t bytes, int node)
+    {
+        void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc();
+
+        int nodes = NodeCount();
+        if (node >= 0 && node < nodes && nodes > 1)
+        {
+            // 只是设置策略，页面在第一次访问时才真正分配到对应节点；失败不致命，退化成默认策略
+            // 节点可能超过 64 个，掩码按节点数分配；内核只读 maxnode-1 位，所以多传 1(和 libnuma 一样)
+            const size_t bits = sizeof(unsigned long) * 8;
+            std::vector<unsigned long> mask((nodes + bits - 1) / bits, 0);
+            mask[node / bits] = 1UL << (node % bits);
+            syscall(SYS_mbind, ptr, bytes, PLACEMENT_MPOL_PREFERRED, mask.data(), mask.size() * bits + 1, 0);
+        }
+        return ptr;
+    }
+
+    void FreeOnNode(void *ptr, size_t bytes)
+    {
+        if (ptr)
+            munmap(ptr, bytes);
+    }
+}
+
+void PlacementConfig::Parse(const std::string &spec)
+{
+    std::istringstream iss(spec);
+    std::string item;
+    while (std::getline(iss, item, ';'))
+    {
+        if (item.empty())
+            continue;
+
+        size_t eq = item.find('=');
+        if (eq == std::string::npos || eq == 0)
+            throw std::invalid_argument("bad placement: " + item);
+
+        std::string stage = item.substr(0, eq);
+        std::string cpus = item.substr(eq + 1);
+        StagePlacement placement;
+
+        size_t at = cpus.find('@');
+        if (at != std::string::npos)
+        {
+            try
+            {
+                placement.node = std::stoi(cpus.substr(at + 1));
+            }
+            catch (const std::logic_error &)
+            {
+                throw std::invalid_argument("bad placement node: " + item);
+            }
+            cpus = cpus.substr(0, at);
+        }
+
+        placement.cpus = placement::ParseCpuList(cpus);
+        if (placement.node < 0 && !placement.cpus.empty())
+            placement.node = placement::NodeOfCpu(placement.cpus.front());
+
+        stages_[stage] = placement;
+    }
+}
+
+StagePlacement PlacementConfig::Get(const std::string &stage) const
+{
+    auto it = stages_.find(stage);
+    return it == stages_.end() ? StagePlacement() : it->second;
+}
+
+std::string PlacementConfig::Report() const
+{
+    std::ostringstream oss;
+    int nodes = placement::NodeCount();
+    oss << "topology: " << placement::CpuCount() << " cpus, " << nodes << " numa nodes" << std::endl;
+    for (int node = 0; node < nodes; ++node)
+    {
+        std::string cpulist = ReadFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        oss << "  node" << node << ": cpus " << (cpulist.empty() ? "?" : cpulist) << std::endl;
+    }
+
+    if (stages_.empty())
+        oss << "placement: none, all stages float" << std::endl;
+    for (auto &stage : stages_)
+    {
+        oss << "  " << stage.first << " => cpus " << JoinCpus(stage.second.cpus)
+            << ", memory node " << stage.second.node << std::endl;
+    }
+    return oss.str();
+}
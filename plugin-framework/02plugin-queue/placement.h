@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * 流水线线程的CPU亲和性与NUMA内存摆放
+ *
+ * 默认情况下采集线程、main.cc里的消费循环都由内核随意调度，同一个队列的生产者和消费者
+ * 经常落在不同的物理CPU(甚至不同的socket)上，队列的cache line来回在核间搬运。
+ *
+ * 配置格式(分号分隔，每段一个阶段):
+ *      stage=cpulist[@node]
+ *  例: "collector=2;main=3;processor=3"   "collector=0-3,8@0"
+ *  cpulist 与 /sys/devices/system/cpu/online 的格式一致，node 省略时取第一个CPU所在的节点。
+ */
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+struct StagePlacement
+{
+    std::vector<int> cpus; // 绑定的CPU列表，空表示不绑定
+    int node = -1;         // 该阶段队列/记录池所在的NUMA节点，-1表示不指定
+};
+
+class PlacementConfig
+{
+public:
+    PlacementConfig() {}
+    explicit PlacementConfig(const std::string &spec) { Parse(spec); }
+
+    // 解析失败抛出 std::invalid_argument
+    void Parse(const std::string &spec);
+
+    // 未配置的阶段返回空的 StagePlacement
+    StagePlacement Get(const std::string &stage) const;
+
+    // 打印机器拓扑以及每个阶段实际的摆放结果，启动时调用
+    std::string Report() const;
+
+private:
+    std::map<std::string, StagePlacement> stages_;
+};
+
+namespace placement
+{
+    // "0-3,8" => {0,1,2,3,8}
+    std::vector<int> ParseCpuList(const std::string &list);
+
+    int CpuCount();
+    int NodeCount();
+    // 读取 /sys/devices/system/cpu/cpuN/nodeX，拿不到时返回0
+    int NodeOfCpu(int cpu);
+    // 当前线程正在运行的CPU
+    int CurrentCpu();
+
+    // 把当前线程绑定到cpus上，cpus为空时什么也不做
+    bool PinCurrentThread(const std::vector<int> &cpus);
+
+    /*
+     * 在指定NUMA节点上分配内存(mmap + mbind)，node<0时退化成普通的匿名映射。
+     * 用 MPOL_PREFERRED 而不是 MPOL_BIND，节点内存不足时允许回退到别的节点而不是直接失败。
+     * 返回的内存按页对齐并已清零，必须用 FreeOnNode 释放。
+     */
+    void *AllocOnNode(size_t bytes, int node);
+    void FreeOnNode(void *ptr, size_t bytes);
+}
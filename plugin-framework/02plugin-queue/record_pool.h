@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * ProtocolDataVar 记录池
+ *
+ * 记录对象整块分配在采集阶段所在的NUMA节点上，采集线程 Acquire，消费线程用完后 Release 回来。
+ * 回收的记录保留 std::string 已有的容量，稳定运行后不再有堆分配。
+ * 空闲链表本身就是一个 SpscQueue：Release 的一方是生产者，Acquire 的一方是消费者，
+ * 所以同一时刻只能有一个线程 Acquire、一个线程 Release。
+ * 例外是 Acquire 所在的线程自己归还(比如 SpillDataQueue 写盘后交还记录)：这种记录放进本地缓存，
+ * 不碰空闲链表，下次 Acquire 优先取用。
+ */
+
+#include "PluginImpl.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+class RecordPool
+{
+public:
+    RecordPool(size_t capacity, int node = -1) : free_(capacity, node)
+    {
+        capacity_ = free_.Capacity();
+        bytes_ = capacity_ * sizeof(ProtocolDataVar);
+        slab_ = static_cast<ProtocolDataVar *>(placement::AllocOnNode(bytes_, node));
+        for (size_t i = 0; i < capacity_; ++i)
+            free_.TryPush(new (slab_ + i) ProtocolDataVar());
+        local_.reserve(capacity_);
+    }
+
+    ~RecordPool()
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+            slab_[i].~ProtocolDataVar();
+        placement::FreeOnNode(slab_, bytes_);
+    }
+
+    RecordPool(const RecordPool &) = delete;
+    RecordPool &operator=(const RecordPool &) = delete;
+
+    // 池子用完时退化成 new，Release 时根据地址区分
+    ProtocolDataVar *Acquire()
+    {
+        std::thread::id self = std::this_thread::get_id();
+        if (acquirer_.load(std::memory_order_relaxed) != self)
+            acquirer_.store(self, std::memory_order_relaxed);
+
+        ProtocolDataVar *pData = nullptr;
+        if (!local_.empty())
+        {
+            pData = local_.back();
+            local_.pop_back();
+            return pData;
+        }
+        if (free_.TryPop(pData))
+            return pData;
+        return new ProtocolDataVar();
+    }
+
+    void Release(ProtocolDataVar *pData)
+    {
+        if (!Owns(pData))
+            delete pData;
+        else if (acquirer_.load(std::memory_order_relaxed) == std::this_thread::get_id())
+            local_.push_back(pData);
+        else
+            free_.TryPush(pData);
+    }
+
+    bool Owns(const ProtocolDataVar *pData) const { return pData >= slab_ && pData < slab_ + capacity_; }
+
+private:
+    SpscQueue<ProtocolDataVar *> free_;
+    std::vector<ProtocolDataVar *> local_; // 只有 Acquire 的线程访问
+    std::atomic<std::thread::id> acquirer_{};
+    ProtocolDataVar *slab_ = nullptr;
+    size_t capacity_ = 0;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,583 @@
+/**
+ * 流水线回放测试
+ *
+ * 用法: ./pipeline-replay [profile] [records] [sources] [seed] [speed] [processor.so]
+ *  profile     steady(等间隔) / bursty(成批同时到达，批间空闲) / skewed(序列名按Zipf分布，各路速率相差数倍)，默认 steady；
+ *              plugin 表示不用合成负载，加载真实的采集插件 ./libcollector.so，给它一个虚拟时钟
+ *  records     产生的总条数，默认 1000000
+ *  sources     合成负载的数据源路数，默认 4；各路由同一个采集插件按虚拟到达时刻交错产生
+ *  seed        负载模型的随机种子，默认 1
+ *  speed       0 表示不管虚拟时间、全速回放(默认)；k>0 表示虚拟时间按真实时间的k倍推进，能看出突发对延迟的影响
+ *  processor.so 可选，加载加工插件，每条数据调用一次 ProcessData
+ * sources/seed/speed 只对合成负载有效。
+ *
+ * 宿主部分就是 plugin-queue 的 HostPipeline(host_pipeline.h)：同样的队列(RingDataQueue，或者 PLUGIN_SPILL_DIR 时的
+ * SpillDataQueue，外面套 BudgetedDataQueue)，同样的消费循环(AdaptiveBatcher 定批大小，PLUGIN_FILTER 过滤，
+ * 加工插件，LatestValueTable)，环境变量的含义也相同。和宿主一样只有一个采集插件、一个单生产者队列。
+ * 回放只在两头套上探针：采集插件 Push 时按顺序记下真实时刻，消费循环按同样的顺序还回记录时算出延迟；
+ * 交给加工插件的记录按处理顺序算校验和。
+ *
+ * 采集插件用 VirtualClock，按负载模型 SleepUntil 下一条的到达时刻，数据的时间戳和内容只取决于 profile 和 seed；
+ * 真实插件每虚拟秒产生一条，时钟推进到 records 秒后停住，插件恰好产生 records 条。
+ * 结果以JSON输出到标准输出：吞吐、延迟分布(从 Push 到消费循环还回记录的真实时间)、运行期间的堆分配次数，
+ * 以及校验和，同一 profile/seed 下校验和必须不变(被过滤的记录不计入，条数在 filtered 里)。
+ * 例如 PLUGIN_FILTER="drop: value >= 90; default: keep" 大约过滤掉一成。
+ */
+
+#include "PluginImplWrapper.h"
+#include "clock.h"
+#include "host_pipeline.h"
+#include "placement.h"
+#include "record_pool.h"
+#include "spill_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// 统计回放期间的堆分配，只在 AllocCountScope 存在期间计数
+// ASan 构建(仓库默认)不能替换全局的 operator new/delete，否则 ASan 看不到这些分配，也查不出 new/delete 不配对；
+// 这时用 ASan 提供的分配钩子，钩子只通知、不接管分配。没有 ASan 时才替换 operator new/delete。
+static std::atomic<bool> g_allocCounting(false);
+static std::atomic<uint64_t> g_allocCount(0);
+static std::atomic<uint64_t> g_allocBytes(0);
+
+static void CountAlloc(size_t size)
+{
+    if (!g_allocCounting.load(std::memory_order_relaxed))
+        return;
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#if defined(__SANITIZE_ADDRESS__)
+extern "C" int __sanitizer_install_malloc_and_free_hooks(void (*malloc_hook)(const volatile void *, size_t),
+                                                         void (*free_hook)(const volatile void *));
+
+static void InstallAllocHook()
+{
+    // ASan 最多允许装几个钩子，只装一次
+    static const int installed = __sanitizer_install_malloc_and_free_hooks(
+        [](const volatile void *, size_t size) { CountAlloc(size); }, [](const volatile void *) {});
+    (void)installed;
+}
+#else
+static void InstallAllocHook() {}
+
+void *operator new(size_t size)
+{
+    CountAlloc(size);
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+// 不让 delete 内联进调用方，否则 GCC 在调用方看到 new 出来的指针被 free，报 -Wmismatched-new-delete
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+#endif
+
+// 计数的范围：构造时开始，析构时停止，Count/Bytes 是范围内的分配次数和字节数
+class AllocCountScope
+{
+public:
+    AllocCountScope() : count_(g_allocCount), bytes_(g_allocBytes)
+    {
+        InstallAllocHook();
+        g_allocCounting = true;
+    }
+    ~AllocCountScope() { g_allocCounting = false; }
+
+    uint64_t Count() const { return g_allocCount - count_; }
+    uint64_t Bytes() const { return g_allocBytes - bytes_; }
+
+private:
+    uint64_t count_;
+    uint64_t bytes_;
+};
+
+static uint64_t SteadyNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 负载模型：给出下一条的虚拟到达时刻和序列编号
+class LoadProfile
+{
+public:
+    static constexpr uint32_t kSeries = 1024;
+
+    LoadProfile(const std::string &name, uint64_t seed, uint32_t index) : rng_(seed * 1000003 + index)
+    {
+        if (name == "steady")
+        {
+            interval_ = Clock::kSecond / kRate;
+        }
+        else if (name == "bursty")
+        {
+            // 平均速率与 steady 相同，但每 kBurst 条同时到达
+            interval_ = Clock::kSecond / kRate;
+            burst_ = kBurst;
+        }
+        else if (name == "skewed")
+        {
+            // 第i路速率是第0路的 1/(i+1)，序列名按 Zipf(1.2) 分布
+            interval_ = Clock::kSecond / kRate * (index + 1);
+            double sum = 0;
+            for (uint32_t k = 0; k < kSeries; ++k)
+            {
+                sum += 1.0 / std::pow(k + 1, 1.2);
+                cdf_.push_back(sum);
+            }
+            for (auto &c : cdf_)
+                c /= sum;
+        }
+        else
+        {
+            throw std::invalid_argument("unknown load profile: " + name);
+        }
+    }
+
+    uint64_t NextArrival()
+    {
+        if (burst_ == 0 || ++inBurst_ == burst_)
+        {
+            inBurst_ = 0;
+            now_ += interval_ * (burst_ ? burst_ : 1);
+        }
+        return now_;
+    }
+
+    uint32_t NextSeries()
+    {
+        if (cdf_.empty())
+            return rng_() % kSeries;
+        double u = std::uniform_real_distribution<double>(0, 1)(rng_);
+        return (uint32_t)(std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    }
+
+    double NextValue() { return std::uniform_real_distribution<double>(0, 100)(rng_); }
+
+private:
+    static constexpr uint64_t kRate = 100000; // 每路每秒条数(虚拟时间)
+    static constexpr uint32_t kBurst = 256;
+
+    std::mt19937_64 rng_;
+    std::vector<double> cdf_;
+    uint64_t interval_ = 0;
+    uint32_t burst_ = 0;
+    uint32_t inBurst_ = 0;
+    uint64_t now_ = 0;
+};
+
+// 对数分桶的延迟直方图：每个2的幂区间再分8格，相对误差不超过12.5%
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : buckets_(64 * kSub, 0) {}
+
+    void Record(uint64_t ns)
+    {
+        ++buckets_[Index(ns)];
+        ++count_;
+        sum_ += ns;
+        if (ns > max_)
+            max_ = ns;
+        if (ns < min_)
+            min_ = ns;
+    }
+
+    uint64_t Percentile(double p) const
+    {
+        uint64_t rank = (uint64_t)std::ceil(p * count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets_.size(); ++i)
+        {
+            seen += buckets_[i];
+            if (seen >= rank && seen > 0)
+                return std::min(Upper(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t Count() const { return count_; }
+    uint64_t Min() const { return count_ ? min_ : 0; }
+    uint64_t Max() const { return max_; }
+    double Mean() const { return count_ ? (double)sum_ / count_ : 0; }
+
+private:
+    static constexpr int kSub = 8;
+
+    static size_t Index(uint64_t v)
+    {
+        if (v < kSub)
+            return v;
+        int e = 63 - __builtin_clzll(v);
+        return e * kSub + ((v >> (e - 3)) & (kSub - 1));
+    }
+
+    // 桶内的最大值
+    static uint64_t Upper(size_t i)
+    {
+        if (i < kSub)
+            return i;
+        int e = (int)(i / kSub);
+        uint64_t sub = i % kSub;
+        return ((kSub + sub + 1) << (e - 3)) - 1;
+    }
+
+    std::vector<uint64_t> buckets_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+    uint64_t min_ = ~0ULL;
+};
+
+static uint64_t Fnv(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    return hash;
+}
+
+// 按负载模型产生数据的采集插件，接口与 collector.cc 相同，只是时间全部来自宿主给的时钟。
+// 宿主的队列只有一个生产者，所以多路数据源由同一个采集线程产生：每次取到达时刻最早的一路(同时到达时编号小的在前)
+class ReplayCollector : public PluginImpl
+{
+public:
+    ReplayCollector(const std::string &profile, uint64_t seed, uint32_t sources, uint64_t records, double speed)
+        : records_(records), speed_(speed), pool_(kPoolSize)
+    {
+        for (uint32_t i = 0; i < sources; ++i)
+            profiles_.emplace_back(profile, seed, i);
+        for (uint32_t k = 0; k < LoadProfile::kSeries; ++k)
+            names_.push_back("series-" + std::to_string(k));
+    }
+
+    virtual const char *Name() { return "ReplayCollector"; }
+
+    virtual void SetClock(Clock *pClock) { clock_ = pClock; }
+    virtual void SetDataQueue(DataQueue *pQueue) { pQueue_ = pQueue; }
+
+    virtual bool Start()
+    {
+        thread_ = std::thread([this]() {
+            std::vector<uint64_t> next;
+            for (auto &profile : profiles_)
+                next.push_back(profile.NextArrival());
+
+            uint64_t wallStart = SteadyNow();
+            for (uint64_t i = 0; i < records_; ++i)
+            {
+                size_t k = std::min_element(next.begin(), next.end()) - next.begin();
+                clock_->SleepUntil(next[k]);
+                // 按比例回放时等真实时间追上虚拟时间
+                while (speed_ > 0 && SteadyNow() - wallStart < clock_->Now() / speed_)
+                    std::this_thread::yield();
+
+                ProtocolDataVar *pData = pool_.Acquire();
+                pData->name = names_[profiles_[k].NextSeries()];
+                pData->unit = "unit";
+                pData->group = "replay";
+                pData->source = "replay";
+                pData->getTime = clock_->Now();
+                pData->value = profiles_[k].NextValue();
+                while (!pQueue_->Push(pData))
+                    std::this_thread::yield();
+                next[k] = profiles_[k].NextArrival();
+            }
+        });
+        return true;
+    }
+
+    virtual bool Stop()
+    {
+        if (thread_.joinable())
+            thread_.join();
+        return true;
+    }
+
+    // 溢出写盘读回来的副本不是池子里的，RecordPool 会 delete 掉
+    virtual int ReleaseData(ProtocolDataVar *pData)
+    {
+        pool_.Release(pData);
+        return 0;
+    }
+
+private:
+    // 池子比队列大，队列满时采集线程等在 Push 上而不是等在池子上
+    static constexpr size_t kPoolSize = 8192;
+
+    std::vector<LoadProfile> profiles_;
+    uint64_t records_;
+    double speed_;
+    Clock *clock_ = SystemClock::Instance();
+    DataQueue *pQueue_ = nullptr;
+    std::vector<std::string> names_;
+    RecordPool pool_;
+    std::thread thread_;
+};
+
+// 给真实采集插件用的虚拟时钟：推进到 limit 为止，再往后的 SleepUntil 一直等到 Open()。
+// collector.cc 每虚拟秒产生一条，limit 设成 records 秒，插件就恰好产生 records 条，回放结束后 Open 再让它停下来
+class StopClock : public VirtualClock
+{
+public:
+    explicit StopClock(uint64_t limit) : limit_(limit) {}
+
+    virtual void SleepUntil(uint64_t deadline)
+    {
+        if (deadline > limit_)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            opened_.wait(lock, [this]() { return open_; });
+        }
+        VirtualClock::SleepUntil(deadline);
+    }
+
+    void Open()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_ = true;
+        opened_.notify_all();
+    }
+
+private:
+    uint64_t limit_;
+    std::mutex mutex_;
+    std::condition_variable opened_;
+    bool open_ = false;
+};
+
+// 采集插件看到的队列：Push 之前按顺序记下真实时刻，再交给宿主的队列。只有采集线程调用 Push
+class StampedQueue : public DataQueue
+{
+public:
+    StampedQueue(DataQueue &inner, std::vector<uint64_t> &stamps) : inner_(inner), stamps_(stamps) {}
+
+    virtual bool Push(ProtocolDataVar *pData)
+    {
+        // 先写时刻再 Push：Push 成功后消费线程随时可能还回来
+        if (pushed_ < stamps_.size())
+            stamps_[pushed_] = SteadyNow();
+        if (!inner_.Push(pData))
+            return false;
+        ++pushed_;
+        return true;
+    }
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max) { return inner_.PopBatch(out, max); }
+    virtual size_t Size() { return inner_.Size(); }
+
+private:
+    DataQueue &inner_;
+    std::vector<uint64_t> &stamps_;
+    uint64_t pushed_ = 0;
+};
+
+/*
+ * 宿主看到的采集插件：消费线程还回来的记录按顺序对上 Push 的时刻，记下延迟后再还给真正的插件。
+ * 宿主的队列先进先出，消费线程第k次还回来的就是第k条 Push 成功的记录；写过盘的记录还回来的是读回的副本，顺序不变，
+ * 原记录在采集线程上提前还回来，不计延迟。
+ */
+class ReleaseProbe : public PluginImpl
+{
+public:
+    ReleaseProbe(PluginImpl *inner, const std::vector<uint64_t> &stamps, LatencyHistogram &latency)
+        : inner_(inner), stamps_(stamps), latency_(latency), consumer_(std::this_thread::get_id())
+    {
+    }
+
+    virtual const char *Name() { return inner_->Name(); }
+
+    virtual int ReleaseData(ProtocolDataVar *pData)
+    {
+        if (measuring_ && std::this_thread::get_id() == consumer_)
+        {
+            if (released_ < stamps_.size())
+                latency_.Record(SteadyNow() - stamps_[released_]);
+            ++released_;
+        }
+        return inner_->ReleaseData(pData);
+    }
+
+    // 消费线程还回来的条数
+    uint64_t Released() const { return released_; }
+    // 回放结束，之后宿主 Drain 还回来的记录不再计数
+    void StopMeasuring() { measuring_ = false; }
+
+private:
+    PluginImpl *inner_;
+    const std::vector<uint64_t> &stamps_;
+    LatencyHistogram &latency_;
+    std::thread::id consumer_;
+    bool measuring_ = true;
+    uint64_t released_ = 0;
+};
+
+// 宿主看到的加工插件：按处理顺序算校验和，再交给真正的加工插件(可选)
+class ChecksumProcessor : public PluginImpl
+{
+public:
+    explicit ChecksumProcessor(PluginImpl *inner) : inner_(inner) {}
+
+    virtual const char *Name() { return "ChecksumProcessor"; }
+
+    virtual int ProcessData(ProtocolDataVar *pData)
+    {
+        hash_ = Fnv(hash_, &pData->getTime, sizeof(pData->getTime));
+        hash_ = Fnv(hash_, &pData->value, sizeof(pData->value));
+        hash_ = Fnv(hash_, pData->name.data(), pData->name.size());
+        return inner_ ? inner_->ProcessData(pData) : 0;
+    }
+
+    uint64_t Checksum() const { return hash_; }
+
+private:
+    PluginImpl *inner_;
+    uint64_t hash_ = 14695981039346656037ULL;
+};
+
+int main(int argc, char *argv[])
+{
+    std::string profile = argc > 1 ? argv[1] : "steady";
+    uint64_t records = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    uint32_t sources = argc > 3 ? atoi(argv[3]) : 4;
+    uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1;
+    double speed = argc > 5 ? atof(argv[5]) : 0;
+    const char *processorPath = argc > 6 ? argv[6] : nullptr;
+    if (sources == 0)
+        sources = 1;
+
+    std::unique_ptr<PluginImplWrapper<PluginImpl>> processor;
+    if (processorPath)
+    {
+        processor.reset(new PluginImplWrapper<PluginImpl>(processorPath, "Instance"));
+        if (!*processor)
+            return 1;
+    }
+
+    // 采集插件：真实插件配一个到点停住的虚拟时钟，合成负载配普通的虚拟时钟
+    std::unique_ptr<PluginImplWrapper<PluginImpl>> plugin;
+    std::unique_ptr<ReplayCollector> replay;
+    std::unique_ptr<VirtualClock> clock;
+    StopClock *stopClock = nullptr;
+    PluginImpl *collector = nullptr;
+    if (profile == "plugin")
+    {
+        plugin.reset(new PluginImplWrapper<PluginImpl>("./libcollector.so", "Instance"));
+        if (!*plugin)
+            return 1;
+        stopClock = new StopClock(records * Clock::kSecond);
+        clock.reset(stopClock);
+        collector = plugin->get();
+    }
+    else
+    {
+        try
+        {
+            replay.reset(new ReplayCollector(profile, seed, sources, records, speed));
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        clock.reset(new VirtualClock());
+        collector = replay.get();
+    }
+    collector->SetClock(clock.get());
+
+    // Push 时刻按顺序存下来，留出真实插件停下来时多放的那几条
+    std::vector<uint64_t> stamps(records + 1024);
+    LatencyHistogram latency;
+    ReleaseProbe probe(collector, stamps, latency);
+    ChecksumProcessor checksum(processor ? processor->get() : nullptr);
+
+    std::unique_ptr<HostPipeline> pipeline;
+    try
+    {
+        pipeline.reset(new HostPipeline(&probe, &checksum));
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::system_error &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    StampedQueue input(*pipeline->Queue(), stamps);
+    collector->SetDataQueue(&input);
+
+    // 序列名提前 intern，运行期间统计到的分配只来自流水线本身
+    for (uint32_t k = 0; k < LoadProfile::kSeries; ++k)
+        pipeline->Latest().Interner().Intern("replay/series-" + std::to_string(k));
+    pipeline->Latest().Interner().Intern("group/time");
+
+    SpillDataQueue *spill = pipeline->Spill();
+    std::optional<AllocCountScope> allocs;
+    allocs.emplace();
+    auto start = std::chrono::steady_clock::now();
+    collector->Start();
+
+    // 段文件损坏丢掉的记录不会再还回来
+    while (probe.Released() + (spill ? spill->Lost() : 0) < records)
+        pipeline->RunOnce();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocCount = allocs->Count(), allocBytes = allocs->Bytes();
+    allocs.reset();
+    probe.StopMeasuring();
+    uint64_t virtualEnd = clock->Now();
+    if (stopClock)
+        stopClock->Open();
+    collector->Stop();
+    pipeline->Drain();
+
+    uint64_t received = probe.Released();
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)checksum.Checksum());
+    std::cout << "{\n"
+              << "  \"profile\": \"" << profile << "\",\n"
+              << "  \"records\": " << received << ",\n"
+              << "  \"sources\": " << (plugin ? 1 : sources) << ",\n"
+              << "  \"seed\": " << seed << ",\n"
+              << "  \"speed\": " << speed << ",\n"
+              << "  \"processor\": " << (processorPath ? "\"" + std::string(processorPath) + "\"" : "null") << ",\n"
+              << "  \"spill\": " << (spill ? "true" : "false") << ",\n"
+              << "  \"filtered\": " << pipeline->Filtered() << ",\n"
+              << "  \"spilled\": " << (spill ? spill->Spilled() : 0) << ",\n"
+              << "  \"lost\": " << (spill ? spill->Lost() : 0) << ",\n"
+              << "  \"batch_size\": " << pipeline->Batcher().BatchSize() << ",\n"
+              << "  \"wall_seconds\": " << elapsed.count() << ",\n"
+              << "  \"virtual_seconds\": " << (double)virtualEnd / Clock::kSecond << ",\n"
+              << "  \"throughput_per_second\": " << received / elapsed.count() << ",\n"
+              << "  \"latency_ns\": {\"min\": " << latency.Min() << ", \"mean\": " << latency.Mean()
+              << ", \"p50\": " << latency.Percentile(0.5) << ", \"p90\": " << latency.Percentile(0.9)
+              << ", \"p99\": " << latency.Percentile(0.99) << ", \"p999\": " << latency.Percentile(0.999)
+              << ", \"max\": " << latency.Max() << "},\n"
+              << "  \"allocations\": {\"count\": " << allocCount << ", \"bytes\": " << allocBytes
+              << ", \"per_record\": " << (double)allocCount / received << "},\n"
+              << "  \"checksum\": \"" << hex << "\"\n"
+              << "}" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,406 @@
+#include "socket_sink.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+extern "C" void *Instance() { return new SocketSink; }
+
+static uint64_t MonotonicNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SocketSink::~SocketSink()
+{
+    Stop();
+}
+
+const char *SocketSink::Name()
+{
+    return "SocketSink";
+}
+
+bool SocketSink::SetHardwareParam(void *pHardwareConfig)
+{
+    if (!pHardwareConfig)
+        return false;
+
+    std::string param = static_cast<const char *>(pHardwareConfig);
+    size_t begin = 0;
+    for (int i = 0; begin <= param.size(); ++i)
+    {
+        size_t end = param.find(';', begin);
+        if (end == std::string::npos)
+            end = param.size();
+        std::string item = param.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (i == 0)
+        {
+            path_ = item;
+            continue;
+        }
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        long long value = eq == std::string::npos ? 0 : atoll(item.c_str() + eq + 1);
+        if (key == "batch" && value > 0)
+            batchBytes_ = value;
+        else if (key == "deadline_us" && value > 0)
+            deadline_ = value * 1000;
+        else
+        {
+            std::cout << "SocketSink: bad parameter '" << item << "'" << std::endl;
+            return false;
+        }
+    }
+    return !path_.empty();
+}
+
+void SocketSink::SetEventLoop(EventLoop *pLoop)
+{
+    pLoop_ = pLoop;
+}
+
+// 调用者持有 mutex_
+bool SocketSink::Connect()
+{
+    int fd;
+    if (path_.compare(0, 3, "fd:") == 0)
+    {
+        fd = fcntl(atoi(path_.c_str() + 3), F_DUPFD_CLOEXEC, 0);
+    }
+    else
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path_.size() >= sizeof(addr.sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        memcpy(addr.sun_path, path_.c_str(), path_.size());
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            int err = errno;
+            close(fd);
+            errno = err;
+            return false;
+        }
+    }
+    if (fd < 0)
+        return false;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    // 平时只关注可读：汇聚进程不发数据，可读就是对端关闭或出错
+    if (!pLoop_->Add(fd, EPOLLIN, [this](int, uint32_t events) { OnSocket(events); }))
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return false;
+    }
+
+    fd_ = fd;
+    sentOffset_ = 0;
+    waitWritable_ = false;
+    return true;
+}
+
+bool SocketSink::Start()
+{
+    if (!pLoop_ || path_.empty())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writer_.reset(new wire::BatchWriter);
+        if (!Connect())
+        {
+            std::cout << "SocketSink: connect " << path_ << " failed: " << strerror(errno) << std::endl;
+            writer_.reset();
+            return false;
+        }
+    }
+
+    // 定时器周期取 deadline 的一半，一批最多等 1.5 倍 deadline
+    timerfd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    uint64_t period = deadline_ / 2 > 100000 ? deadline_ / 2 : 100000;
+    itimerspec spec{};
+    spec.it_interval.tv_sec = period / 1000000000;
+    spec.it_interval.tv_nsec = period % 1000000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_ < 0 || timerfd_settime(timerfd_, 0, &spec, nullptr) < 0 ||
+        !pLoop_->Add(timerfd_, EPOLLIN, [this](int, uint32_t) { OnTimer(); }))
+    {
+        std::cout << "SocketSink: timer failed: " << strerror(errno) << std::endl;
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+bool SocketSink::Stop()
+{
+    if (!writer_)
+        return true;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (writer_->Count())
+            Seal();
+        if (fd_ >= 0 && !broken_ && !waitWritable_)
+            TryWrite();
+    }
+
+    // 剩下的交给事件循环发，最多等1秒
+    for (int i = 0; i < 1000; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (sealed_.empty() || fd_ < 0 || broken_)
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (timerfd_ >= 0)
+    {
+        pLoop_->Remove(timerfd_);
+        close(timerfd_);
+        timerfd_ = -1;
+    }
+
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fd = fd_;
+        fd_ = -1;
+    }
+    if (fd >= 0)
+    {
+        pLoop_->Remove(fd);
+        close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &batch : sealed_)
+        dropped_ += batch->Count();
+    sealed_.clear();
+    spare_.clear();
+    pendingBytes_ = 0;
+    writer_.reset();
+
+    std::cout << "SocketSink: sent " << sent_ << " records in " << batches_ << " batches, " << syscalls_
+              << " syscalls, dropped " << dropped_ << std::endl;
+    return true;
+}
+
+int SocketSink::ProcessData(ProtocolDataVar *pData)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!writer_ || pendingBytes_ + writer_->Size() >= kMaxPendingBytes)
+    {
+        ++dropped_;
+        return -1;
+    }
+
+    if (writer_->Count() == 0)
+        openedAt_ = MonotonicNow();
+    try
+    {
+        writer_->Add(*pData);
+    }
+    catch (const std::length_error &)
+    {
+        ++dropped_;
+        return -1;
+    }
+
+    if (writer_->Size() >= batchBytes_)
+    {
+        Seal();
+        if (fd_ >= 0 && !broken_ && !waitWritable_)
+            TryWrite();
+    }
+    return 0;
+}
+
+// 以下几个函数调用者都持有 mutex_
+void SocketSink::Seal()
+{
+    writer_->Finish();
+    pendingBytes_ += writer_->Size();
+    sealed_.push_back(std::move(writer_));
+    ++batches_;
+
+    if (!spare_.empty())
+    {
+        writer_ = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    else
+    {
+        writer_.reset(new wire::BatchWriter);
+    }
+}
+
+void SocketSink::TryWrite()
+{
+    while (!sealed_.empty())
+    {
+        iovec iov[kMaxIov];
+        int n = 0;
+        size_t want = 0;
+        for (auto it = sealed_.begin(); it != sealed_.end() && n < kMaxIov; ++it, ++n)
+        {
+            size_t skip = n == 0 ? sentOffset_ : 0;
+            iov[n].iov_base = const_cast<char *>((*it)->Data() + skip);
+            iov[n].iov_len = (*it)->Size() - skip;
+            want += iov[n].iov_len;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t ret = sendmsg(fd_, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        ++syscalls_;
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            // 对端没收全的半批在新连接上整批重发
+            broken_ = true;
+            sentOffset_ = 0;
+            return;
+        }
+
+        // 发出的字节从队头依次扣掉，发完的批留着复用
+        size_t done = ret;
+        while (done > 0)
+        {
+            std::unique_ptr<wire::BatchWriter> &front = sealed_.front();
+            size_t left = front->Size() - sentOffset_;
+            if (done < left)
+            {
+                sentOffset_ += done;
+                break;
+            }
+            done -= left;
+            sentOffset_ = 0;
+            pendingBytes_ -= front->Size();
+            sent_ += front->Count();
+            front->Reset();
+            spare_.push_back(std::move(front));
+            sealed_.pop_front();
+        }
+
+        if ((size_t)ret < want)
+            break;
+    }
+
+    if (!sealed_.empty())
+    {
+        // socket 写满了，等可写通知
+        ++shortWrites_;
+        if (!waitWritable_)
+        {
+            waitWritable_ = true;
+            pLoop_->Modify(fd_, EPOLLIN | EPOLLOUT);
+        }
+    }
+    else if (waitWritable_)
+    {
+        waitWritable_ = false;
+        pLoop_->Modify(fd_, EPOLLIN);
+    }
+}
+
+void SocketSink::OnSocket(uint32_t events)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0)
+        return;
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+        char buf[256];
+        while (true)
+        {
+            ssize_t n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0 || (n < 0 && errno == EINTR))
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            broken_ = true;
+            sentOffset_ = 0;
+            break;
+        }
+    }
+
+    if ((events & EPOLLOUT) && !broken_)
+    {
+        waitWritable_ = false;
+        TryWrite();
+    }
+
+    // 在自己的回调里 Remove 不用等待，直接关掉；排队的数据等重连
+    if (broken_)
+    {
+        pLoop_->Remove(fd_);
+        close(fd_);
+        fd_ = -1;
+        broken_ = false;
+        waitWritable_ = false;
+    }
+}
+
+void SocketSink::OnTimer()
+{
+    uint64_t ticks;
+    ssize_t ret = read(timerfd_, &ticks, sizeof(ticks));
+    (void)ret;
+
+    // ProcessData 里发现的断连在这里清理；Remove 会等 socket 的回调结束，不能拿着锁调用
+    int stale = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (broken_)
+        {
+            stale = fd_;
+            fd_ = -1;
+            broken_ = false;
+            waitWritable_ = false;
+        }
+    }
+    if (stale >= 0)
+    {
+        pLoop_->Remove(stale);
+        close(stale);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!writer_)
+        return;
+    if (fd_ < 0 && path_.compare(0, 3, "fd:") != 0)
+        Connect();
+
+    if (writer_->Count() && MonotonicNow() - openedAt_ >= deadline_)
+        Seal();
+    if (fd_ >= 0 && !waitWritable_ && !sealed_.empty())
+        TryWrite();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "PluginImpl.h"
+#include "event_loop.h"
+#include "wire_format.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * 输出类插件：把处理完的数据通过 Unix domain socket 转发给本机的汇聚进程
+ *
+ * SetHardwareParam 传入 const char * 参数，格式为 "路径[;batch=字节数][;deadline_us=微秒]"，
+ * 路径也可以是 "fd:N"，表示接管宿主已经连好的socket(插件内部会dup一份)。
+ *
+ * ProcessData 只把数据编码进当前批(wire_format.h 的格式，接收方按批头里的长度切分)，不做系统调用，
+ * 批攒到 batch 字节(默认64KB)或者最早一条等了 deadline_us(默认2ms)就封口。
+ * 封口的批排队，一次 sendmsg 把排队的所有批用 iovec 一起发出去(效果同 writev，另外带 MSG_NOSIGNAL)。
+ * socket 写满时只发出一部分，剩下的等宿主事件循环通知可写再接着发，流水线不会阻塞；
+ * 排队超过 kMaxPendingBytes 后新数据直接丢弃并计数。
+ * 连接断开后，排队的数据保留，按路径连接的每个定时周期重连一次，重连后从半批处重新整批发送。
+ * 批的缓冲区发完后留着复用，稳定运行后不再分配内存。
+ *
+ * 必须 SetEventLoop：可写通知和定时封口都挂在宿主的事件循环上。
+ */
+class SocketSink : public PluginImpl
+{
+public:
+    virtual ~SocketSink();
+
+    virtual const char *Name();
+    virtual bool Start();
+    virtual bool Stop();
+    virtual bool SetHardwareParam(void *pHardwareConfig);
+    virtual void SetEventLoop(EventLoop *pLoop);
+
+    // ==================输出类插件接口==================
+    // 数据被丢弃时返回-1，数据本身仍归调用者所有
+    virtual int ProcessData(ProtocolDataVar *pData);
+
+    // 统计，宿主通过 PluginImplWrapper<SocketSink> 读取
+    uint64_t Sent() const { return sent_; }             // 已经完整发出的条数
+    uint64_t Dropped() const { return dropped_; }
+    uint64_t Batches() const { return batches_; }       // 封口的批数
+    uint64_t Syscalls() const { return syscalls_; }     // sendmsg 调用次数
+    uint64_t ShortWrites() const { return shortWrites_; } // 没能一次发完的次数(含EAGAIN)
+
+    static constexpr size_t kMaxPendingBytes = 16 << 20;
+
+private:
+    static constexpr int kMaxIov = 64;
+
+    bool Connect();
+    void Seal();
+    void TryWrite();
+    void OnSocket(uint32_t events);
+    void OnTimer();
+
+    std::string path_;
+    size_t batchBytes_ = 64 << 10;
+    uint64_t deadline_ = 2000000; // 纳秒
+
+    EventLoop *pLoop_ = nullptr;
+    int fd_ = -1;
+    int timerfd_ = -1;
+
+    std::mutex mutex_;
+    std::unique_ptr<wire::BatchWriter> writer_;          // 正在攒的批
+    uint64_t openedAt_ = 0;                              // 当前批第一条的时刻
+    std::deque<std::unique_ptr<wire::BatchWriter>> sealed_; // 等待发送的批
+    std::deque<std::unique_ptr<wire::BatchWriter>> spare_;  // 发完可复用的
+    size_t sentOffset_ = 0;   // sealed_ 第一批已经发出的字节数
+    size_t pendingBytes_ = 0; // 排队中(含正在攒的)的字节数
+    bool waitWritable_ = false;
+    bool broken_ = false; // 连接出错，等定时回调清理、重连
+
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    std::atomic<uint64_t> shortWrites_{0};
+};
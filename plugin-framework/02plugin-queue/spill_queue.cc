@@ -0,0 +1,277 @@
+#include "spill_queue.h"
+#include "memory_budget.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+SpillDataQueue::SpillDataQueue(size_t highWaterBytes, const std::string &dir, std::function<void(ProtocolDataVar *)> release,
+                               size_t segmentBytes)
+    : highWaterBytes_(highWaterBytes), dir_(dir), release_(std::move(release)), segmentBytes_(segmentBytes)
+{
+    if (access(dir_.c_str(), W_OK) != 0)
+        throw std::system_error(errno, std::system_category(), "spill dir " + dir_);
+}
+
+SpillDataQueue::~SpillDataQueue()
+{
+    for (auto &segment : segments_)
+        close(segment.fd);
+    // 读回来的是自己分配的，还在内存队列里的属于采集插件
+    for (auto pData : ready_)
+        delete pData;
+    for (auto pData : memory_)
+        release_(pData);
+}
+
+bool SpillDataQueue::OpenSegment()
+{
+    std::string path = dir_ + "/plugin-spill-XXXXXX";
+    int fd = mkostemp(&path[0], O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    unlink(path.c_str());
+
+    Segment segment;
+    segment.fd = fd;
+    segments_.push_back(segment);
+    return true;
+}
+
+bool SpillDataQueue::Flush()
+{
+    if (writer_.Count() == 0)
+        return true;
+    if ((segments_.empty() || segments_.back().written >= segmentBytes_) && !OpenSegment())
+        return false;
+
+    // 写失败时帧保持 Finish 过的状态，下次原样重写
+    if (!frameFinished_)
+        writer_.Finish();
+    frameFinished_ = true;
+    size_t size = writer_.Size();
+
+    // 按偏移写，失败时半帧留在文件里也没关系，下次从同一位置覆盖
+    Segment &segment = segments_.back();
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t ret = pwrite(segment.fd, writer_.Data() + done, size - done, segment.written + done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        done += ret;
+    }
+
+    segment.written += size;
+    segment.records += writer_.Count();
+    spilledBytes_ += size;
+    writer_.Reset();
+    frameFinished_ = false;
+    return true;
+}
+
+bool SpillDataQueue::Push(ProtocolDataVar *pData)
+{
+    MemoryAccount *account;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!spilling_ && memoryBytes_ < highWaterBytes_)
+        {
+            memory_.push_back(pData);
+            memoryBytes_ += RecordBytes(*pData);
+            return true;
+        }
+        spilling_ = true;
+
+        if (writer_.Size() >= kFrameBytes && !Flush())
+            return false;
+
+        writer_.Add(*pData);
+        ++onDisk_;
+        ++spilled_;
+        account = account_;
+    }
+
+    // 内容已经在写缓冲里了，记录交还给采集插件，不再占队列的账
+    if (account)
+        account->Charge(-(int64_t)RecordBytes(*pData));
+    release_(pData);
+    return true;
+}
+
+void SpillDataQueue::Decode(const wire::BatchView &batch)
+{
+    int64_t bytes = 0;
+    for (size_t i = 0; i < batch.Count(); ++i)
+    {
+        ProtocolDataVar *pData = new ProtocolDataVar();
+        batch[i].CopyTo(*pData);
+        ready_.push_back(pData);
+        bytes += RecordBytes(*pData);
+    }
+    onDisk_ -= batch.Count();
+    // 读回的副本又占内存了，外层 PopBatch 取走时按副本的大小扣账
+    if (account_ && bytes)
+        account_->Charge(bytes);
+}
+
+bool SpillDataQueue::ReadFrame()
+{
+    while (!segments_.empty())
+    {
+        Segment &segment = segments_.front();
+        if (segment.readOffset == segment.written)
+        {
+            // 读完的旧段关掉，正在写的段留着
+            if (segments_.size() == 1)
+                return false;
+            close(segment.fd);
+            segments_.pop_front();
+            continue;
+        }
+
+        // 段文件是自己写的，但磁盘出错或被别人改过时不能相信帧头：长度为0会原地打转，过长会读到别的帧
+        wire::BatchHeader header;
+        ssize_t got = pread(segment.fd, &header, sizeof(header), segment.readOffset);
+        if (got != (ssize_t)sizeof(header))
+        {
+            DropFront(got < 0 ? strerror(errno) : "short read");
+            continue;
+        }
+        size_t size = header.bytes;
+        if (header.magic != wire::kMagic || size < sizeof(header) || size > segment.written - segment.readOffset)
+        {
+            DropFront("bad frame header");
+            continue;
+        }
+        readBuf_.resize(size);
+        got = pread(segment.fd, readBuf_.data(), size, segment.readOffset);
+        if (got != (ssize_t)size)
+        {
+            DropFront(got < 0 ? strerror(errno) : "short read");
+            continue;
+        }
+
+        try
+        {
+            wire::BatchView batch(readBuf_.data(), size);
+            if (batch.Count() > segment.records)
+                throw std::invalid_argument("more records than written");
+            segment.readOffset += size;
+            segment.records -= batch.Count();
+            Decode(batch);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            DropFront(e.what());
+            continue;
+        }
+        return true;
+    }
+    return false;
+}
+
+void SpillDataQueue::DropFront(const char *why)
+{
+    Segment &segment = segments_.front();
+    std::cerr << "SpillDataQueue: drop corrupt segment at offset " << segment.readOffset << " (" << why << "), "
+              << segment.records << " records lost" << std::endl;
+    close(segment.fd);
+    onDisk_ -= segment.records;
+    lost_ += segment.records;
+    // 丢掉的如果是正在写的段，下次 Flush 会新建一个
+    segments_.pop_front();
+}
+
+size_t SpillDataQueue::PopBatch(ProtocolDataVar **out, size_t max)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    while (n < max)
+    {
+        if (!memory_.empty())
+        {
+            out[n++] = memory_.front();
+            memory_.pop_front();
+            memoryBytes_ -= RecordBytes(*out[n - 1]);
+        }
+        else if (!ready_.empty())
+        {
+            out[n++] = ready_.front();
+            ready_.pop_front();
+        }
+        else if (!spilling_)
+        {
+            break;
+        }
+        else if (!ReadFrame())
+        {
+            if (writer_.Count() == 0)
+            {
+                // 盘上和写缓冲都取完了，回到内存模式；段文件关掉，下次溢出重新建
+                for (auto &segment : segments_)
+                    close(segment.fd);
+                segments_.clear();
+                spilling_ = false;
+                break;
+            }
+            // 追上了写入端，还没写盘的那部分直接从写缓冲里取
+            if (!frameFinished_)
+                writer_.Finish();
+            Decode(wire::BatchView(writer_.Data(), writer_.Size()));
+            writer_.Reset();
+            frameFinished_ = false;
+        }
+    }
+    return n;
+}
+
+size_t SpillDataQueue::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_.size() + ready_.size() + onDisk_;
+}
+
+void SpillDataQueue::SetAccount(MemoryAccount *account)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    account_ = account;
+}
+
+bool SpillDataQueue::Spilling()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spilling_;
+}
+
+uint64_t SpillDataQueue::Spilled()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spilled_;
+}
+
+uint64_t SpillDataQueue::SpilledBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spilledBytes_;
+}
+
+uint64_t SpillDataQueue::OnDisk()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return onDisk_;
+}
+
+uint64_t SpillDataQueue::Lost()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lost_;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * 溢出写盘的数据队列
+ *
+ * 下游故障时消费循环停下来，内存队列很快就满了，采集插件只能等或者丢。
+ * SpillDataQueue 平时就是一个内存队列；内存里的数据达到 highWaterBytes 字节(按 memory_budget.h 的 RecordBytes 计)后转入溢出模式：
+ *  - 之后 Push 的数据编码后追加到本地目录下的段文件里(顺序写)，记录本身立刻通过 release 回调还给采集插件；
+ *  - 消费者取完内存里的数据后，按写入顺序从段文件读回来，读完的段文件删除；
+ *  - 读到还没写盘的尾部时直接从写缓冲里取，全部取完后回到内存模式。
+ * 整体顺序与 Push 顺序一致。
+ *
+ * 读回的记录用 new 分配，采集插件的 ReleaseData 需要能处理不是自己分配的记录(RecordPool 会 delete 掉)。
+ * release 回调在 Push 的线程上调用。
+ * 段文件只是内存的延伸，不做持久化：创建后立即 unlink，关闭或进程退出(包括崩溃)后由文件系统回收。
+ * 写盘失败(比如磁盘满)时 Push 返回false，与内存队列满的语义相同。
+ * 读回时段文件读不全或帧头不对(长度越界、格式错)，打印错误并丢掉这个段，里面没读的记录计入 Lost；
+ * 继续读后面的段，全部取完后照常回到内存模式。PopBatch 不抛异常。
+ *
+ * 外面套了 BudgetedDataQueue(memory_budget.h) 时，把同一个账户交给 SetAccount：Push 时整条记入的字节数在写盘、
+ * 记录还给插件时扣掉，读回来的副本重新记上，账户上始终只是还在内存里的记录，溢出模式下不会因为早就写盘的数据拒绝 Push。
+ *
+ * 一个线程 Push、一个线程 PopBatch；内部一把锁，溢出模式下的文件读写也在锁内完成，每次最多读写一帧(kFrameBytes)。
+ */
+
+#include "PluginImpl.h"
+#include "wire_format.h"
+
+class MemoryAccount;
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SpillDataQueue : public DataQueue
+{
+public:
+    // dir 不存在或不可写时抛出 std::system_error
+    SpillDataQueue(size_t highWaterBytes, const std::string &dir, std::function<void(ProtocolDataVar *)> release,
+                   size_t segmentBytes = 64 << 20);
+    virtual ~SpillDataQueue();
+
+    SpillDataQueue(const SpillDataQueue &) = delete;
+    SpillDataQueue &operator=(const SpillDataQueue &) = delete;
+
+    virtual bool Push(ProtocolDataVar *pData);
+    virtual size_t PopBatch(ProtocolDataVar **out, size_t max);
+    virtual size_t Size();
+
+    // 写盘时扣账、读回时记账的账户，与外层 BudgetedDataQueue 用的是同一个；nullptr 表示不记账
+    void SetAccount(MemoryAccount *account);
+
+    bool Spilling();
+    uint64_t Spilled();     // 累计写过盘的条数
+    uint64_t SpilledBytes(); // 累计写盘字节数
+    uint64_t OnDisk();      // 当前还在盘上(含写缓冲)等待读回的条数
+    uint64_t Lost();        // 段文件损坏丢掉的条数
+
+    static constexpr size_t kFrameBytes = 64 << 10;
+
+private:
+    // 一个段文件，按帧顺序写入，每帧是 wire_format.h 编码的一批
+    struct Segment
+    {
+        int fd = -1;
+        uint64_t written = 0;
+        uint64_t readOffset = 0;
+        uint64_t records = 0; // 已写入还没读回的条数
+    };
+
+    bool Flush();
+    bool ReadFrame();
+    void DropFront(const char *why);
+    void Decode(const wire::BatchView &batch);
+    bool OpenSegment();
+
+    std::mutex mutex_;
+    std::deque<ProtocolDataVar *> memory_; // 进入溢出模式之前的数据
+    size_t memoryBytes_ = 0;               // memory_ 里记录的字节数
+    std::deque<ProtocolDataVar *> ready_;  // 已经读回来的数据
+    std::deque<Segment> segments_;         // 最旧的在前面，最后一个是正在写的
+    wire::BatchWriter writer_;             // 当前帧
+    bool frameFinished_ = false;           // 当前帧已经 Finish 但还没写成功
+    std::vector<char> readBuf_;
+    bool spilling_ = false;
+
+    size_t highWaterBytes_;
+    std::string dir_;
+    std::function<void(ProtocolDataVar *)> release_;
+    size_t segmentBytes_;
+    MemoryAccount *account_ = nullptr;
+
+    uint64_t spilled_ = 0;
+    uint64_t spilledBytes_ = 0;
+    uint64_t onDisk_ = 0;
+    uint64_t lost_ = 0;
+};
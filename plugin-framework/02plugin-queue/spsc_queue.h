@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * 单生产者单消费者的无锁环形队列
+ *
+ * 一个采集线程对一个消费线程，正好是 02plugin-queue 的流水线形态。
+ * head_ 只由消费者写，tail_ 只由生产者写，两者各占一条cache line，避免伪共享；
+ * 双方各自缓存一份对端的下标，只有缓存的值显示队列满/空时才去读对端的原子变量，
+ * 这样大部分操作不需要跨核访问对端的cache line。
+ *
+ * 存储区通过 placement::AllocOnNode 分配，可以指定落在哪个NUMA节点上。
+ */
+
+#include "placement.h"
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+template <typename T>
+class SpscQueue
+{
+    // 环形缓冲区里的元素不做构造/析构，只能放指针、整数之类的平凡类型
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue only holds trivially copyable types");
+
+public:
+    // capacity 向上取整到2的幂
+    explicit SpscQueue(size_t capacity, int node = -1)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        bytes_ = size * sizeof(T);
+        buffer_ = static_cast<T *>(placement::AllocOnNode(bytes_, node));
+    }
+
+    ~SpscQueue() { placement::FreeOnNode(buffer_, bytes_); }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // 生产者调用，队列满时返回false
+    bool TryPush(const T &value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ > mask_)
+        {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail - headCache_ > mask_)
+                return false;
+        }
+        buffer_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用，队列空时返回false
+    bool TryPop(T &value)
+    {
+        return TryPopBatch(&value, 1) == 1;
+    }
+
+    // 消费者调用，一次最多取出max个，只更新一次head_
+    size_t TryPopBatch(T *out, size_t max)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (tailCache_ - head < max)
+            tailCache_ = tail_.load(std::memory_order_acquire);
+
+        size_t n = tailCache_ - head;
+        if (n > max)
+            n = max;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = buffer_[(head + i) & mask_];
+        if (n)
+            head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // 任意线程都可以调用，结果只是一个近似值
+    size_t Size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    alignas(64) std::atomic<size_t> head_{0}; // 消费者写
+    size_t tailCache_ = 0;                    // 消费者看到的tail_
+    alignas(64) std::atomic<size_t> tail_{0}; // 生产者写
+    size_t headCache_ = 0;                    // 生产者看到的head_
+    alignas(64) T *buffer_ = nullptr;
+    size_t mask_ = 0;
+    size_t bytes_ = 0;
+};
@@ -0,0 +1,116 @@
+#include "wire_format.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace wire
+{
+    static const std::string *Fields(const ProtocolDataVar &data, int i)
+    {
+        switch (i)
+        {
+        case 0:
+            return &data.name;
+        case 1:
+            return &data.unit;
+        case 2:
+            return &data.group;
+        default:
+            return &data.source;
+        }
+    }
+
+    void BatchWriter::Add(const ProtocolDataVar &data)
+    {
+        RecordHeader header{};
+        size_t payload = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            size_t length = Fields(data, i)->size();
+            if (length > 0xffff)
+                throw std::length_error("wire: string field longer than 65535 bytes");
+            header.lengths[i] = (uint16_t)length;
+            payload += length;
+        }
+        header.size = (uint32_t)AlignUp(sizeof(RecordHeader) + payload);
+        header.getTime = data.getTime;
+        header.value = data.value;
+
+        // resize 补的是0，补齐的字节内容是确定的
+        size_t offset = buf_.size();
+        buf_.resize(offset + header.size);
+        char *p = &buf_[offset];
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        for (int i = 0; i < 4; ++i)
+        {
+            const std::string *s = Fields(data, i);
+            memcpy(p, s->data(), s->size());
+            p += s->size();
+        }
+        offsets_.push_back((uint32_t)offset);
+    }
+
+    size_t BatchWriter::Finish()
+    {
+        BatchHeader header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.count = (uint32_t)offsets_.size();
+        header.indexOffset = (uint32_t)buf_.size();
+
+        size_t indexBytes = offsets_.size() * sizeof(uint32_t);
+        buf_.resize(AlignUp(buf_.size() + indexBytes));
+        memcpy(&buf_[header.indexOffset], offsets_.data(), indexBytes);
+
+        header.bytes = (uint32_t)buf_.size();
+        memcpy(&buf_[0], &header, sizeof(header));
+        return buf_.size();
+    }
+
+    size_t BatchView::PeekSize(const void *data, size_t size)
+    {
+        if (size < sizeof(BatchHeader))
+            return 0;
+        BatchHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != kMagic)
+            throw std::invalid_argument("wire: bad magic");
+        return header.bytes;
+    }
+
+    BatchView::BatchView(const void *data, size_t size) : data_(static_cast<const char *>(data))
+    {
+        if (size < sizeof(BatchHeader))
+            throw std::invalid_argument("wire: truncated batch header");
+        BatchHeader header;
+        memcpy(&header, data_, sizeof(header));
+        if (header.magic != kMagic)
+            throw std::invalid_argument("wire: bad magic");
+        if (header.version != kVersion)
+            throw std::invalid_argument("wire: unsupported version " + std::to_string(header.version));
+        if (header.bytes > size || header.indexOffset < sizeof(BatchHeader) || header.indexOffset > header.bytes ||
+            (header.bytes - header.indexOffset) / sizeof(uint32_t) < header.count)
+            throw std::invalid_argument("wire: bad batch layout");
+
+        index_ = data_ + header.indexOffset;
+        count_ = header.count;
+        bytes_ = header.bytes;
+
+        // 索引和每条记录的边界都检查一遍，之后取字段不再检查
+        for (size_t i = 0; i < count_; ++i)
+        {
+            uint32_t offset;
+            memcpy(&offset, index_ + i * sizeof(offset), sizeof(offset));
+            if (offset < sizeof(BatchHeader) || offset > header.indexOffset ||
+                header.indexOffset - offset < sizeof(RecordHeader))
+                throw std::invalid_argument("wire: bad record offset");
+
+            RecordHeader record;
+            memcpy(&record, data_ + offset, sizeof(record));
+            size_t payload = (size_t)record.lengths[0] + record.lengths[1] + record.lengths[2] + record.lengths[3];
+            if (record.size < sizeof(RecordHeader) + payload || record.size > header.indexOffset - offset)
+                throw std::invalid_argument("wire: bad record size");
+        }
+    }
+}
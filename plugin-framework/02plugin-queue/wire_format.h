@@ -0,0 +1,160 @@
+#pragma once
+
+/**
+ * ProtocolDataVar 的二进制编码
+ *
+ * 跨进程传递或者写盘时，不用再手工拼 std::string。一批记录编码成一块连续的内存：
+ *
+ *      BatchHeader(24字节)
+ *      记录0 记录1 ...          每条从8字节边界开始
+ *      索引: uint32 offsets[count]，各条记录相对批开头的偏移
+ *
+ * 每条记录：RecordHeader(32字节，getTime/value 在8字节边界上) + name unit group source 四个字符串，
+ * 字符串不带结尾的'\0'，长度在头里，整条补齐到8字节。所有整数都是小端。
+ *
+ * 读的一方用 BatchView 包住收到的内存，构造时把头、索引和每条记录的边界检查一遍(不可信的输入也不会越界)，
+ * 之后 RecordView 直接在缓冲区里取字段，字符串是 std::string_view，不拷贝、不反序列化。
+ * 需要 ProtocolDataVar 时再用 RecordView::CopyTo 拷出来。
+ *
+ * 版本号不同的批直接拒绝；flags 和各处的 reserved 目前写0，留给以后兼容地扩展。
+ */
+
+#include "PluginImpl.h"
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire format assumes a little-endian host");
+
+namespace wire
+{
+    constexpr uint32_t kMagic = 0x42564450; // "PDVB"
+    constexpr uint16_t kVersion = 1;
+    constexpr size_t kAlign = 8;
+
+    struct BatchHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t flags;
+        uint32_t count;
+        uint32_t bytes;       // 整批的字节数，含头和索引
+        uint32_t indexOffset; // 索引相对批开头的偏移
+        uint32_t reserved;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t size;        // 整条的字节数，含头和补齐
+        uint16_t lengths[4];  // name unit group source
+        uint32_t reserved;
+        uint64_t getTime;
+        double value;
+    };
+
+    static_assert(sizeof(BatchHeader) == 24, "BatchHeader layout");
+    static_assert(sizeof(RecordHeader) == 32, "RecordHeader layout");
+
+    inline size_t AlignUp(size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+    // 指向缓冲区里的一条记录，缓冲区必须比视图活得长
+    class RecordView
+    {
+    public:
+        explicit RecordView(const char *p) : p_(p) {}
+
+        uint64_t GetTime() const { return Load<uint64_t>(offsetof(RecordHeader, getTime)); }
+        double Value() const { return Load<double>(offsetof(RecordHeader, value)); }
+        std::string_view Name() const { return Field(0); }
+        std::string_view Unit() const { return Field(1); }
+        std::string_view Group() const { return Field(2); }
+        std::string_view Source() const { return Field(3); }
+
+        void CopyTo(ProtocolDataVar &data) const
+        {
+            std::string_view name = Name(), unit = Unit(), group = Group(), source = Source();
+            data.name.assign(name.data(), name.size());
+            data.unit.assign(unit.data(), unit.size());
+            data.group.assign(group.data(), group.size());
+            data.source.assign(source.data(), source.size());
+            data.getTime = GetTime();
+            data.value = Value();
+        }
+
+    private:
+        // 缓冲区不一定按8字节对齐，用 memcpy 读，编译器会生成普通的 load
+        template <typename T>
+        T Load(size_t offset) const
+        {
+            T v;
+            memcpy(&v, p_ + offset, sizeof(v));
+            return v;
+        }
+
+        std::string_view Field(int i) const
+        {
+            size_t offset = sizeof(RecordHeader);
+            for (int k = 0; k < i; ++k)
+                offset += Load<uint16_t>(offsetof(RecordHeader, lengths) + k * 2);
+            return std::string_view(p_ + offset, Load<uint16_t>(offsetof(RecordHeader, lengths) + i * 2));
+        }
+
+        const char *p_;
+    };
+
+    class BatchView
+    {
+    public:
+        // 格式不对时抛出 std::invalid_argument
+        BatchView(const void *data, size_t size);
+
+        // 从批开头的几个字节读出整批的长度，用于从流里切分；不足一个头时返回0
+        static size_t PeekSize(const void *data, size_t size);
+
+        size_t Count() const { return count_; }
+        size_t Bytes() const { return bytes_; }
+
+        RecordView operator[](size_t i) const
+        {
+            uint32_t offset;
+            memcpy(&offset, index_ + i * sizeof(offset), sizeof(offset));
+            return RecordView(data_ + offset);
+        }
+
+    private:
+        const char *data_;
+        const char *index_;
+        size_t count_;
+        size_t bytes_;
+    };
+
+    // 编码一批记录，缓冲区在 Reset 之间复用，稳定后不再分配内存
+    class BatchWriter
+    {
+    public:
+        BatchWriter() { Reset(); }
+
+        void Reset()
+        {
+            buf_.resize(sizeof(BatchHeader));
+            offsets_.clear();
+        }
+
+        // 单个字符串超过 65535 字节时抛出 std::length_error
+        void Add(const ProtocolDataVar &data);
+
+        // 写入索引和批头，之后 Data()/Size() 就是完整的一批
+        size_t Finish();
+
+        size_t Count() const { return offsets_.size(); }
+        // 已经写入的字节数(Finish 之前不含索引)，用来判断批是否够大
+        size_t Size() const { return buf_.size(); }
+        const char *Data() const { return buf_.data(); }
+
+    private:
+        std::vector<char> buf_;
+        std::vector<uint32_t> offsets_;
+    };
+}